@@ -0,0 +1,280 @@
+// Cross-platform, thread-safe, sharded ordered hash map with integer and string keys with detachable nodes.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#ifndef CUBICLESOFT_SYNC_CONCURRENTORDEREDHASH
+#define CUBICLESOFT_SYNC_CONCURRENTORDEREDHASH
+
+#include "sync_readwritelock.h"
+#include "../templates/detachable_ordered_hash.h"
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		// Keys are spread across independent OrderedHash shards by hash key.  Each shard has its own reader/writer lock.
+		// Lookups only take a shard read lock, so they scale with the number of threads until shards collide.
+		// Insertion order is only maintained within each shard.  Use a single shard for a fully ordered hash.
+		template <class T>
+		class ConcurrentOrderedHash
+		{
+		public:
+			// NumShards is rounded up to a power of two.  Implements djb2 (DJBX33X).  See OrderedHash for security considerations.
+			ConcurrentOrderedHash(size_t NumShards = 16, size_t EstimatedSize = 23, std::uint64_t HashKey = 5381) : MxUseSipHash(false), MxKey1(HashKey), MxKey2(0)
+			{
+				Init(NumShards, EstimatedSize);
+			}
+
+			// Keys are securely hashed via SipHash-2-4.
+			// Assumes good (CSPRNG generated) inputs for HashKey1 and HashKey2.
+			ConcurrentOrderedHash(size_t NumShards, size_t EstimatedSize, std::uint64_t HashKey1, std::uint64_t HashKey2) : MxUseSipHash(true), MxKey1(HashKey1), MxKey2(HashKey2)
+			{
+				Init(NumShards, EstimatedSize);
+			}
+
+			~ConcurrentOrderedHash()
+			{
+				for (size_t x = 0; x < MxNumShards; x++)  delete MxShards[x].MxHash;
+
+				delete[] MxShards;
+			}
+
+			// Returns false if the key already exists.  Nodes are allocated before taking the shard lock.
+			bool Push(const std::int64_t IntKey, const T &Value)
+			{
+				OrderedHashNode<T> *Node = OrderedHash<T>::CreateNode(IntKey, Value);
+				if (Push(Node))  return true;
+
+				delete Node;
+
+				return false;
+			}
+
+			bool Push(const char *StrKey, const size_t StrLen, const T &Value)
+			{
+				OrderedHashNode<T> *Node = OrderedHash<T>::CreateNode(StrKey, StrLen, Value);
+				if (Push(Node))  return true;
+
+				delete Node;
+
+				return false;
+			}
+
+			// Only use with detached nodes.  The caller still owns the node when this returns false.
+			bool Push(OrderedHashNode<T> *Node)
+			{
+				Shard &TempShard = GetShard(Node);
+
+				if (!TempShard.MxLock.WriteLock())  return false;
+				bool Result = (TempShard.MxHash->Push(Node) != NULL);
+				TempShard.MxLock.WriteUnlock();
+
+				return Result;
+			}
+
+			// Inserts the key or replaces the value of an existing key.
+			bool Set(const std::int64_t IntKey, const T &Value)
+			{
+				OrderedHashNode<T> *Node = OrderedHash<T>::CreateNode(IntKey, Value);
+				Shard &TempShard = GetShard(Node);
+
+				return SetInternal(TempShard, Node);
+			}
+
+			bool Set(const char *StrKey, const size_t StrLen, const T &Value)
+			{
+				OrderedHashNode<T> *Node = OrderedHash<T>::CreateNode(StrKey, StrLen, Value);
+				Shard &TempShard = GetShard(Node);
+
+				return SetInternal(TempShard, Node);
+			}
+
+			// Copies the value into Result.  Node pointers can't be returned since another thread may remove the node at any time.
+			bool Find(const std::int64_t IntKey, T &Result)
+			{
+				Shard &TempShard = GetShard(GetHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t)));
+
+				if (!TempShard.MxLock.ReadLock())  return false;
+				OrderedHashNode<T> *Node = TempShard.MxHash->Find(IntKey);
+				if (Node != NULL)  Result = Node->Value;
+				TempShard.MxLock.ReadUnlock();
+
+				return (Node != NULL);
+			}
+
+			bool Find(const char *StrKey, const size_t StrLen, T &Result)
+			{
+				Shard &TempShard = GetShard(GetHashKey((const std::uint8_t *)StrKey, StrLen));
+
+				if (!TempShard.MxLock.ReadLock())  return false;
+				OrderedHashNode<T> *Node = TempShard.MxHash->Find(StrKey, StrLen);
+				if (Node != NULL)  Result = Node->Value;
+				TempShard.MxLock.ReadUnlock();
+
+				return (Node != NULL);
+			}
+
+			// Returns the detached node, which belongs to the caller, or NULL if the key doesn't exist.
+			OrderedHashNode<T> *Detach(const std::int64_t IntKey, bool ResetHashKey)
+			{
+				Shard &TempShard = GetShard(GetHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t)));
+
+				if (!TempShard.MxLock.WriteLock())  return NULL;
+				OrderedHashNode<T> *Node = TempShard.MxHash->Find(IntKey);
+				TempShard.MxHash->Detach(Node, ResetHashKey);
+				TempShard.MxLock.WriteUnlock();
+
+				return Node;
+			}
+
+			OrderedHashNode<T> *Detach(const char *StrKey, const size_t StrLen, bool ResetHashKey)
+			{
+				Shard &TempShard = GetShard(GetHashKey((const std::uint8_t *)StrKey, StrLen));
+
+				if (!TempShard.MxLock.WriteLock())  return NULL;
+				OrderedHashNode<T> *Node = TempShard.MxHash->Find(StrKey, StrLen);
+				TempShard.MxHash->Detach(Node, ResetHashKey);
+				TempShard.MxLock.WriteUnlock();
+
+				return Node;
+			}
+
+			bool Remove(const std::int64_t IntKey)
+			{
+				OrderedHashNode<T> *Node = Detach(IntKey, false);
+				if (Node == NULL)  return false;
+
+				delete Node;
+
+				return true;
+			}
+
+			bool Remove(const char *StrKey, const size_t StrLen)
+			{
+				OrderedHashNode<T> *Node = Detach(StrKey, StrLen, false);
+				if (Node == NULL)  return false;
+
+				delete Node;
+
+				return true;
+			}
+
+			void Empty()
+			{
+				for (size_t x = 0; x < MxNumShards; x++)
+				{
+					if (MxShards[x].MxLock.WriteLock())
+					{
+						MxShards[x].MxHash->Empty();
+						MxShards[x].MxLock.WriteUnlock();
+					}
+				}
+			}
+
+			// Approximate while other threads are modifying the hash.
+			size_t GetSize()
+			{
+				size_t Result = 0;
+
+				for (size_t x = 0; x < MxNumShards; x++)
+				{
+					if (MxShards[x].MxLock.ReadLock())
+					{
+						Result += MxShards[x].MxHash->GetListSize();
+						MxShards[x].MxLock.ReadUnlock();
+					}
+				}
+
+				return Result;
+			}
+
+			// Direct access to each shard (e.g. for iteration).  Hold the shard lock for as long as the shard hash or its nodes are in use.
+			inline size_t GetNumShards() const  { return MxNumShards; }
+			inline OrderedHash<T> *GetShardHash(size_t Num)  { return MxShards[Num].MxHash; }
+			inline ReadWriteLock *GetShardLock(size_t Num)  { return &MxShards[Num].MxLock; }
+
+		private:
+			// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+			ConcurrentOrderedHash(const ConcurrentOrderedHash<T> &);
+			ConcurrentOrderedHash<T> &operator=(const ConcurrentOrderedHash<T> &);
+
+			// Shards are padded to keep the reader counts of neighboring locks on separate cache lines.
+			class Shard
+			{
+			public:
+				ReadWriteLock MxLock;
+				OrderedHash<T> *MxHash;
+				char MxPad[64];
+			};
+
+			void Init(size_t NumShards, size_t EstimatedSize)
+			{
+				MxNumShards = 1;
+				MxShardShift = 64;
+				while (MxNumShards < NumShards)
+				{
+					MxNumShards <<= 1;
+					MxShardShift--;
+				}
+
+				EstimatedSize = EstimatedSize / MxNumShards + 1;
+
+				MxShards = new Shard[MxNumShards];
+				for (size_t x = 0; x < MxNumShards; x++)
+				{
+					MxShards[x].MxLock.Create();
+					MxShards[x].MxHash = (MxUseSipHash ? new OrderedHash<T>(EstimatedSize, MxKey1, MxKey2) : new OrderedHash<T>(EstimatedSize, MxKey1));
+				}
+			}
+
+			// Same hash as the shards use.
+			inline std::uint64_t GetHashKey(const std::uint8_t *Str, size_t Size) const
+			{
+				return (MxUseSipHash ? OrderedHashUtil::GetSipHashKey(Str, Size, MxKey1, MxKey2, 2, 4) : (std::uint64_t)OrderedHashUtil::GetDJBX33XHashKey(Str, Size, (size_t)MxKey1));
+			}
+
+			// Shards use the high bits of a multiplicative mix so that they are independent of each shard's prime bucket count.
+			inline Shard &GetShard(std::uint64_t HashKey)
+			{
+				return MxShards[(MxShardShift < 64 ? (size_t)((HashKey * 0x9E3779B97F4A7C15ULL) >> MxShardShift) : 0)];
+			}
+
+			inline Shard &GetShard(OrderedHashNode<T> *Node)
+			{
+				std::int64_t IntKey = Node->GetIntKey();
+
+				if (Node->GetStrKey() != NULL)  return GetShard(GetHashKey((const std::uint8_t *)Node->GetStrKey(), (size_t)IntKey));
+
+				return GetShard(GetHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t)));
+			}
+
+			// Takes ownership of Node.
+			bool SetInternal(Shard &TempShard, OrderedHashNode<T> *Node)
+			{
+				if (!TempShard.MxLock.WriteLock())
+				{
+					delete Node;
+
+					return false;
+				}
+
+				OrderedHashNode<T> *Node2 = TempShard.MxHash->Find(Node);
+				if (Node2 != NULL)  Node2->Value = Node->Value;
+				else  TempShard.MxHash->Push(Node);
+
+				TempShard.MxLock.WriteUnlock();
+
+				if (Node2 != NULL)  delete Node;
+
+				return true;
+			}
+
+			bool MxUseSipHash;
+			std::uint64_t MxKey1, MxKey2;
+
+			size_t MxNumShards, MxShardShift;
+			Shard *MxShards;
+		};
+	}
+}
+
+#endif
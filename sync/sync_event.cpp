@@ -37,11 +37,11 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool Event::Wait(std::uint32_t Wait)
+		bool Event::WaitNS(std::uint64_t WaitNS)
 		{
 			if (MxWinWaitEvent == NULL)  return false;
 
-			DWORD Result = ::WaitForSingleObject(MxWinWaitEvent, Wait);
+			DWORD Result = ::WaitForSingleObject(MxWinWaitEvent, Util::GetWaitMS(WaitNS));
 			if (Result != WAIT_OBJECT_0)  return false;
 
 			return true;
@@ -118,12 +118,12 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool Event::Wait(std::uint32_t WaitAmt)
+		bool Event::WaitNS(std::uint64_t WaitNS)
 		{
 			if (MxMem == NULL)  return false;
 
 			// Wait for the event.
-			return Util::WaitForUnixEvent(MxPthreadEvent, WaitAmt);
+			return Util::WaitForUnixEventNS(MxPthreadEvent, WaitNS);
 		}
 
 		bool Event::Fire()
@@ -12,6 +12,7 @@ namespace CubicleSoft
 	{
 		class Event
 		{
+			friend class WaitMultiple;
 		public:
 			Event();
 			~Event();
@@ -19,7 +20,8 @@ namespace CubicleSoft
 			bool Create(const char *Name = NULL, bool Manual = false, bool Prefire = false);
 
 			// Wait time is in milliseconds.  Granularity is in 5ms intervals on some platforms.
-			bool Wait(std::uint32_t Wait = INFINITE);
+			inline bool Wait(std::uint32_t Wait = INFINITE)  { return WaitNS(Util::GetWaitNS(Wait)); }
+			bool WaitNS(std::uint64_t WaitNS);
 
 			// Lets a thread through that is waiting.  Lets multiple threads through that are waiting if the event is 'manual'.
 			bool Fire();
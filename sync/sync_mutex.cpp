@@ -7,6 +7,9 @@ namespace CubicleSoft
 {
 	namespace Sync
 	{
+		// Upper limit of the adaptive spin phase of Lock() on POSIX.
+		#define CUBICLESOFT_SYNC_MUTEX_MAX_SPIN   100
+
 #if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
 		// Windows.
 		Mutex::Mutex() : MxWinMutex(NULL), MxOwnerID(0), MxCount(0)
@@ -63,7 +66,7 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool Mutex::Lock(uint32_t Wait)
+		bool Mutex::LockNS(std::uint64_t WaitNS)
 		{
 			::EnterCriticalSection(&MxWinCritSection);
 
@@ -87,7 +90,7 @@ namespace CubicleSoft
 			::LeaveCriticalSection(&MxWinCritSection);
 
 			// Acquire the mutex.
-			DWORD Result = ::WaitForSingleObject(MxWinMutex, (DWORD)Wait);
+			DWORD Result = ::WaitForSingleObject(MxWinMutex, Util::GetWaitMS(WaitNS));
 			if (Result != WAIT_OBJECT_0)  return false;
 
 			::EnterCriticalSection(&MxWinCritSection);
@@ -126,7 +129,7 @@ namespace CubicleSoft
 		}
 #else
 		// POSIX pthreads.
-		Mutex::Mutex() : MxNamed(false), MxMem(NULL), MxOwnerID(0), MxCount(0)
+		Mutex::Mutex() : MxNamed(false), MxMem(NULL), MxSpinCount(0), MxOwnerID(0), MxCount(0)
 		{
 			pthread_mutex_init(&MxPthreadCritSection, NULL);
 		}
@@ -204,7 +207,7 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool Mutex::Lock(uint32_t Wait)
+		bool Mutex::LockNS(std::uint64_t WaitNS)
 		{
 			if (pthread_mutex_lock(&MxPthreadCritSection) != 0)  return false;
 
@@ -219,7 +222,27 @@ namespace CubicleSoft
 
 			pthread_mutex_unlock(&MxPthreadCritSection);
 
-			if (!Util::WaitForUnixSemaphore(MxPthreadMutex, Wait))  return false;
+			if (WaitNS == 0)
+			{
+				if (!Util::WaitForUnixSemaphore(MxPthreadMutex, 0))  return false;
+			}
+			else
+			{
+				// Spin briefly before sleeping since most critical sections are short.
+				std::int32_t x, MaxSpins = MxSpinCount * 2 + 10;
+				if (MaxSpins > CUBICLESOFT_SYNC_MUTEX_MAX_SPIN)  MaxSpins = CUBICLESOFT_SYNC_MUTEX_MAX_SPIN;
+				for (x = 0; x < MaxSpins; x++)
+				{
+					if (MxPthreadMutex.MxCount[0] && Util::WaitForUnixSemaphore(MxPthreadMutex, 0))  break;
+
+					Util::CPUPause();
+				}
+
+				// Racy on purpose.  Threads update the budget without synchronization since a lost update only shifts a heuristic.
+				MxSpinCount += (x - MxSpinCount) / 8;
+
+				if (x == MaxSpins && !Util::WaitForUnixSemaphoreNS(MxPthreadMutex, WaitNS))  return false;
+			}
 
 			pthread_mutex_lock(&MxPthreadCritSection);
 			MxOwnerID = Util::GetCurrentThreadID();
@@ -12,6 +12,7 @@ namespace CubicleSoft
 	{
 		class Mutex
 		{
+			friend class WaitMultiple;
 		public:
 			Mutex();
 			~Mutex();
@@ -19,7 +20,8 @@ namespace CubicleSoft
 			bool Create(const char *Name = NULL);
 
 			// Wait is in milliseconds.  Granularity is in 5ms intervals on some platforms.
-			bool Lock(std::uint32_t Wait = INFINITE);
+			inline bool Lock(std::uint32_t Wait = INFINITE)  { return LockNS(Util::GetWaitNS(Wait)); }
+			bool LockNS(std::uint64_t WaitNS);
 
 			bool Unlock(bool All = false);
 
@@ -53,6 +55,9 @@ namespace CubicleSoft
 			bool MxNamed;
 			char *MxMem;
 			Util::UnixSemaphoreWrapper MxPthreadMutex;
+
+			// Adaptive spin budget.  Moves toward the number of spins recent Lock() calls needed.
+			volatile std::int32_t MxSpinCount;
 #endif
 
 			volatile ThreadIDType MxOwnerID;
@@ -65,21 +65,22 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool ReadWriteLock::ReadLock(std::uint32_t Wait)
+		bool ReadWriteLock::ReadLockNS(std::uint64_t WaitNS)
 		{
+			DWORD Wait = Util::GetWaitMS(WaitNS);
 			std::uint64_t StartTime, CurrTime;
 
 			if (MxWinRSemaphore == NULL || MxWinRSemMutex == NULL || MxWinRWaitEvent == NULL || MxWinWWaitMutex == NULL)  return false;
 
 			// Get current time in milliseconds.
-			StartTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
+			StartTime = (Wait == INFINITE ? 0 : Util::GetMonotonicNanosecondTime() / 1000000);
 
 			// Acquire the write lock mutex.  Guarantees that readers can't starve the writer.
 			DWORD Result = ::WaitForSingleObject(MxWinWWaitMutex, Wait);
 			if (Result != WAIT_OBJECT_0)  return false;
 
 			// Acquire the semaphore mutex.
-			CurrTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
+			CurrTime = (Wait == INFINITE ? 0 : Util::GetMonotonicNanosecondTime() / 1000000);
 			if (Wait < CurrTime - StartTime || ::WaitForSingleObject(MxWinRSemMutex, Wait - (DWORD)(CurrTime - StartTime)) != WAIT_OBJECT_0)
 			{
 				::ReleaseSemaphore(MxWinWWaitMutex, 1, NULL);
@@ -88,7 +89,7 @@ namespace CubicleSoft
 			}
 
 			// Acquire the semaphore.
-			CurrTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
+			CurrTime = (Wait == INFINITE ? 0 : Util::GetMonotonicNanosecondTime() / 1000000);
 			if (Wait < CurrTime - StartTime || ::WaitForSingleObject(MxWinRSemaphore, Wait - (DWORD)(CurrTime - StartTime)) != WAIT_OBJECT_0)
 			{
 				::ReleaseSemaphore(MxWinRSemMutex, 1, NULL);
@@ -114,21 +115,22 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool ReadWriteLock::WriteLock(std::uint32_t Wait)
+		bool ReadWriteLock::WriteLockNS(std::uint64_t WaitNS)
 		{
+			DWORD Wait = Util::GetWaitMS(WaitNS);
 			std::uint64_t StartTime, CurrTime;
 
 			if (MxWinRWaitEvent == NULL || MxWinWWaitMutex == NULL)  return false;
 
 			// Get current time in milliseconds.
-			StartTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
+			StartTime = (Wait == INFINITE ? 0 : Util::GetMonotonicNanosecondTime() / 1000000);
 
 			// Acquire the write lock mutex.
 			DWORD Result = ::WaitForSingleObject(MxWinWWaitMutex, Wait);
 			if (Result != WAIT_OBJECT_0)  return false;
 
 			// Wait for readers to reach zero.
-			CurrTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
+			CurrTime = (Wait == INFINITE ? 0 : Util::GetMonotonicNanosecondTime() / 1000000);
 			if (Wait < CurrTime - StartTime || ::WaitForSingleObject(MxWinRWaitEvent, Wait - (DWORD)(CurrTime - StartTime)) != WAIT_OBJECT_0)
 			{
 				::ReleaseSemaphore(MxWinWWaitMutex, 1, NULL);
@@ -255,65 +257,64 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool ReadWriteLock::ReadLock(std::uint32_t Wait)
-		{
-			std::uint64_t StartTime, CurrTime;
+		// MxRCount holds the number of readers plus the writer bit.  Readers only touch the mutexes while a writer is waiting or active.
+		#define CUBICLESOFT_SYNC_READWRITELOCK_WRITER   0x80000000
 
+		bool ReadWriteLock::ReadLockNS(std::uint64_t WaitNS)
+		{
 			if (MxMem == NULL)  return false;
 
-			// Get current time in milliseconds.
-			StartTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
-
-			// Acquire the write lock mutex.  Guarantees that readers can't starve the writer.
-			if (!Util::WaitForUnixSemaphore(MxPthreadWWaitMutex, Wait))  return false;
-
-			// Acquire the counter mutex.
-			CurrTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
-			if (Wait < CurrTime - StartTime || !Util::WaitForUnixSemaphore(MxPthreadRCountMutex, Wait - (CurrTime - StartTime)))
-			{
-				Util::ReleaseUnixSemaphore(MxPthreadWWaitMutex, NULL);
+			// Fast path.
+			std::uint32_t State = Util::AtomicAdd32(MxRCount, 1);
+			if (!(State & CUBICLESOFT_SYNC_READWRITELOCK_WRITER))  return true;
 
-				return false;
-			}
+			// Back off.  Let a writer waiting on the remaining readers through.
+			State = Util::AtomicAdd32(MxRCount, (std::uint32_t)-1);
+			if (State == CUBICLESOFT_SYNC_READWRITELOCK_WRITER)  Util::FireUnixEvent(MxPthreadRWaitEvent);
 
-			// Update the event state.
-			if (!Util::ResetUnixEvent(MxPthreadRWaitEvent))
-			{
-				Util::ReleaseUnixSemaphore(MxPthreadRCountMutex, NULL);
-				Util::ReleaseUnixSemaphore(MxPthreadWWaitMutex, NULL);
-
-				return false;
-			}
+			// Acquire the write lock mutex.  Guarantees that readers can't starve the writer.
+			if (!Util::WaitForUnixSemaphoreNS(MxPthreadWWaitMutex, WaitNS))  return false;
 
-			// Increment the number of readers.
-			MxRCount[0]++;
+			// Writers clear the writer bit before releasing the write lock mutex.
+			Util::AtomicAdd32(MxRCount, 1);
 
-			// Release the mutexes.
-			Util::ReleaseUnixSemaphore(MxPthreadRCountMutex, NULL);
+			// Release the mutex.
 			Util::ReleaseUnixSemaphore(MxPthreadWWaitMutex, NULL);
 
 			return true;
 		}
 
-		bool ReadWriteLock::WriteLock(std::uint32_t Wait)
+		bool ReadWriteLock::WriteLockNS(std::uint64_t WaitNS)
 		{
 			std::uint64_t StartTime, CurrTime;
 
 			if (MxMem == NULL)  return false;
 
-			// Get current time in milliseconds.
-			StartTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
+			StartTime = (WaitNS == INFINITE_NS ? 0 : Util::GetMonotonicNanosecondTime());
 
 			// Acquire the write lock mutex.
-			if (!Util::WaitForUnixSemaphore(MxPthreadWWaitMutex, Wait))  return false;
+			if (!Util::WaitForUnixSemaphoreNS(MxPthreadWWaitMutex, WaitNS))  return false;
 
-			// Wait for readers to reach zero.
-			CurrTime = (Wait == INFINITE ? 0 : Util::GetUnixMicrosecondTime() / 1000000);
-			if (Wait < CurrTime - StartTime || !Util::WaitForUnixEvent(MxPthreadRWaitEvent, Wait - (CurrTime - StartTime)))
+			// Block new readers.  The event is fired when the reader count reaches zero.
+			Util::ResetUnixEvent(MxPthreadRWaitEvent);
+			std::uint32_t State = Util::AtomicAdd32(MxRCount, CUBICLESOFT_SYNC_READWRITELOCK_WRITER);
+
+			// Wait for readers to reach zero.  A reader that backs off can fire the event long after its decrement (e.g. when preempted) and wake this writer
+			// while newer readers still hold the lock, so the count is checked again after every wake.
+			while (State != CUBICLESOFT_SYNC_READWRITELOCK_WRITER)
 			{
-				Util::ReleaseUnixSemaphore(MxPthreadWWaitMutex, NULL);
+				CurrTime = (WaitNS == INFINITE_NS ? 0 : Util::GetMonotonicNanosecondTime());
+				if (WaitNS < CurrTime - StartTime || !Util::WaitForUnixEventNS(MxPthreadRWaitEvent, (WaitNS == INFINITE_NS ? INFINITE_NS : WaitNS - (CurrTime - StartTime))))
+				{
+					Util::AtomicAdd32(MxRCount, (std::uint32_t)0 - CUBICLESOFT_SYNC_READWRITELOCK_WRITER);
+					Util::ReleaseUnixSemaphore(MxPthreadWWaitMutex, NULL);
 
-				return false;
+					return false;
+				}
+
+				// The last reader to leave fires the event after its decrement, so a reader leaving after the reset is seen in the count or fires again.
+				Util::ResetUnixEvent(MxPthreadRWaitEvent);
+				State = Util::AtomicAdd32(MxRCount, 0);
 			}
 
 			return true;
@@ -323,37 +324,20 @@ namespace CubicleSoft
 		{
 			if (MxMem == NULL)  return false;
 
-			// Acquire the counter mutex.
-			if (!Util::WaitForUnixSemaphore(MxPthreadRCountMutex, INFINITE))  return false;
-
-			// Decrease the number of readers.
-			if (MxRCount[0])  MxRCount[0]--;
-			else
-			{
-				Util::ReleaseUnixSemaphore(MxPthreadRCountMutex, NULL);
+			if (!(MxRCount[0] & ~CUBICLESOFT_SYNC_READWRITELOCK_WRITER))  return false;
 
-				return false;
-			}
-
-			// Update the event state.
-			if (!MxRCount[0] && !Util::FireUnixEvent(MxPthreadRWaitEvent))
-			{
-				Util::ReleaseUnixSemaphore(MxPthreadRCountMutex, NULL);
-
-				return false;
-			}
-
-			// Release the counter mutex.
-			Util::ReleaseUnixSemaphore(MxPthreadRCountMutex, NULL);
+			// Decrease the number of readers.  Wake the writer when the last reader leaves.
+			if (Util::AtomicAdd32(MxRCount, (std::uint32_t)-1) == CUBICLESOFT_SYNC_READWRITELOCK_WRITER && !Util::FireUnixEvent(MxPthreadRWaitEvent))  return false;
 
 			return true;
 		}
 
 		bool ReadWriteLock::WriteUnlock()
 		{
-			if (MxMem == NULL)  return false;
+			if (MxMem == NULL || !(MxRCount[0] & CUBICLESOFT_SYNC_READWRITELOCK_WRITER))  return false;
 
-			// Release the write lock.
+			// Let readers back in and release the write lock.
+			Util::AtomicAdd32(MxRCount, (std::uint32_t)0 - CUBICLESOFT_SYNC_READWRITELOCK_WRITER);
 			Util::ReleaseUnixSemaphore(MxPthreadWWaitMutex, NULL);
 
 			return true;
@@ -19,10 +19,12 @@ namespace CubicleSoft
 			bool Create(const char *Name = NULL);
 
 			// Wait is in milliseconds.  Granularity is in 5ms-15ms intervals on some platforms.
-			bool ReadLock(std::uint32_t Wait = INFINITE);
+			inline bool ReadLock(std::uint32_t Wait = INFINITE)  { return ReadLockNS(Util::GetWaitNS(Wait)); }
+			bool ReadLockNS(std::uint64_t WaitNS);
 
 			// Wait is in milliseconds.  Granularity is in 5ms-15ms intervals on some platforms.
-			bool WriteLock(std::uint32_t Wait = INFINITE);
+			inline bool WriteLock(std::uint32_t Wait = INFINITE)  { return WriteLockNS(Util::GetWaitNS(Wait)); }
+			bool WriteLockNS(std::uint64_t WaitNS);
 
 			bool ReadUnlock();
 			bool WriteUnlock();
@@ -67,6 +69,8 @@ namespace CubicleSoft
 #else
 			bool MxNamed;
 			char *MxMem;
+			// MxPthreadRCountMutex is no longer used but remains part of the shared memory layout.
+			// MxRCount is the number of readers.  The high bit is set while a writer is waiting or active.
 			Util::UnixSemaphoreWrapper MxPthreadRCountMutex;
 			volatile std::uint32_t *MxRCount;
 			Util::UnixEventWrapper MxPthreadRWaitEvent;
@@ -0,0 +1,374 @@
+// Cross-platform, optionally named (cross-process), lock-free bounded ring buffer of variable length records.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "sync_ringbuffer.h"
+#include <cstdio>
+#include <cstring>
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		// Shared layout:  [Info][WritePos][ReadPos][ReclaimPos][Data], each position on its own cache line.
+		#define CUBICLESOFT_SYNC_RINGBUFFER_LINE_SIZE   64
+		#define CUBICLESOFT_SYNC_RINGBUFFER_DATA_OFFSET   256
+		#define CUBICLESOFT_SYNC_RINGBUFFER_MAGIC   0x52420000
+
+		// Record states are stored in the low bits of the record position.  Positions are always 16 byte aligned.
+		#define CUBICLESOFT_SYNC_RINGBUFFER_READY   1
+		#define CUBICLESOFT_SYNC_RINGBUFFER_DONE   2
+		#define CUBICLESOFT_SYNC_RINGBUFFER_STATE_MASK   15
+
+		// Padding records fill the space at the end of the ring when a record does not fit.
+		#define CUBICLESOFT_SYNC_RINGBUFFER_PAD   1
+
+		RingBuffer::RingBuffer() : MxSharedMem(NULL), MxLocalMem(NULL), MxMulti(false), MxCapacity(0), MxInfo(NULL), MxWritePos(NULL), MxReadPos(NULL), MxReclaimPos(NULL), MxData(NULL)
+		{
+		}
+
+		RingBuffer::~RingBuffer()
+		{
+			Free();
+		}
+
+		void RingBuffer::Free()
+		{
+			if (MxSharedMem != NULL)  delete MxSharedMem;
+			if (MxLocalMem != NULL)  delete[] MxLocalMem;
+
+			MxSharedMem = NULL;
+			MxLocalMem = NULL;
+			MxCapacity = 0;
+			MxInfo = NULL;
+			MxWritePos = NULL;
+			MxReadPos = NULL;
+			MxReclaimPos = NULL;
+			MxData = NULL;
+		}
+
+		bool RingBuffer::Create(const char *Name, size_t Capacity, bool MultiProducerConsumer)
+		{
+			Free();
+
+			size_t x = 64;
+			while (x < Capacity && x)  x <<= 1;
+			if (!x)  return false;
+
+			size_t TempSize = CUBICLESOFT_SYNC_RINGBUFFER_LINE_SIZE + CUBICLESOFT_SYNC_RINGBUFFER_DATA_OFFSET + x;
+			char *Mem;
+
+			if (Name == NULL)
+			{
+				MxLocalMem = new char[TempSize];
+				memset(MxLocalMem, 0, TempSize);
+				Mem = MxLocalMem;
+
+				if (!MxEvent.Create(NULL))
+				{
+					Free();
+
+					return false;
+				}
+			}
+			else
+			{
+				// New shared memory is zeroed, which is a valid empty ring.
+				MxSharedMem = new SharedMem;
+				char *Name2 = new char[strlen(Name) + 40];
+				sprintf(Name2, "%s-%u-Sync_RingBuffer", Name, (unsigned int)x);
+
+				bool Result = (MxSharedMem->Create(Name, TempSize) && MxEvent.Create(Name2));
+
+				delete[] Name2;
+
+				if (!Result)
+				{
+					Free();
+
+					return false;
+				}
+
+				Mem = MxSharedMem->RawData();
+			}
+
+			// Align to a cache line.
+			Mem += (CUBICLESOFT_SYNC_RINGBUFFER_LINE_SIZE - ((size_t)Mem % CUBICLESOFT_SYNC_RINGBUFFER_LINE_SIZE)) % CUBICLESOFT_SYNC_RINGBUFFER_LINE_SIZE;
+
+			MxInfo = (volatile std::uint32_t *)Mem;
+			MxWritePos = (volatile std::uint64_t *)(Mem + CUBICLESOFT_SYNC_RINGBUFFER_LINE_SIZE);
+			MxReadPos = (volatile std::uint64_t *)(Mem + CUBICLESOFT_SYNC_RINGBUFFER_LINE_SIZE * 2);
+			MxReclaimPos = (volatile std::uint64_t *)(Mem + CUBICLESOFT_SYNC_RINGBUFFER_LINE_SIZE * 3);
+			MxData = Mem + CUBICLESOFT_SYNC_RINGBUFFER_DATA_OFFSET;
+			MxCapacity = x;
+			MxMulti = MultiProducerConsumer;
+
+			// The first process to get here decides the mode.  Everyone else has to agree with it.
+			std::uint32_t Info = CUBICLESOFT_SYNC_RINGBUFFER_MAGIC | (MxMulti ? 1 : 0);
+			std::uint32_t PrevInfo = Util::AtomicCompareExchange32(MxInfo, Info, 0);
+			if (PrevInfo != 0 && PrevInfo != Info)
+			{
+				Free();
+
+				return false;
+			}
+
+			return true;
+		}
+
+		void *RingBuffer::Reserve(size_t Size)
+		{
+			if (MxData == NULL || Size > GetMaxRecordSize())  return NULL;
+
+			std::uint64_t Total = 16 + ((Size + 15) & ~((size_t)15));
+			std::uint64_t Mask = MxCapacity - 1;
+			std::uint64_t ReclaimPos, WritePos, Pad;
+
+			do
+			{
+				// Load the reclaim position first so that it can't pass a stale write position.
+				ReclaimPos = *MxReclaimPos;
+				Util::AcquireFence();
+				WritePos = *MxWritePos;
+
+				Pad = ((WritePos & Mask) + Total > MxCapacity ? MxCapacity - (WritePos & Mask) : 0);
+				if (WritePos + Pad + Total - ReclaimPos > MxCapacity)  return NULL;
+
+				if (!MxMulti)
+				{
+					*MxWritePos = WritePos + Pad + Total;
+
+					break;
+				}
+			} while (Util::AtomicCompareExchange64(MxWritePos, WritePos + Pad + Total, WritePos) != WritePos);
+
+			RecordHeader *Header;
+
+			if (Pad)
+			{
+				Header = (RecordHeader *)(MxData + (WritePos & Mask));
+				Header->MxSize = (std::uint32_t)(Pad - 16);
+				Header->MxFlags = CUBICLESOFT_SYNC_RINGBUFFER_PAD;
+				Header->MxState = WritePos;
+
+				Commit(Header + 1);
+
+				WritePos += Pad;
+			}
+
+			Header = (RecordHeader *)(MxData + (WritePos & Mask));
+			Header->MxSize = (std::uint32_t)Size;
+			Header->MxFlags = 0;
+			Header->MxState = WritePos;
+
+			return (Header + 1);
+		}
+
+		bool RingBuffer::Commit(void *Data)
+		{
+			if (MxData == NULL || Data == NULL)  return false;
+
+			RecordHeader *Header = (RecordHeader *)Data - 1;
+			std::uint64_t Pos = Header->MxState & ~((std::uint64_t)CUBICLESOFT_SYNC_RINGBUFFER_STATE_MASK);
+
+			Util::ReleaseFence();
+			Header->MxState = Pos | CUBICLESOFT_SYNC_RINGBUFFER_READY;
+
+			// Only wake a consumer when one could be stuck on this record.  Pairs with the fence after moving the read position.
+			Util::FullFence();
+			if (*MxReadPos == Pos)  MxEvent.Fire();
+
+			return true;
+		}
+
+		void *RingBuffer::Peek(size_t &Size)
+		{
+			return InternalPeek(Size, (size_t)-1);
+		}
+
+		void *RingBuffer::InternalPeek(size_t &Size, size_t MaxSize)
+		{
+			Size = 0;
+			if (MxData == NULL)  return NULL;
+
+			std::uint64_t Mask = MxCapacity - 1;
+			std::uint64_t ReadPos, Total;
+			RecordHeader *Header;
+
+			do
+			{
+				ReadPos = *MxReadPos;
+				Header = (RecordHeader *)(MxData + (ReadPos & Mask));
+				if (Header->MxState != (ReadPos | CUBICLESOFT_SYNC_RINGBUFFER_READY))
+				{
+					if (MxMulti && *MxReadPos != ReadPos)  continue;
+
+					return NULL;
+				}
+
+				Util::AcquireFence();
+				Total = 16 + ((Header->MxSize + 15) & ~((std::uint64_t)15));
+
+				// Records larger than MaxSize are left unclaimed.  With multiple consumers, the size is only valid if no one else claimed the record first.
+				if (!(Header->MxFlags & CUBICLESOFT_SYNC_RINGBUFFER_PAD) && Header->MxSize > MaxSize)
+				{
+					if (MxMulti && *MxReadPos != ReadPos)  continue;
+
+					Size = Header->MxSize;
+
+					return NULL;
+				}
+
+				// The single consumer advances the read position in Release().
+				if (!MxMulti)
+				{
+					if (!(Header->MxFlags & CUBICLESOFT_SYNC_RINGBUFFER_PAD))  break;
+
+					ReleaseRecord(Header);
+
+					continue;
+				}
+
+				// Claim the record.
+				if (Util::AtomicCompareExchange64(MxReadPos, ReadPos + Total, ReadPos) != ReadPos)  continue;
+
+				if (!(Header->MxFlags & CUBICLESOFT_SYNC_RINGBUFFER_PAD))  break;
+
+				ReleaseRecord(Header);
+			} while (1);
+
+			Size = Header->MxSize;
+
+			return (Header + 1);
+		}
+
+		bool RingBuffer::Release(void *Data)
+		{
+			if (MxData == NULL || Data == NULL)  return false;
+
+			return ReleaseRecord((RecordHeader *)Data - 1);
+		}
+
+		bool RingBuffer::ReleaseRecord(RecordHeader *Header)
+		{
+			std::uint64_t Pos = Header->MxState & ~((std::uint64_t)CUBICLESOFT_SYNC_RINGBUFFER_STATE_MASK);
+
+			// Finish reading the record before the space can be reused.
+			Util::ReleaseFence();
+
+			if (!MxMulti)
+			{
+				std::uint64_t Total = 16 + ((Header->MxSize + 15) & ~((std::uint64_t)15));
+
+				*MxReadPos = Pos + Total;
+				*MxReclaimPos = Pos + Total;
+
+				// Pairs with the fence in Commit().
+				Util::FullFence();
+
+				return true;
+			}
+
+			// Consumers may finish out of order.  Mark the record done and advance the reclaim position over every finished record.
+			// The fence keeps the reclaim position from being loaded before the store is visible.  Otherwise, this consumer and the one that
+			// reclaims up to this record could both stop, leaving the record unreclaimed.
+			Header->MxState = Pos | CUBICLESOFT_SYNC_RINGBUFFER_DONE;
+			Util::FullFence();
+
+			Reclaim();
+
+			return true;
+		}
+
+		void RingBuffer::Reclaim()
+		{
+			std::uint64_t Mask = MxCapacity - 1;
+			std::uint64_t ReclaimPos, Total;
+			RecordHeader *Header;
+
+			do
+			{
+				ReclaimPos = *MxReclaimPos;
+				Header = (RecordHeader *)(MxData + (ReclaimPos & Mask));
+				if (Header->MxState != (ReclaimPos | CUBICLESOFT_SYNC_RINGBUFFER_DONE))  break;
+
+				// If another consumer already moved past this record, the size may be garbage but the exchange fails.
+				Util::AcquireFence();
+				Total = 16 + ((Header->MxSize + 15) & ~((std::uint64_t)15));
+
+				Util::AtomicCompareExchange64(MxReclaimPos, ReclaimPos + Total, ReclaimPos);
+			} while (1);
+		}
+
+		bool RingBuffer::Write(const void *Data, size_t Size)
+		{
+			void *Data2 = Reserve(Size);
+			if (Data2 == NULL)  return false;
+
+			memcpy(Data2, Data, Size);
+
+			return Commit(Data2);
+		}
+
+		bool RingBuffer::Read(void *Data, size_t &Size)
+		{
+			if (MxData == NULL)  return false;
+
+			// The size is checked before the record is claimed.  Size2 is 0 when the ring is empty.
+			size_t Size2;
+			void *Data2 = InternalPeek(Size2, Size);
+			if (Data2 == NULL)
+			{
+				Size = Size2;
+
+				return false;
+			}
+
+			memcpy(Data, Data2, Size2);
+			Size = Size2;
+
+			return Release(Data2);
+		}
+
+		bool RingBuffer::WaitNS(std::uint64_t WaitNS)
+		{
+			if (MxData == NULL)  return false;
+
+			std::uint64_t ReadPos, StartTime = 0, Elapsed;
+			RecordHeader *Header;
+
+			do
+			{
+				ReadPos = *MxReadPos;
+				Header = (RecordHeader *)(MxData + (ReadPos & (MxCapacity - 1)));
+				if (Header->MxState == (ReadPos | CUBICLESOFT_SYNC_RINGBUFFER_READY))  return true;
+
+				if (WaitNS == INFINITE_NS)  Elapsed = 0;
+				else if (!StartTime)
+				{
+					StartTime = Util::GetMonotonicNanosecondTime();
+					Elapsed = 0;
+				}
+				else
+				{
+					Elapsed = Util::GetMonotonicNanosecondTime() - StartTime;
+					if (Elapsed >= WaitNS)  return false;
+				}
+
+				if (MxEvent.WaitNS(WaitNS == INFINITE_NS ? INFINITE_NS : WaitNS - Elapsed) && MxMulti)
+				{
+					// Pass the wake up along to another waiting consumer.
+					ReadPos = *MxReadPos;
+					Header = (RecordHeader *)(MxData + (ReadPos & (MxCapacity - 1)));
+					if (Header->MxState == (ReadPos | CUBICLESOFT_SYNC_RINGBUFFER_READY))
+					{
+						MxEvent.Fire();
+
+						return true;
+					}
+				}
+			} while (1);
+		}
+	}
+}
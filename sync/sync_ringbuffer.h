@@ -0,0 +1,83 @@
+// Cross-platform, optionally named (cross-process), lock-free bounded ring buffer of variable length records.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#ifndef CUBICLESOFT_SYNC_RINGBUFFER
+#define CUBICLESOFT_SYNC_RINGBUFFER
+
+#include "sync_sharedmem.h"
+#include "sync_event.h"
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		// Producers Reserve() space, fill it in place, and Commit() it.  Consumers Peek() at the next record and Release() it when done.
+		// Neither side takes a lock.  The internal event is only fired when a consumer may be waiting on an empty ring.
+		// Single producer/single consumer mode avoids all compare and swap operations.
+		// Multiple producer/multiple consumer mode allows any number of threads/processes on either side.
+		class RingBuffer
+		{
+		public:
+			RingBuffer();
+			~RingBuffer();
+
+			// Capacity is rounded up to a power of two.  Every process must use the same Name, Capacity, and mode.
+			bool Create(const char *Name, size_t Capacity, bool MultiProducerConsumer = false);
+
+			inline size_t GetCapacity()  { return MxCapacity; }
+			inline size_t GetMaxRecordSize()  { return (MxCapacity ? MxCapacity / 2 - 16 : 0); }
+			inline bool IsMultiProducerConsumer()  { return MxMulti; }
+
+			// Returns NULL when the ring is full or Size is larger than GetMaxRecordSize().
+			// Returned memory is 16 byte aligned and must be passed to Commit() before the next Reserve() on the same thread.
+			void *Reserve(size_t Size);
+			bool Commit(void *Data);
+
+			// Returns NULL when the ring is empty.  In multiple consumer mode, the record is claimed by the caller.
+			// Records are returned in order of reservation.  A reserved but uncommitted record blocks the ones after it.
+			void *Peek(size_t &Size);
+			bool Release(void *Data);
+
+			// Copying convenience functions.  Read() fails without consuming the record if it is larger than Size and sets Size to the required size.
+			bool Write(const void *Data, size_t Size);
+			bool Read(void *Data, size_t &Size);
+
+			// Waits for the ring to become non-empty.  Wait is in milliseconds.
+			inline bool Wait(std::uint32_t Wait = INFINITE)  { return WaitNS(Util::GetWaitNS(Wait)); }
+			bool WaitNS(std::uint64_t WaitNS);
+
+		private:
+			// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+			RingBuffer(const RingBuffer &);
+			RingBuffer &operator=(const RingBuffer &);
+
+			class RecordHeader
+			{
+			public:
+				// Absolute position of the record | state.
+				volatile std::uint64_t MxState;
+				std::uint32_t MxSize;
+				std::uint32_t MxFlags;
+			};
+
+			void Free();
+			void *InternalPeek(size_t &Size, size_t MaxSize);
+			bool ReleaseRecord(RecordHeader *Header);
+			void Reclaim();
+
+			SharedMem *MxSharedMem;
+			char *MxLocalMem;
+			Event MxEvent;
+
+			bool MxMulti;
+			size_t MxCapacity;
+			volatile std::uint32_t *MxInfo;
+			volatile std::uint64_t *MxWritePos;
+			volatile std::uint64_t *MxReadPos;
+			volatile std::uint64_t *MxReclaimPos;
+			char *MxData;
+		};
+	}
+}
+
+#endif
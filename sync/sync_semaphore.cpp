@@ -37,11 +37,11 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool Semaphore::Lock(std::uint32_t Wait)
+		bool Semaphore::LockNS(std::uint64_t WaitNS)
 		{
 			if (MxWinSemaphore == NULL)  return false;
 
-			DWORD Result = ::WaitForSingleObject(MxWinSemaphore, Wait);
+			DWORD Result = ::WaitForSingleObject(MxWinSemaphore, Util::GetWaitMS(WaitNS));
 			if (Result != WAIT_OBJECT_0)  return false;
 
 			return true;
@@ -111,12 +111,12 @@ namespace CubicleSoft
 			return true;
 		}
 
-		bool Semaphore::Lock(std::uint32_t Wait)
+		bool Semaphore::LockNS(std::uint64_t WaitNS)
 		{
 			if (MxMem == NULL)  return false;
 
 			// Wait for the semaphore.
-			return Util::WaitForUnixSemaphore(MxPthreadSemaphore, Wait);
+			return Util::WaitForUnixSemaphoreNS(MxPthreadSemaphore, WaitNS);
 		}
 
 		bool Semaphore::Unlock(int *PrevCount)
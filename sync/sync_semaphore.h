@@ -12,6 +12,7 @@ namespace CubicleSoft
 	{
 		class Semaphore
 		{
+			friend class WaitMultiple;
 		public:
 			Semaphore();
 			~Semaphore();
@@ -19,7 +20,8 @@ namespace CubicleSoft
 			bool Create(const char *Name = NULL, int InitialVal = 1);
 
 			// Wait is in milliseconds.  Granularity is in 5ms intervals on some platforms.
-			bool Lock(std::uint32_t Wait = INFINITE);
+			inline bool Lock(std::uint32_t Wait = INFINITE)  { return LockNS(Util::GetWaitNS(Wait)); }
+			bool LockNS(std::uint64_t WaitNS);
 
 			// Should only be called after a successful Lock().  Undefined behavior otherwise.
 			bool Unlock(int *PrevCount = NULL);
@@ -0,0 +1,226 @@
+// Cross-platform, optionally named (cross-process), sequence lock.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "sync_seqlock.h"
+#include <cstring>
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+	#include <cstdio>
+#endif
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		// Keep the data off of the cache line of the sequence counter.
+		#define CUBICLESOFT_SYNC_SEQLOCK_DATA_OFFSET   64
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+		// Windows.
+		SeqLock::SeqLock() : MxWinFile(NULL), MxMem(NULL), MxDataSize(0), MxSeq(NULL), MxData(NULL)
+		{
+		}
+
+		void SeqLock::Free()
+		{
+			if (MxWinFile != NULL)
+			{
+				if (MxMem != NULL)  ::UnmapViewOfFile(MxMem);
+				::CloseHandle(MxWinFile);
+			}
+			else if (MxMem != NULL)
+			{
+				delete[] MxMem;
+			}
+
+			MxWinFile = NULL;
+			MxMem = NULL;
+			MxSeq = NULL;
+			MxData = NULL;
+		}
+
+		bool SeqLock::Create(const char *Name, size_t DataSize)
+		{
+			Free();
+
+			size_t TempSize = CUBICLESOFT_SYNC_SEQLOCK_DATA_OFFSET + DataSize;
+
+			if (Name == NULL)
+			{
+				MxMem = new char[TempSize];
+				memset(MxMem, 0, TempSize);
+			}
+			else
+			{
+				SECURITY_ATTRIBUTES SecAttr;
+
+				SecAttr.nLength = sizeof(SecAttr);
+				SecAttr.lpSecurityDescriptor = NULL;
+				SecAttr.bInheritHandle = TRUE;
+
+				char *Name2 = new char[strlen(Name) + 30];
+
+				// Create the file mapping object backed by the system page file.  New mappings are zero-filled.
+				sprintf(Name2, "%s-%u-Sync_SeqLock", Name, (unsigned int)DataSize);
+				MxWinFile = ::CreateFileMappingA(INVALID_HANDLE_VALUE, &SecAttr, PAGE_READWRITE, 0, (DWORD)TempSize, Name2);
+				if (MxWinFile == NULL)  MxWinFile = ::OpenFileMappingA(FILE_MAP_ALL_ACCESS, TRUE, Name2);
+
+				delete[] Name2;
+
+				if (MxWinFile == NULL)  return false;
+
+				MxMem = (char *)::MapViewOfFile(MxWinFile, FILE_MAP_ALL_ACCESS, 0, 0, TempSize);
+				if (MxMem == NULL)
+				{
+					Free();
+
+					return false;
+				}
+			}
+
+			MxDataSize = DataSize;
+			MxSeq = reinterpret_cast<volatile std::uint32_t *>(MxMem);
+			MxData = MxMem + CUBICLESOFT_SYNC_SEQLOCK_DATA_OFFSET;
+
+			return true;
+		}
+#else
+		// POSIX pthreads.
+		SeqLock::SeqLock() : MxNamed(false), MxMem(NULL), MxDataSize(0), MxSeq(NULL), MxData(NULL)
+		{
+		}
+
+		void SeqLock::Free()
+		{
+			if (MxMem != NULL)
+			{
+				if (MxNamed)  Util::UnmapUnixNamedMem(MxMem, CUBICLESOFT_SYNC_SEQLOCK_DATA_OFFSET + MxDataSize);
+				else  delete[] MxMem;
+			}
+
+			MxNamed = false;
+			MxMem = NULL;
+			MxSeq = NULL;
+			MxData = NULL;
+		}
+
+		bool SeqLock::Create(const char *Name, size_t DataSize)
+		{
+			Free();
+
+			size_t Pos, TempSize = CUBICLESOFT_SYNC_SEQLOCK_DATA_OFFSET + DataSize;
+			MxNamed = (Name != NULL);
+			int Result = Util::InitUnixNamedMem(MxMem, Pos, "/Sync_SeqLock", Name, TempSize);
+
+			if (Result < 0)
+			{
+				MxNamed = false;
+
+				return false;
+			}
+
+			// Load the pointers.  The named memory header is padded to keep the counter aligned.
+			MxDataSize = DataSize;
+			MxSeq = reinterpret_cast<volatile std::uint32_t *>(MxMem + Pos);
+			MxData = MxMem + Pos + CUBICLESOFT_SYNC_SEQLOCK_DATA_OFFSET;
+
+			// Handle the first time this sequence lock has been opened.
+			if (Result == 0)
+			{
+				MxSeq[0] = 0;
+				memset(MxData, 0, DataSize);
+
+				if (MxNamed)  Util::UnixNamedMemReady(MxMem);
+			}
+
+			return true;
+		}
+#endif
+
+		// All platforms.
+		SeqLock::~SeqLock()
+		{
+			Free();
+		}
+
+		bool SeqLock::Read(void *Dest)
+		{
+			if (MxSeq == NULL)  return false;
+
+			std::uint32_t Seq;
+			do
+			{
+				Seq = ReadBegin();
+				memcpy(Dest, MxData, MxDataSize);
+			} while (ReadRetry(Seq));
+
+			return true;
+		}
+
+		bool SeqLock::Write(const void *Src)
+		{
+			if (!WriteLock())  return false;
+
+			memcpy(MxData, Src, MxDataSize);
+
+			return WriteUnlock();
+		}
+
+		std::uint32_t SeqLock::ReadBegin()
+		{
+			std::uint32_t Seq;
+
+			// An odd sequence number means a write is in progress.
+			while ((Seq = MxSeq[0]) & 1)  Util::CPUPause();
+
+			Util::AcquireFence();
+
+			return Seq;
+		}
+
+		bool SeqLock::ReadRetry(std::uint32_t Seq)
+		{
+			Util::AcquireFence();
+
+			return (MxSeq[0] != Seq);
+		}
+
+		bool SeqLock::WriteLockNS(std::uint64_t WaitNS)
+		{
+			if (MxSeq == NULL)  return false;
+
+			std::uint64_t StartTime = 0;
+			std::uint32_t Seq;
+			size_t x = 0;
+
+			do
+			{
+				Seq = MxSeq[0];
+				if (!(Seq & 1) && Util::AtomicCompareExchange32(MxSeq, Seq + 1, Seq) == Seq)  return true;
+				if (WaitNS == 0)  return false;
+
+				Util::CPUPause();
+
+				// Check the timeout every so often.
+				x++;
+				if (WaitNS != INFINITE_NS && !(x & 0x3F))
+				{
+					if (!StartTime)  StartTime = Util::GetMonotonicNanosecondTime();
+					else if (Util::GetMonotonicNanosecondTime() - StartTime >= WaitNS)  return false;
+				}
+			} while (1);
+		}
+
+		bool SeqLock::WriteUnlock()
+		{
+			if (MxSeq == NULL || !(MxSeq[0] & 1))  return false;
+
+			Util::ReleaseFence();
+			Util::AtomicAdd32(MxSeq, 1);
+
+			return true;
+		}
+	}
+}
@@ -0,0 +1,66 @@
+// Cross-platform, optionally named (cross-process), sequence lock.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#ifndef CUBICLESOFT_SYNC_SEQLOCK
+#define CUBICLESOFT_SYNC_SEQLOCK
+
+#include "sync_util.h"
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		// Readers never write to shared memory.  They take a snapshot and retry if a writer was active at the same time.
+		// Best suited to small, frequently updated data with many readers.
+		class SeqLock
+		{
+		public:
+			SeqLock();
+			~SeqLock();
+
+			// DataSize bytes of storage are allocated after the sequence counter for use with Read() and Write().
+			bool Create(const char *Name = NULL, size_t DataSize = 0);
+
+			inline size_t GetSize()  { return MxDataSize; }
+			inline char *RawData()  { return MxData; }
+
+			// Copies a consistent snapshot of the internal storage to Dest (DataSize bytes).
+			bool Read(void *Dest);
+
+			// Replaces the internal storage with Src (DataSize bytes).
+			bool Write(const void *Src);
+
+			// For data stored elsewhere (e.g. Sync::SharedMem).  Copy the data between ReadBegin() and ReadRetry() and loop until ReadRetry() returns false.
+			// Do not follow pointers within the data until ReadRetry() returns false.
+			std::uint32_t ReadBegin();
+			bool ReadRetry(std::uint32_t Seq);
+
+			// Writers exclude each other.  Wait is in milliseconds.
+			inline bool WriteLock(std::uint32_t Wait = INFINITE)  { return WriteLockNS(Util::GetWaitNS(Wait)); }
+
+			// Spins while waiting, so WaitNS isn't rounded to milliseconds on Windows.
+			bool WriteLockNS(std::uint64_t WaitNS);
+			bool WriteUnlock();
+
+		private:
+			// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+			SeqLock(const SeqLock &);
+			SeqLock &operator=(const SeqLock &);
+
+			void Free();
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			HANDLE MxWinFile;
+#else
+			bool MxNamed;
+#endif
+
+			char *MxMem;
+			size_t MxDataSize;
+			volatile std::uint32_t *MxSeq;
+			char *MxData;
+		};
+	}
+}
+
+#endif
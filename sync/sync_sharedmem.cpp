@@ -8,6 +8,18 @@
 #if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
 	#include <cstdio>
 #else
+	#include <sys/mman.h>
+	#include <unistd.h>
+
+	#ifdef __linux__
+		#include <sys/syscall.h>
+
+		// From numaif.h, which is part of libnuma and frequently not installed.
+		#ifndef MPOL_BIND
+			#define MPOL_BIND   2
+			#define MPOL_INTERLEAVE   3
+		#endif
+	#endif
 #endif
 
 namespace CubicleSoft
@@ -16,7 +28,7 @@ namespace CubicleSoft
 	{
 #if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
 		// Windows.
-		SharedMem::SharedMem() : MxFirst(false), MxSize(0), MxMem(NULL), MxFile(NULL)
+		SharedMem::SharedMem() : MxFirst(false), MxActiveOptions(0), MxSize(0), MxMem(NULL), MxFile(NULL)
 		{
 		}
 
@@ -26,7 +38,7 @@ namespace CubicleSoft
 			if (MxFile != NULL)  ::CloseHandle(MxFile);
 		}
 
-		bool SharedMem::Create(const char *Name, size_t Size)
+		bool SharedMem::Create(const char *Name, size_t Size, std::uint32_t Options, std::uint64_t NumaNodeMask)
 		{
 			if (Name == NULL)  return false;
 
@@ -36,6 +48,7 @@ namespace CubicleSoft
 			MxMem = NULL;
 			MxFile = NULL;
 			MxFirst = false;
+			MxActiveOptions = 0;
 
 			SECURITY_ATTRIBUTES SecAttr;
 
@@ -47,7 +60,27 @@ namespace CubicleSoft
 
 			// Create the file mapping object backed by the system page file.
 			sprintf(Name2, "%s-%u-Sync_SharedMem", Name, (unsigned int)Size);
-			MxFile = ::CreateFileMappingA(INVALID_HANDLE_VALUE, &SecAttr, PAGE_READWRITE, 0, (DWORD)Size, Name2);
+
+			// Only the preferred node is supported.
+			DWORD NumaNode = NUMA_NO_PREFERRED_NODE;
+			if ((Options & OptionNumaBind) && NumaNodeMask)
+			{
+				for (NumaNode = 0; !(NumaNodeMask & ((std::uint64_t)1 << NumaNode)); NumaNode++)
+				{
+				}
+			}
+
+			// Large pages require the mapping size to be a multiple of the large page size.
+			size_t LargePageSize = ((Options & OptionLargePages) ? ::GetLargePageMinimum() : 0);
+			if (LargePageSize)
+			{
+				size_t Size2 = (Size + LargePageSize - 1) / LargePageSize * LargePageSize;
+
+				MxFile = ::CreateFileMappingNumaA(INVALID_HANDLE_VALUE, &SecAttr, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES, 0, (DWORD)Size2, Name2, NumaNode);
+				if (MxFile != NULL)  MxActiveOptions |= OptionLargePages;
+			}
+
+			if (MxFile == NULL)  MxFile = ::CreateFileMappingNumaA(INVALID_HANDLE_VALUE, &SecAttr, PAGE_READWRITE, 0, (DWORD)Size, Name2, NumaNode);
 			if (MxFile == NULL)
 			{
 				MxFile = ::OpenFileMappingA(FILE_MAP_ALL_ACCESS, TRUE, Name2);
@@ -56,6 +89,12 @@ namespace CubicleSoft
 			else if (::GetLastError() != ERROR_ALREADY_EXISTS)
 			{
 				MxFirst = true;
+
+				if (NumaNode != NUMA_NO_PREFERRED_NODE)  MxActiveOptions |= OptionNumaBind;
+			}
+			else
+			{
+				MxActiveOptions &= ~OptionLargePages;
 			}
 
 			delete[] Name2;
@@ -65,12 +104,30 @@ namespace CubicleSoft
 
 			MxSize = Size;
 
+			if (Options & OptionPrefault)
+			{
+				Prefault();
+
+				MxActiveOptions |= OptionPrefault;
+			}
+
+			if ((Options & OptionLock) && ::VirtualLock(MxMem, MxSize))  MxActiveOptions |= OptionLock;
+
 			return true;
 		}
 
+		void SharedMem::Prefault()
+		{
+			SYSTEM_INFO SysInfo;
+
+			::GetSystemInfo(&SysInfo);
+
+			for (size_t x = 0; x < MxSize; x += SysInfo.dwPageSize)  (void)((volatile char *)MxMem)[x];
+		}
+
 #else
 		// POSIX pthreads.
-		SharedMem::SharedMem() : MxFirst(false), MxSize(0), MxMem(NULL), MxMemInternal(NULL)
+		SharedMem::SharedMem() : MxFirst(false), MxActiveOptions(0), MxSize(0), MxMem(NULL), MxMemInternal(NULL)
 		{
 		}
 
@@ -79,7 +136,7 @@ namespace CubicleSoft
 			if (MxMemInternal != NULL)  Util::UnmapUnixNamedMem(MxMemInternal, MxSize);
 		}
 
-		bool SharedMem::Create(const char *Name, size_t Size)
+		bool SharedMem::Create(const char *Name, size_t Size, std::uint32_t Options, std::uint64_t NumaNodeMask)
 		{
 			if (Name == NULL)  return false;
 
@@ -87,6 +144,8 @@ namespace CubicleSoft
 
 			MxMemInternal = NULL;
 			MxMem = NULL;
+			MxFirst = false;
+			MxActiveOptions = 0;
 
 			size_t Pos, TempSize = Size;
 			int Result = Util::InitUnixNamedMem(MxMemInternal, Pos, "/Sync_SharedMem", Name, TempSize);
@@ -97,16 +156,58 @@ namespace CubicleSoft
 			MxMem = MxMemInternal + Pos;
 			MxSize = Size;
 
+			// The whole mapping, which starts on a page boundary.
+			size_t MapSize = Pos + Size;
+
 			// Handle the first time this named memory has been opened.
 			if (Result == 0)
 			{
+				// Page placement only applies to pages that haven't been touched yet.  InitUnixNamedMem() already wrote the header, so the first page
+				// was placed by first touch and isn't bound.
+#ifdef __linux__
+				// Masks with nodes that don't fit in an unsigned long (e.g. nodes 32 to 63 on 32-bit builds) aren't applied.
+				// The kernel ignores the last bit of maxnode, hence the + 1.
+				if ((Options & (OptionNumaInterleave | OptionNumaBind)) && NumaNodeMask && NumaNodeMask == (std::uint64_t)(unsigned long)NumaNodeMask)
+				{
+					unsigned long NodeMask = (unsigned long)NumaNodeMask;
+					int Mode = ((Options & OptionNumaInterleave) ? MPOL_INTERLEAVE : MPOL_BIND);
+
+					if (syscall(SYS_mbind, MxMemInternal, MapSize, Mode, &NodeMask, sizeof(NodeMask) * 8 + 1, 0) == 0)  MxActiveOptions |= (Options & OptionNumaInterleave ? OptionNumaInterleave : OptionNumaBind);
+				}
+#endif
+
+#ifdef MADV_HUGEPAGE
+				if ((Options & (OptionHugePages | OptionLargePages)) && madvise(MxMemInternal, MapSize, MADV_HUGEPAGE) == 0)  MxActiveOptions |= OptionHugePages;
+#endif
+
 				Util::UnixNamedMemReady(MxMemInternal);
 
 				MxFirst = true;
 			}
 
+			if (Options & OptionPrefault)
+			{
+				Prefault();
+
+				MxActiveOptions |= OptionPrefault;
+			}
+
+			if ((Options & OptionLock) && mlock(MxMemInternal, MapSize) == 0)  MxActiveOptions |= OptionLock;
+
 			return true;
 		}
+
+		void SharedMem::Prefault()
+		{
+#ifdef MADV_POPULATE_WRITE
+			if (madvise(MxMemInternal, (size_t)(MxMem - MxMemInternal) + MxSize, MADV_POPULATE_WRITE) == 0)  return;
+#endif
+
+			// Reading a page of shared memory is enough to fault it in.
+			size_t PageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+			for (size_t x = 0; x < MxSize; x += PageSize)  (void)((volatile char *)MxMem)[x];
+		}
 #endif
 	}
 }
@@ -13,12 +13,33 @@ namespace CubicleSoft
 		class SharedMem
 		{
 		public:
+			// Creation options.  Each one is a best effort request.  Use GetActiveOptions() to find out which ones took effect.
+			enum OptionFlags
+			{
+				// Transparent huge pages (*NIX madvise()).
+				OptionHugePages = 0x01,
+				// Explicit large pages (Windows SEC_LARGE_PAGES, requires SeLockMemoryPrivilege).  Falls back to transparent huge pages elsewhere.
+				OptionLargePages = 0x02,
+				// Fault in every page during Create() instead of on first access.
+				OptionPrefault = 0x04,
+				// Lock the pages into RAM (mlock()/VirtualLock()).
+				OptionLock = 0x08,
+				// Interleave pages across the NUMA nodes in NumaNodeMask (Linux only).
+				OptionNumaInterleave = 0x10,
+				// Place pages on the NUMA nodes in NumaNodeMask (Linux) or the first node in NumaNodeMask (Windows).
+				OptionNumaBind = 0x20
+			};
+
 			SharedMem();
 			~SharedMem();
 
 			// For platform consistency, Name + Size is a unique key.  size_t is, of course, limited to 4GB RAM on most platforms.
 			// On some platforms (e.g. Windows), the objects may vanish if all handles are freed.
-			bool Create(const char *Name, size_t Size);
+			// Page placement options are decided by whoever creates the object.  Later callers can only prefault and lock their own view.
+			// On Linux, NUMA placement doesn't apply to the first page of the object, which is touched while the object is being set up.
+			bool Create(const char *Name, size_t Size, std::uint32_t Options = 0, std::uint64_t NumaNodeMask = 0);
+
+			inline std::uint32_t GetActiveOptions()  { return MxActiveOptions; }
 
 			// Returns true if Create() created the shared memory object, false otherwise (i.e. opened an existing object).
 			inline bool First()  { return MxFirst; }
@@ -31,7 +52,10 @@ namespace CubicleSoft
 			SharedMem(const SharedMem &);
 			SharedMem &operator=(const SharedMem &);
 
+			void Prefault();
+
 			bool MxFirst;
+			std::uint32_t MxActiveOptions;
 			size_t MxSize;
 			char *MxMem;
 
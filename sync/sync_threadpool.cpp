@@ -0,0 +1,797 @@
+// Cross-platform work-stealing thread pool.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#include "sync_threadpool.h"
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+#else
+	#include <unistd.h>
+#endif
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		// Number of times an idle worker looks for work before going to sleep.
+		#define CUBICLESOFT_SYNC_THREADPOOL_SPINS   64
+
+		// Maximum number of tasks a worker moves from the shared queue into its own deque at once.
+		#define CUBICLESOFT_SYNC_THREADPOOL_BATCH   64
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+		// Windows.
+		ThreadPool::ThreadPool() : MxWorkers(NULL), MxNumWorkers(0), MxTLS(NULL), MxTLSCacheBits(15), MxStop(0), MxNumSleeping(0), MxWakePos(0), MxPending(0), MxExternal(0), MxNumShared(0)
+		{
+			MxTlsIndex = ::TlsAlloc();
+
+			InitLock(MxLock);
+		}
+
+		ThreadPool::~ThreadPool()
+		{
+			Stop();
+
+			QueueNode<Event *> *Node;
+			while ((Node = MxFreeEvents.Shift()) != NULL)
+			{
+				delete Node->Value;
+				delete Node;
+			}
+
+			FreeLock(MxLock);
+
+			::TlsFree(MxTlsIndex);
+		}
+
+		DWORD WINAPI ThreadPool::WorkerMain(LPVOID Data)
+		{
+			Worker *WorkerPtr = (Worker *)Data;
+
+			WorkerPtr->MxPool->RunWorker(WorkerPtr);
+
+			return 0;
+		}
+
+		bool ThreadPool::StartThread(Worker *WorkerPtr)
+		{
+			WorkerPtr->MxThread = ::CreateThread(NULL, 0, WorkerMain, WorkerPtr, 0, NULL);
+
+			return (WorkerPtr->MxThread != NULL);
+		}
+
+		void ThreadPool::JoinThread(Worker *WorkerPtr)
+		{
+			::WaitForSingleObject(WorkerPtr->MxThread, INFINITE);
+			::CloseHandle(WorkerPtr->MxThread);
+		}
+
+		bool ThreadPool::SetCurrentWorker(Worker *WorkerPtr)
+		{
+			return (::TlsSetValue(MxTlsIndex, WorkerPtr) != 0);
+		}
+
+		ThreadPool::Worker *ThreadPool::GetCurrentWorkerPtr()
+		{
+			return (Worker *)::TlsGetValue(MxTlsIndex);
+		}
+
+		size_t ThreadPool::GetNumCPUs()
+		{
+			SYSTEM_INFO SysInfo;
+
+			::GetSystemInfo(&SysInfo);
+
+			return (SysInfo.dwNumberOfProcessors > 0 ? (size_t)SysInfo.dwNumberOfProcessors : 1);
+		}
+
+		void ThreadPool::InitLock(LockType &Lock)
+		{
+			::InitializeCriticalSection(&Lock);
+		}
+
+		void ThreadPool::AcquireLock(LockType &Lock)
+		{
+			::EnterCriticalSection(&Lock);
+		}
+
+		void ThreadPool::ReleaseLock(LockType &Lock)
+		{
+			::LeaveCriticalSection(&Lock);
+		}
+
+		void ThreadPool::FreeLock(LockType &Lock)
+		{
+			::DeleteCriticalSection(&Lock);
+		}
+#else
+		// POSIX pthreads.
+		ThreadPool::ThreadPool() : MxWorkers(NULL), MxNumWorkers(0), MxTLS(NULL), MxTLSCacheBits(15), MxStop(0), MxNumSleeping(0), MxWakePos(0), MxPending(0), MxExternal(0), MxNumShared(0)
+		{
+			pthread_key_create(&MxKey, NULL);
+
+			InitLock(MxLock);
+		}
+
+		ThreadPool::~ThreadPool()
+		{
+			Stop();
+
+			QueueNode<Event *> *Node;
+			while ((Node = MxFreeEvents.Shift()) != NULL)
+			{
+				delete Node->Value;
+				delete Node;
+			}
+
+			FreeLock(MxLock);
+
+			pthread_key_delete(MxKey);
+		}
+
+		void *ThreadPool::WorkerMain(void *Data)
+		{
+			Worker *WorkerPtr = (Worker *)Data;
+
+			WorkerPtr->MxPool->RunWorker(WorkerPtr);
+
+			return NULL;
+		}
+
+		bool ThreadPool::StartThread(Worker *WorkerPtr)
+		{
+			return (pthread_create(&WorkerPtr->MxThread, NULL, WorkerMain, WorkerPtr) == 0);
+		}
+
+		void ThreadPool::JoinThread(Worker *WorkerPtr)
+		{
+			pthread_join(WorkerPtr->MxThread, NULL);
+		}
+
+		bool ThreadPool::SetCurrentWorker(Worker *WorkerPtr)
+		{
+			return (pthread_setspecific(MxKey, WorkerPtr) == 0);
+		}
+
+		ThreadPool::Worker *ThreadPool::GetCurrentWorkerPtr()
+		{
+			return (Worker *)pthread_getspecific(MxKey);
+		}
+
+		size_t ThreadPool::GetNumCPUs()
+		{
+			long Num = sysconf(_SC_NPROCESSORS_ONLN);
+
+			return (Num > 0 ? (size_t)Num : 1);
+		}
+
+		void ThreadPool::InitLock(LockType &Lock)
+		{
+			pthread_mutex_init(&Lock, NULL);
+		}
+
+		void ThreadPool::AcquireLock(LockType &Lock)
+		{
+			pthread_mutex_lock(&Lock);
+		}
+
+		void ThreadPool::ReleaseLock(LockType &Lock)
+		{
+			pthread_mutex_unlock(&Lock);
+		}
+
+		void ThreadPool::FreeLock(LockType &Lock)
+		{
+			pthread_mutex_destroy(&Lock);
+		}
+#endif
+
+		// Chase-Lev deque operations.  Push() and Pop() may only be called by the owner.
+		bool ThreadPool::Worker::Push(const Task &Item)
+		{
+			std::uint64_t Bottom = MxBottom;
+			if (Bottom - MxTop > MxMask)  return false;
+
+			MxTasks[Bottom & MxMask] = Item;
+
+			// Publish the task before the new bottom.
+			Util::ReleaseFence();
+			MxBottom = Bottom + 1;
+
+			return true;
+		}
+
+		bool ThreadPool::Worker::Pop(Task &Result)
+		{
+			std::uint64_t Bottom = MxBottom - 1;
+			MxBottom = Bottom;
+
+			// The new bottom has to be visible to thieves before top is read.
+			Util::FullFence();
+			std::uint64_t Top = MxTop;
+
+			if ((std::int64_t)(Bottom - Top) < 0)
+			{
+				MxBottom = Top;
+
+				return false;
+			}
+
+			Result = MxTasks[Bottom & MxMask];
+			if (Bottom != Top)  return true;
+
+			// Last task.  Race any thieves for it.
+			bool Won = (Util::AtomicCompareExchange64(&MxTop, Top + 1, Top) == Top);
+			MxBottom = Top + 1;
+
+			return Won;
+		}
+
+		bool ThreadPool::Worker::Steal(Task &Result)
+		{
+			std::uint64_t Top = MxTop;
+			Util::FullFence();
+			std::uint64_t Bottom = MxBottom;
+
+			if ((std::int64_t)(Bottom - Top) <= 0)  return false;
+
+			// The slot can't be reused by the owner until top moves past it, which the compare and swap verifies.
+			Result = MxTasks[Top & MxMask];
+
+			return (Util::AtomicCompareExchange64(&MxTop, Top + 1, Top) == Top);
+		}
+
+		bool ThreadPool::Start(size_t NumThreads, TLS *TLSPtr, size_t DequeBits, size_t TLSCacheBits)
+		{
+			if (MxWorkers != NULL)  return false;
+
+			if (!NumThreads)  NumThreads = GetNumCPUs();
+			if (DequeBits < 2)  DequeBits = 2;
+			if (DequeBits > 24)  DequeBits = 24;
+
+			MxWorkers = new Worker[NumThreads];
+			MxNumWorkers = NumThreads;
+			MxTLS = TLSPtr;
+			MxTLSCacheBits = TLSCacheBits;
+			MxStop = 0;
+
+			size_t x;
+			for (x = 0; x < NumThreads; x++)
+			{
+				MxWorkers[x].MxPool = this;
+				MxWorkers[x].MxIndex = x;
+				MxWorkers[x].MxRand = (std::uint32_t)x * 2654435761U + 1;
+				MxWorkers[x].MxMask = ((size_t)1 << DequeBits) - 1;
+				MxWorkers[x].MxTasks = new Task[(size_t)1 << DequeBits];
+
+				if (!MxWorkers[x].MxEvent.Create())
+				{
+					Stop();
+
+					return false;
+				}
+			}
+
+			for (x = 0; x < NumThreads; x++)
+			{
+				MxWorkers[x].MxStarted = StartThread(&MxWorkers[x]);
+
+				if (!MxWorkers[x].MxStarted)
+				{
+					Stop();
+
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool ThreadPool::Stop()
+		{
+			if (MxWorkers == NULL)  return false;
+
+			WaitIdle();
+
+			MxStop = 1;
+			Util::FullFence();
+
+			size_t x;
+			for (x = 0; x < MxNumWorkers; x++)  MxWorkers[x].MxEvent.Fire();
+
+			for (x = 0; x < MxNumWorkers; x++)
+			{
+				if (MxWorkers[x].MxStarted)  JoinThread(&MxWorkers[x]);
+
+				delete[] MxWorkers[x].MxTasks;
+			}
+
+			delete[] MxWorkers;
+
+			MxWorkers = NULL;
+			MxNumWorkers = 0;
+			MxNumSleeping = 0;
+
+			return true;
+		}
+
+		int ThreadPool::GetCurrentWorker()
+		{
+			Worker *WorkerPtr = GetCurrentWorkerPtr();
+
+			return (WorkerPtr != NULL ? (int)WorkerPtr->MxIndex : -1);
+		}
+
+		bool ThreadPool::Submit(TaskFunc Func, void *Data)
+		{
+			return SubmitBatch(Func, &Data, 1);
+		}
+
+		bool ThreadPool::SubmitBatch(TaskFunc Func, void **DataArray, size_t Num)
+		{
+			return PushTasks(Func, DataArray, NULL, Num);
+		}
+
+		bool ThreadPool::PushTasks(TaskFunc Func, void **DataArray, void *Data, size_t Num)
+		{
+			if (MxWorkers == NULL || Func == NULL)  return false;
+			if (!Num)  return true;
+
+			Util::AtomicAdd32(&MxPending, (std::uint32_t)Num);
+
+			Worker *WorkerPtr = GetCurrentWorkerPtr();
+			Task TempTask;
+			size_t x = 0;
+
+			TempTask.MxFunc = Func;
+
+			// Workers push onto their own deque first.
+			if (WorkerPtr != NULL)
+			{
+				for (; x < Num; x++)
+				{
+					TempTask.MxData = (DataArray != NULL ? DataArray[x] : Data);
+
+					if (!WorkerPtr->Push(TempTask))  break;
+				}
+			}
+
+			if (x < Num)
+			{
+				QueueNode<Task> *Node;
+
+				AcquireLock(MxLock);
+
+				for (; x < Num; x++)
+				{
+					Node = MxFreeNodes.Shift();
+					if (Node == NULL)  Node = Queue<Task>::CreateNode();
+
+					Node->Value.MxFunc = Func;
+					Node->Value.MxData = (DataArray != NULL ? DataArray[x] : Data);
+
+					MxShared.Push(Node);
+				}
+
+				MxNumShared = (std::uint32_t)MxShared.GetSize();
+
+				ReleaseLock(MxLock);
+			}
+
+			Wake(Num);
+
+			return true;
+		}
+
+		bool ThreadPool::ParallelFor(size_t Num, size_t ChunkSize, RangeFunc Func, void *Data)
+		{
+			if (Func == NULL)  return false;
+			if (!Num)  return true;
+			if (!ChunkSize)  ChunkSize = 1;
+
+			// Keep the number of chunks within the range of the 32-bit atomic counters.
+			if ((Num - 1) / ChunkSize >= 0x7FFFFFFF)  ChunkSize = Num / 0x7FFFFFFF + 1;
+
+			ParallelForInfo Info;
+			Info.MxFunc = Func;
+			Info.MxData = Data;
+			Info.MxNum = Num;
+			Info.MxChunkSize = ChunkSize;
+			Info.MxNumChunks = (std::uint32_t)((Num - 1) / ChunkSize + 1);
+			Info.MxNextChunk = 0;
+
+			size_t NumRunners = (MxWorkers != NULL ? Info.MxNumChunks - 1 : 0);
+			if (NumRunners > MxNumWorkers)  NumRunners = MxNumWorkers;
+
+			if (!NumRunners)
+			{
+				Func(0, Num, Data);
+
+				return true;
+			}
+
+			AcquireLock(MxLock);
+			Info.MxEvent = AllocEvent();
+			ReleaseLock(MxLock);
+
+			// Without an event to wait on, the caller would have to spin until the runners finish.
+			if (Info.MxEvent == NULL)
+			{
+				Func(0, Num, Data);
+
+				return true;
+			}
+
+			Info.MxRefs = (std::uint32_t)NumRunners + 1;
+
+			PushTasks(ParallelForTask, NULL, &Info, NumRunners);
+
+			RunChunks(&Info);
+
+			// Unless the caller finishes last, the last runner fires the event.  Help out with other tasks in the meantime.
+			if (Util::AtomicAdd32(&Info.MxRefs, (std::uint32_t)-1) != 0)
+			{
+				Worker *WorkerPtr = GetCurrentWorkerPtr();
+
+				while (!Info.MxEvent->Wait(0))
+				{
+					if (!RunOne(WorkerPtr))
+					{
+						Info.MxEvent->Wait();
+
+						break;
+					}
+				}
+			}
+
+			AcquireLock(MxLock);
+			FreeEvent(Info.MxEvent);
+			ReleaseLock(MxLock);
+
+			return true;
+		}
+
+		bool ThreadPool::WaitIdleNS(std::uint64_t WaitNS)
+		{
+			AcquireLock(MxLock);
+
+			if (!MxPending)
+			{
+				ReleaseLock(MxLock);
+
+				return true;
+			}
+
+			Event *TempEvent = AllocEvent();
+			if (TempEvent == NULL)
+			{
+				ReleaseLock(MxLock);
+
+				return false;
+			}
+
+			MxIdleWaiters.Push(TempEvent);
+
+			ReleaseLock(MxLock);
+
+			bool Result = TempEvent->WaitNS(WaitNS);
+
+			AcquireLock(MxLock);
+
+			if (!Result)
+			{
+				// Remove the event from the waiter list.  If it is already gone, it was fired after the timeout.
+				Queue<Event *> TempQueue;
+				QueueNode<Event *> *Node;
+				bool Found = false;
+
+				while ((Node = MxIdleWaiters.Shift()) != NULL)
+				{
+					if (Node->Value != TempEvent)  TempQueue.Push(Node);
+					else
+					{
+						delete Node;
+
+						Found = true;
+					}
+				}
+
+				MxIdleWaiters.DetachAllAndAppend(TempQueue);
+
+				if (!Found)
+				{
+					TempEvent->Wait(0);
+
+					Result = true;
+				}
+			}
+
+			FreeEvent(TempEvent);
+
+			ReleaseLock(MxLock);
+
+			return Result;
+		}
+
+		void ThreadPool::GetStats(Stats &Result)
+		{
+			Result = Stats();
+
+			for (size_t x = 0; x < MxNumWorkers; x++)
+			{
+				Result.Executed += MxWorkers[x].MxExecuted;
+				Result.Stolen += MxWorkers[x].MxStolen;
+			}
+
+			Result.External = MxExternal;
+			Result.Executed += Result.External;
+			Result.NumThreads = MxNumWorkers;
+		}
+
+		void ThreadPool::RunWorker(Worker *WorkerPtr)
+		{
+			SetCurrentWorker(WorkerPtr);
+
+			if (MxTLS != NULL)  MxTLS->ThreadInit(MxTLSCacheBits);
+
+			size_t x;
+			bool Found;
+
+			do
+			{
+				if (RunOne(WorkerPtr))  continue;
+
+				Found = false;
+				for (x = 0; x < CUBICLESOFT_SYNC_THREADPOOL_SPINS && !Found; x++)
+				{
+					Util::CPUPause();
+
+					Found = RunOne(WorkerPtr);
+				}
+
+				if (Found)  continue;
+
+				// Announce that this worker is going to sleep and then look one more time.  Pairs with the fence in Wake().
+				WorkerPtr->MxSleeping = 1;
+				Util::AtomicAdd32(&MxNumSleeping, 1);
+
+				if (HasWork() || MxStop)
+				{
+					// A waker that already cleared the flag is about to fire the event.
+					if (Util::AtomicCompareExchange32(&WorkerPtr->MxSleeping, 0, 1) == 1)  Util::AtomicAdd32(&MxNumSleeping, (std::uint32_t)-1);
+					else  WorkerPtr->MxEvent.Wait();
+				}
+				else
+				{
+					WorkerPtr->MxEvent.Wait();
+
+					// Stop() fires the event without clearing the flag.
+					if (Util::AtomicCompareExchange32(&WorkerPtr->MxSleeping, 0, 1) == 1)  Util::AtomicAdd32(&MxNumSleeping, (std::uint32_t)-1);
+				}
+			} while (!MxStop || HasWork());
+
+			if (MxTLS != NULL)  MxTLS->ThreadEnd();
+
+			SetCurrentWorker(NULL);
+		}
+
+		bool ThreadPool::RunOne(Worker *WorkerPtr)
+		{
+			Task TempTask;
+
+			if ((WorkerPtr != NULL && WorkerPtr->Pop(TempTask)) || PopShared(WorkerPtr, TempTask))
+			{
+				RunTask(WorkerPtr, TempTask);
+
+				return true;
+			}
+
+			if (StealTask(WorkerPtr, TempTask))
+			{
+				if (WorkerPtr != NULL)  WorkerPtr->MxStolen++;
+
+				RunTask(WorkerPtr, TempTask);
+
+				return true;
+			}
+
+			return false;
+		}
+
+		void ThreadPool::RunTask(Worker *WorkerPtr, const Task &Item)
+		{
+			Item.MxFunc(Item.MxData);
+
+			if (WorkerPtr != NULL)  WorkerPtr->MxExecuted++;
+			else  Util::AtomicAdd32(&MxExternal, 1);
+
+			TaskDone();
+		}
+
+		bool ThreadPool::PopShared(Worker *WorkerPtr, Task &Result)
+		{
+			if (!MxNumShared)  return false;
+
+			AcquireLock(MxLock);
+
+			QueueNode<Task> *Node = MxShared.Shift();
+			if (Node == NULL)
+			{
+				ReleaseLock(MxLock);
+
+				return false;
+			}
+
+			Result = Node->Value;
+			MxFreeNodes.Push(Node);
+
+			// Move a fair share of the remaining tasks into the worker's deque where other workers can steal them without taking the lock.
+			size_t Num = 0;
+			if (WorkerPtr != NULL)
+			{
+				size_t MaxNum = MxShared.GetSize() / MxNumWorkers + 1;
+				if (MaxNum > CUBICLESOFT_SYNC_THREADPOOL_BATCH)  MaxNum = CUBICLESOFT_SYNC_THREADPOOL_BATCH;
+
+				while (Num < MaxNum && (Node = MxShared.First()) != NULL && WorkerPtr->Push(Node->Value))
+				{
+					MxFreeNodes.Push(MxShared.Shift());
+
+					Num++;
+				}
+			}
+
+			MxNumShared = (std::uint32_t)MxShared.GetSize();
+
+			ReleaseLock(MxLock);
+
+			if (Num)  Wake(Num);
+
+			return true;
+		}
+
+		bool ThreadPool::StealTask(Worker *WorkerPtr, Task &Result)
+		{
+			size_t x, Pos = 0;
+
+			if (WorkerPtr != NULL)
+			{
+				// xorshift32 for picking the first victim.
+				WorkerPtr->MxRand ^= WorkerPtr->MxRand << 13;
+				WorkerPtr->MxRand ^= WorkerPtr->MxRand >> 17;
+				WorkerPtr->MxRand ^= WorkerPtr->MxRand << 5;
+
+				Pos = WorkerPtr->MxRand % MxNumWorkers;
+			}
+
+			for (x = 0; x < MxNumWorkers; x++)
+			{
+				Worker *Victim = &MxWorkers[(Pos + x) % MxNumWorkers];
+
+				if (Victim != WorkerPtr && !Victim->IsEmpty() && Victim->Steal(Result))  return true;
+			}
+
+			return false;
+		}
+
+		bool ThreadPool::HasWork()
+		{
+			if (MxNumShared)  return true;
+
+			for (size_t x = 0; x < MxNumWorkers; x++)
+			{
+				if (!MxWorkers[x].IsEmpty())  return true;
+			}
+
+			return false;
+		}
+
+		void ThreadPool::Wake(size_t Num)
+		{
+			// Pairs with the sleep announcement in RunWorker().
+			Util::FullFence();
+
+			size_t x, Pos;
+
+			while (Num && MxNumSleeping)
+			{
+				Pos = (size_t)Util::AtomicAdd32(&MxWakePos, 1);
+
+				for (x = 0; x < MxNumWorkers; x++)
+				{
+					Worker *WorkerPtr = &MxWorkers[(Pos + x) % MxNumWorkers];
+
+					if (WorkerPtr->MxSleeping && Util::AtomicCompareExchange32(&WorkerPtr->MxSleeping, 0, 1) == 1)
+					{
+						Util::AtomicAdd32(&MxNumSleeping, (std::uint32_t)-1);
+						WorkerPtr->MxEvent.Fire();
+
+						break;
+					}
+				}
+
+				if (x == MxNumWorkers)  break;
+
+				Num--;
+			}
+		}
+
+		void ThreadPool::TaskDone()
+		{
+			if (Util::AtomicAdd32(&MxPending, (std::uint32_t)-1) != 0)  return;
+
+			AcquireLock(MxLock);
+
+			if (!MxPending)
+			{
+				QueueNode<Event *> *Node;
+
+				while ((Node = MxIdleWaiters.Shift()) != NULL)
+				{
+					Node->Value->Fire();
+
+					delete Node;
+				}
+			}
+
+			ReleaseLock(MxLock);
+		}
+
+		// The lock must be held.  Returns NULL if a new event can't be created.
+		Event *ThreadPool::AllocEvent()
+		{
+			Event *Result;
+			QueueNode<Event *> *Node = MxFreeEvents.Shift();
+
+			if (Node != NULL)
+			{
+				Result = Node->Value;
+
+				delete Node;
+			}
+			else
+			{
+				Result = new Event;
+				if (!Result->Create())
+				{
+					delete Result;
+
+					return NULL;
+				}
+			}
+
+			return Result;
+		}
+
+		// The lock must be held.
+		void ThreadPool::FreeEvent(Event *EventPtr)
+		{
+			MxFreeEvents.Push(EventPtr);
+		}
+
+		void ThreadPool::ParallelForTask(void *Data)
+		{
+			ParallelForInfo *Info = (ParallelForInfo *)Data;
+
+			// Info lives on the caller's stack and may be gone as soon as the last reference is released.
+			Event *TempEvent = Info->MxEvent;
+
+			RunChunks(Info);
+
+			if (Util::AtomicAdd32(&Info->MxRefs, (std::uint32_t)-1) == 0)  TempEvent->Fire();
+		}
+
+		void ThreadPool::RunChunks(ParallelForInfo *Info)
+		{
+			std::uint32_t Chunk;
+			size_t Start, End;
+
+			while ((Chunk = Util::AtomicAdd32(&Info->MxNextChunk, 1) - 1) < Info->MxNumChunks)
+			{
+				Start = (size_t)Chunk * Info->MxChunkSize;
+				End = Start + Info->MxChunkSize;
+				if (End > Info->MxNum)  End = Info->MxNum;
+
+				Info->MxFunc(Start, End, Info->MxData);
+			}
+		}
+	}
+}
@@ -0,0 +1,198 @@
+// Cross-platform work-stealing thread pool.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#ifndef CUBICLESOFT_SYNC_THREADPOOL
+#define CUBICLESOFT_SYNC_THREADPOOL
+
+#include "sync_event.h"
+#include "sync_tls.h"
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		// Each worker owns a fixed size Chase-Lev deque.  Tasks submitted by a worker go to its own deque (LIFO for the owner) and idle workers steal from the other end (FIFO).
+		// Tasks submitted by other threads go to a shared queue that workers drain in batches into their own deques.
+		// Idle workers spin briefly and then sleep on their own event until new work arrives.
+		class ThreadPool
+		{
+		public:
+			typedef void (*TaskFunc)(void *Data);
+			typedef void (*RangeFunc)(size_t Start, size_t End, void *Data);
+
+			ThreadPool();
+			~ThreadPool();
+
+			// NumThreads of 0 starts one worker per CPU.  Each deque holds 2 ^ DequeBits tasks.  Overflow goes to the shared queue.
+			// When TLSPtr is not NULL, every worker calls TLSPtr->ThreadInit(TLSCacheBits) before running tasks and ThreadEnd() before exiting.
+			bool Start(size_t NumThreads = 0, TLS *TLSPtr = NULL, size_t DequeBits = 10, size_t TLSCacheBits = 15);
+
+			// Waits for all submitted tasks to finish and then joins the workers.
+			bool Stop();
+
+			inline size_t GetNumThreads()  { return MxNumWorkers; }
+			inline TLS *GetTLS()  { return MxTLS; }
+
+			// Returns the index of the calling worker thread or -1 for threads that don't belong to this pool.
+			int GetCurrentWorker();
+
+			bool Submit(TaskFunc Func, void *Data);
+
+			// Submits Func once for each entry in DataArray.  Other threads take the shared queue lock only once.
+			bool SubmitBatch(TaskFunc Func, void **DataArray, size_t Num);
+
+			// Calls Func on ChunkSize ranges of [0, Num) in parallel and returns when all of them have completed.
+			// The calling thread runs chunks and other tasks while it waits.  Safe to call from inside a task.  Runs everything on the calling thread if a wait event can't be created.
+			bool ParallelFor(size_t Num, size_t ChunkSize, RangeFunc Func, void *Data);
+
+			// Waits until there are no queued or running tasks.  Do not call from inside a task.  Returns false on timeout or if a wait event can't be created.
+			inline bool WaitIdle(std::uint32_t Wait = INFINITE)  { return WaitIdleNS(Util::GetWaitNS(Wait)); }
+			bool WaitIdleNS(std::uint64_t WaitNS);
+
+			// Task counters.  Stolen tasks were taken from another worker's deque.  External tasks were run by threads outside of the pool.
+			class Stats
+			{
+			public:
+				Stats() : Executed(0), Stolen(0), External(0), NumThreads(0)
+				{
+				}
+
+				std::uint64_t Executed, Stolen, External;
+				size_t NumThreads;
+			};
+
+			// Values are approximate while tasks are running.
+			void GetStats(Stats &Result);
+
+		private:
+			// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+			ThreadPool(const ThreadPool &);
+			ThreadPool &operator=(const ThreadPool &);
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			typedef CRITICAL_SECTION LockType;
+			typedef HANDLE ThreadType;
+#else
+			typedef pthread_mutex_t LockType;
+			typedef pthread_t ThreadType;
+#endif
+
+			class Task
+			{
+			public:
+				TaskFunc MxFunc;
+				void *MxData;
+			};
+
+			// Top is only advanced with compare and swap by thieves (and the owner when taking the last task).  Bottom is only written by the owner.
+			// The two positions live on separate cache lines.
+			class Worker
+			{
+			public:
+				Worker() : MxPool(NULL), MxIndex(0), MxStarted(false), MxSleeping(0), MxRand(1), MxExecuted(0), MxStolen(0), MxTop(0), MxBottom(0), MxTasks(NULL), MxMask(0)
+				{
+				}
+
+				ThreadPool *MxPool;
+				size_t MxIndex;
+				ThreadType MxThread;
+				bool MxStarted;
+				Event MxEvent;
+				volatile std::uint32_t MxSleeping;
+				std::uint32_t MxRand;
+
+				// Only updated by the owning thread.
+				std::uint64_t MxExecuted, MxStolen;
+
+				char MxPad1[64];
+				volatile std::uint64_t MxTop;
+				char MxPad2[64];
+				volatile std::uint64_t MxBottom;
+				Task *MxTasks;
+				size_t MxMask;
+				char MxPad3[64];
+
+				bool Push(const Task &Item);
+				bool Pop(Task &Result);
+				bool Steal(Task &Result);
+
+				inline bool IsEmpty() const  { return ((std::int64_t)(MxBottom - MxTop) <= 0); }
+
+			private:
+				// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+				Worker(const Worker &);
+				Worker &operator=(const Worker &);
+			};
+
+			// Shared state for the tasks of a single ParallelFor() call.  Refs counts the runner tasks plus the caller.
+			class ParallelForInfo
+			{
+			public:
+				RangeFunc MxFunc;
+				void *MxData;
+				size_t MxNum, MxChunkSize;
+				std::uint32_t MxNumChunks;
+				volatile std::uint32_t MxNextChunk;
+				volatile std::uint32_t MxRefs;
+				Event *MxEvent;
+			};
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			static DWORD WINAPI WorkerMain(LPVOID Data);
+
+			DWORD MxTlsIndex;
+#else
+			static void *WorkerMain(void *Data);
+
+			pthread_key_t MxKey;
+#endif
+
+			bool StartThread(Worker *WorkerPtr);
+			void JoinThread(Worker *WorkerPtr);
+			bool SetCurrentWorker(Worker *WorkerPtr);
+			Worker *GetCurrentWorkerPtr();
+			static size_t GetNumCPUs();
+
+			static void InitLock(LockType &Lock);
+			static void AcquireLock(LockType &Lock);
+			static void ReleaseLock(LockType &Lock);
+			static void FreeLock(LockType &Lock);
+
+			void RunWorker(Worker *WorkerPtr);
+			bool RunOne(Worker *WorkerPtr);
+			void RunTask(Worker *WorkerPtr, const Task &Item);
+			bool PushTasks(TaskFunc Func, void **DataArray, void *Data, size_t Num);
+			bool PopShared(Worker *WorkerPtr, Task &Result);
+			bool StealTask(Worker *WorkerPtr, Task &Result);
+			bool HasWork();
+			void Wake(size_t Num);
+			void TaskDone();
+
+			Event *AllocEvent();
+			void FreeEvent(Event *EventPtr);
+
+			static void ParallelForTask(void *Data);
+			static void RunChunks(ParallelForInfo *Info);
+
+			Worker *MxWorkers;
+			size_t MxNumWorkers;
+			TLS *MxTLS;
+			size_t MxTLSCacheBits;
+			volatile std::uint32_t MxStop;
+			volatile std::uint32_t MxNumSleeping;
+			volatile std::uint32_t MxWakePos;
+
+			// Submitted but not yet finished tasks.
+			volatile std::uint32_t MxPending;
+			volatile std::uint32_t MxExternal;
+
+			// The shared queue reuses its detached nodes.  The lock also protects the idle waiter list and the spare event list.
+			LockType MxLock;
+			Queue<Task> MxShared, MxFreeNodes;
+			volatile std::uint32_t MxNumShared;
+			Queue<Event *> MxIdleWaiters, MxFreeEvents;
+		};
+	}
+}
+
+#endif
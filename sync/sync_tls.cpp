@@ -14,91 +14,188 @@ namespace CubicleSoft
 	{
 #if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
 		// Windows.
-		TLS::TLS()
+		TLS::TLS(size_t NumCentralShards, size_t MaxCentralCacheBits, size_t SlabSize, bool FineSizeClasses) : MxFineClasses(FineSizeClasses)
 		{
 			MxTlsIndex = ::TlsAlloc();
+
+			InitCentral(NumCentralShards, (FineSizeClasses ? MaxCentralCacheBits * 4 : MaxCentralCacheBits), SlabSize);
 		}
 
 		TLS::~TLS()
 		{
+			FreeCentral();
+
 			::TlsFree(MxTlsIndex);
 		}
 
-		bool TLS::SetMainPtr(StaticVector<Queue<char>> *MainPtr)
+		bool TLS::SetMainPtr(ThreadCache *MainPtr)
 		{
 			return (::TlsSetValue(MxTlsIndex, MainPtr) != 0);
 		}
 
-		StaticVector<Queue<char>> *TLS::GetMainPtr()
+		TLS::ThreadCache *TLS::GetMainPtr()
 		{
-			return (StaticVector<Queue<char>> *)::TlsGetValue(MxTlsIndex);
+			return (ThreadCache *)::TlsGetValue(MxTlsIndex);
+		}
+
+		void TLS::InitLock(LockType &Lock)
+		{
+			::InitializeCriticalSection(&Lock);
+		}
+
+		void TLS::AcquireLock(LockType &Lock)
+		{
+			::EnterCriticalSection(&Lock);
+		}
+
+		void TLS::ReleaseLock(LockType &Lock)
+		{
+			::LeaveCriticalSection(&Lock);
+		}
+
+		void TLS::FreeLock(LockType &Lock)
+		{
+			::DeleteCriticalSection(&Lock);
 		}
 #else
 		// POSIX pthreads.
-		TLS::TLS()
+		TLS::TLS(size_t NumCentralShards, size_t MaxCentralCacheBits, size_t SlabSize, bool FineSizeClasses) : MxFineClasses(FineSizeClasses)
 		{
 			pthread_key_create(&MxKey, NULL);
+
+			InitCentral(NumCentralShards, (FineSizeClasses ? MaxCentralCacheBits * 4 : MaxCentralCacheBits), SlabSize);
 		}
 
 		TLS::~TLS()
 		{
+			FreeCentral();
+
 			pthread_key_delete(MxKey);
 		}
 
-		bool TLS::SetMainPtr(StaticVector<Queue<char>> *MainPtr)
+		bool TLS::SetMainPtr(ThreadCache *MainPtr)
 		{
 			return (pthread_setspecific(MxKey, MainPtr) == 0);
 		}
 
-		StaticVector<Queue<char>> *TLS::GetMainPtr()
+		TLS::ThreadCache *TLS::GetMainPtr()
+		{
+			return (ThreadCache *)pthread_getspecific(MxKey);
+		}
+
+		void TLS::InitLock(LockType &Lock)
+		{
+			pthread_mutex_init(&Lock, NULL);
+		}
+
+		void TLS::AcquireLock(LockType &Lock)
+		{
+			pthread_mutex_lock(&Lock);
+		}
+
+		void TLS::ReleaseLock(LockType &Lock)
 		{
-			return (StaticVector<Queue<char>> *)pthread_getspecific(MxKey);
+			pthread_mutex_unlock(&Lock);
+		}
+
+		void TLS::FreeLock(LockType &Lock)
+		{
+			pthread_mutex_destroy(&Lock);
 		}
 #endif
 
+		// Marks the remote free list of a thread cache that has passed through ThreadEnd().
+		#define CUBICLESOFT_SYNC_TLS_ORPHANED   ((void *)(size_t)1)
+
+		// Owner of blocks allocated from an arena.
+		#define CUBICLESOFT_SYNC_TLS_ARENA   ((ThreadCache *)(size_t)1)
+
 		// All platforms.
 		bool TLS::ThreadInit(size_t MaxCacheBits)
 		{
-			StaticVector<Queue<char>> *MainPtr = GetMainPtr();
+			ThreadCache *MainPtr = GetMainPtr();
 			if (MainPtr != NULL)  return true;
 
-			return SetMainPtr(new StaticVector<Queue<char>>(MaxCacheBits));
+			// Select a central cache shard based on the address of the new thread cache.
+			MainPtr = new ThreadCache((MxFineClasses ? MaxCacheBits * 4 : MaxCacheBits), NULL);
+			if (MxNumShards)  MainPtr->MxShard = &MxShards[((size_t)MainPtr >> 6) % MxNumShards];
+
+			if (!SetMainPtr(MainPtr))
+			{
+				delete MainPtr;
+
+				return false;
+			}
+
+			AcquireLock(MxCacheListLock);
+			MainPtr->MxNextCache = MxCaches;
+			if (MxCaches != NULL)  MxCaches->MxPrevCache = MainPtr;
+			MxCaches = MainPtr;
+			ReleaseLock(MxCacheListLock);
+
+			return true;
 		}
 
 		void *TLS::malloc(size_t Size)
 		{
 			if (Size == 0)  return NULL;
 
-			StaticVector<Queue<char>> *MainPtr = GetMainPtr();
+			ThreadCache *MainPtr = GetMainPtr();
 			if (MainPtr == NULL)  return NULL;
 
-			void *Data;
+			// Reclaim memory freed by other threads.
+			if (MainPtr->MxRemoteFree != NULL)  DrainRemoteFree(MainPtr);
+
+			std::uint8_t *Data;
 			size_t Pos = NormalizeBitPosition(Size);
-			Size++;
-			if (MainPtr->GetSize() <= Pos)
+			if (MainPtr->MxArena != NULL)  return MainPtr->MxArena->Alloc(Size, Pos);
+
+			Size += HeaderSize;
+			if (MainPtr->MxBuckets.GetSize() <= Pos)
 			{
-				Data = ::malloc(Size);
-				Data = (std::uint8_t *)Data + 1;
+				Data = (std::uint8_t *)::malloc(Size);
+				if (Data == NULL)  return NULL;
+
+				// Uncached memory isn't owned by any thread.
+				*((ThreadCache **)Data) = NULL;
+
+				MainPtr->MxStats.OversizedAllocs++;
+				MainPtr->MxStats.OversizedBytes += Size - HeaderSize;
 			}
 			else
 			{
-				QueueNode<char> *Node = (*MainPtr)[Pos].Shift();
-				if (Node == NULL)
+				QueueNode<char> *Node = MainPtr->MxBuckets[Pos].Shift();
+				if (Node != NULL)  MainPtr->MxStats.Hits++;
+				else if (RefillFromCentral(MainPtr, Pos))
+				{
+					Node = MainPtr->MxBuckets[Pos].Shift();
+					MainPtr->MxStats.CentralHits++;
+				}
+
+				if (Node != NULL)  MainPtr->MxStats.CachedNodes--;
+				else
 				{
-					if (Size < sizeof(QueueNode<char>))  Size = sizeof(QueueNode<char>);
-					Data = ::malloc(Size);
-					if (Data == NULL)  return NULL;
+					MainPtr->MxStats.Misses++;
+
+					if (IsSlabPos(Pos))  Node = AllocSlabNode(MainPtr, Pos);
+					else
+					{
+						if (Size < sizeof(QueueNode<char>))  Size = sizeof(QueueNode<char>);
+						Node = (QueueNode<char> *)::malloc(Size);
+					}
 
-					Node = (QueueNode<char> *)Data;
+					if (Node == NULL)  return NULL;
 				}
 
-				Data = ((std::uint8_t *)Node) + 1;
+				Data = (std::uint8_t *)Node;
+				*((ThreadCache **)Data) = MainPtr;
+				MainPtr->MxNumLive++;
 			}
 
-			// Store the position.  Safe for QueueNode since data storage is after the NextNode pointer.
-			((std::uint8_t *)Data)[-1] = (std::uint8_t)Pos;
+			// Store the position.  Safe for QueueNode since the header overlays the NextNode pointer and the Value.
+			Data[HeaderSize - 1] = (std::uint8_t)Pos;
 
-			return Data;
+			return Data + HeaderSize;
 		}
 
 		void *TLS::realloc(void *Data, size_t NewSize, bool Cache)
@@ -117,22 +214,27 @@ namespace CubicleSoft
 			size_t Pos2 = (size_t)((std::uint8_t *)Data)[-1];
 			if (Pos <= Pos2)  return Data;
 
-			StaticVector<Queue<char>> *MainPtr = GetMainPtr();
+			ThreadCache *MainPtr = GetMainPtr();
 			if (MainPtr == NULL)  return NULL;
 
 			void *Data2;
-			if (MainPtr->GetSize() <= Pos && MainPtr->GetSize() <= Pos2)
+			std::uint8_t *Block = ((std::uint8_t *)Data) - HeaderSize;
+			if (MainPtr->MxBuckets.GetSize() <= Pos && *((ThreadCache **)Block) == NULL)
 			{
-				Data2 = ::realloc(((std::uint8_t *)Data) - 1, 1 + NewSize);
-				Data2 = (std::uint8_t *)Data2 + 1;
+				Block = (std::uint8_t *)::realloc(Block, HeaderSize + NewSize);
+				if (Block == NULL)  return NULL;
+
+				Block[HeaderSize - 1] = (std::uint8_t)Pos;
+				Data2 = Block + HeaderSize;
 			}
 			else
 			{
 				// Allocate data.
 				Data2 = malloc(NewSize);
+				if (Data2 == NULL)  return NULL;
 
 				// Copy the data.
-				memcpy(Data2, Data, (1 << Pos2));
+				memcpy(Data2, Data, GetClassSize(Pos2));
 
 				// Free the previous object.
 				free(Data, Cache);
@@ -146,7 +248,7 @@ namespace CubicleSoft
 			if (Data == NULL)  return NULL;
 
 			// Allocate the appropriate size buffer.
-			size_t Size = (size_t)(1 << ((size_t)((std::uint8_t *)Data)[-1]));
+			size_t Size = GetClassSize((size_t)((std::uint8_t *)Data)[-1]);
 			void *Data2 = ::malloc(Size);
 			if (Data2 == NULL)  return NULL;
 
@@ -163,36 +265,56 @@ namespace CubicleSoft
 		{
 			if (Data == NULL)  return;
 
-			StaticVector<Queue<char>> *MainPtr = GetMainPtr();
-			if (MainPtr == NULL)  return;
+			std::uint8_t *Block = ((std::uint8_t *)Data) - HeaderSize;
+			ThreadCache *Owner = *((ThreadCache **)Block);
+			if (Owner == CUBICLESOFT_SYNC_TLS_ARENA)  return;
+
+			ThreadCache *MainPtr = GetMainPtr();
+			if (MainPtr != NULL)  MainPtr->MxStats.Frees++;
+
+			if (Owner == NULL)  ::free(Block);
+			else if (Owner != MainPtr)
+			{
+				if (MainPtr != NULL)  MainPtr->MxStats.RemoteFrees++;
 
-			size_t Pos = (size_t)((std::uint8_t *)Data)[-1];
-			if (MainPtr->GetSize() <= Pos)  ::free(((std::uint8_t *)Data) - 1);
+				RemoteFree(Owner, Block);
+			}
 			else
 			{
-				QueueNode<char> *Node = (QueueNode<char> *)(((std::uint8_t *)Data) - 1);
+				Owner->MxNumLive--;
 
-				if (!Cache)  ::free(Node);
+				// Slab blocks are always cached.
+				size_t Pos = (size_t)Block[HeaderSize - 1];
+				if (!Cache && !IsSlabPos(Pos))  ::free(Block);
 				else
 				{
 					// Placement new.  Instantiates QueueNode.
-					Node = new(Node) QueueNode<char>;
+					QueueNode<char> *Node = new(Block) QueueNode<char>;
 
-					(*MainPtr)[Pos].Push(Node);
+					Owner->MxBuckets[Pos].Push(Node);
+					AddCachedNodes(Owner, 1);
+					if (Owner->MxShard != NULL && Owner->MxBuckets[Pos].GetSize() > GetBatchSize(Pos) * 2)  SpillToCentral(Owner, Pos);
 				}
 			}
 		}
 
+		size_t TLS::GetSize(void *Data)
+		{
+			if (Data == NULL)  return 0;
+
+			return GetClassSize((size_t)((std::uint8_t *)Data)[-1]);
+		}
+
 		bool TLS::GetBucketInfo(size_t Num, size_t &Nodes, size_t &Size)
 		{
-			StaticVector<Queue<char>> *MainPtr = GetMainPtr();
+			ThreadCache *MainPtr = GetMainPtr();
 			if (MainPtr == NULL)  return false;
 
-			if (Num >= MainPtr->GetSize())  return false;
+			if (Num >= MainPtr->MxBuckets.GetSize())  return false;
 			else
 			{
-				Nodes = (*MainPtr)[Num].GetSize();
-				Size = (size_t)(1 << Num);
+				Nodes = MainPtr->MxBuckets[Num].GetSize();
+				Size = GetClassSize(Num);
 				if (Size < sizeof(QueueNode<char>))  Size = sizeof(QueueNode<char>);
 				Size *= Nodes;
 			}
@@ -200,36 +322,319 @@ namespace CubicleSoft
 			return true;
 		}
 
+		bool TLS::GetThreadStats(Stats &Result)
+		{
+			ThreadCache *MainPtr = GetMainPtr();
+			if (MainPtr == NULL)  return false;
+
+			Result = MainPtr->MxStats;
+			Result.NumThreads = 1;
+
+			return true;
+		}
+
+		void TLS::GetStats(Stats &Result)
+		{
+			Result = Stats();
+
+			AcquireLock(MxCacheListLock);
+			for (ThreadCache *MainPtr = MxCaches; MainPtr != NULL; MainPtr = MainPtr->MxNextCache)
+			{
+				Stats &TempStats = MainPtr->MxStats;
+
+				Result.Hits += TempStats.Hits;
+				Result.CentralHits += TempStats.CentralHits;
+				Result.Misses += TempStats.Misses;
+				Result.Frees += TempStats.Frees;
+				Result.RemoteFrees += TempStats.RemoteFrees;
+				Result.CachedNodes += TempStats.CachedNodes;
+				Result.CachedHighWater += TempStats.CachedHighWater;
+				Result.OversizedAllocs += TempStats.OversizedAllocs;
+				Result.OversizedBytes += TempStats.OversizedBytes;
+				Result.NumThreads++;
+			}
+			ReleaseLock(MxCacheListLock);
+		}
+
 		bool TLS::ThreadEnd()
 		{
-			StaticVector<Queue<char>> *MainPtr = GetMainPtr();
+			ThreadCache *MainPtr = GetMainPtr();
 			if (MainPtr == NULL)  return false;
 
 			SetMainPtr(NULL);
 
-			// Free all cached data.
-			size_t y = MainPtr->GetSize();
-			Queue<char> *RawData = MainPtr->RawData();
-			QueueNode<char> *Node;
+			AcquireLock(MxCacheListLock);
+			if (MainPtr->MxPrevCache != NULL)  MainPtr->MxPrevCache->MxNextCache = MainPtr->MxNextCache;
+			else  MxCaches = MainPtr->MxNextCache;
+			if (MainPtr->MxNextCache != NULL)  MainPtr->MxNextCache->MxPrevCache = MainPtr->MxPrevCache;
+			ReleaseLock(MxCacheListLock);
+
+			// Move all cached data to the central cache.
+			DrainRemoteFree(MainPtr);
+
+			size_t y = MainPtr->MxBuckets.GetSize();
+			Queue<char> *RawData = MainPtr->MxBuckets.RawData();
 			for (size_t x = 0; x < y; x++)
 			{
-				while ((Node = RawData[x].Shift()) != NULL)
+				ReleaseSlabCursor(MainPtr, x);
+				ReleaseToCentral(MainPtr->MxShard, x, RawData[x]);
+			}
+
+			// Orphan the thread cache.  Blocks still held by other threads are freed by those threads and the last one out deletes the cache.
+			MainPtr->MxNumOutstanding = (std::uint32_t)MainPtr->MxNumLive + 1;
+			void *Block = Util::AtomicExchangePtr(&MainPtr->MxRemoteFree, CUBICLESOFT_SYNC_TLS_ORPHANED);
+			std::uint32_t Num = 1;
+			while (Block != NULL)
+			{
+				void *Block2 = *((void **)Block);
+				OrphanFree(MainPtr, Block);
+				Num++;
+
+				Block = Block2;
+			}
+
+			if (Util::AtomicAdd32(&MainPtr->MxNumOutstanding, (std::uint32_t)0 - Num) == 0)  delete MainPtr;
+
+			return true;
+		}
+
+		void TLS::DrainRemoteFree(ThreadCache *MainPtr)
+		{
+			void *Block = Util::AtomicExchangePtr(&MainPtr->MxRemoteFree, NULL);
+			void *Block2;
+			size_t Pos;
+			QueueNode<char> *Node;
+
+			while (Block != NULL)
+			{
+				Block2 = *((void **)Block);
+				Pos = (size_t)((std::uint8_t *)Block)[HeaderSize - 1];
+
+				// Placement new.  Instantiates QueueNode.
+				Node = new(Block) QueueNode<char>;
+
+				MainPtr->MxBuckets[Pos].Push(Node);
+				MainPtr->MxNumLive--;
+				AddCachedNodes(MainPtr, 1);
+				if (MainPtr->MxShard != NULL && MainPtr->MxBuckets[Pos].GetSize() > GetBatchSize(Pos) * 2)  SpillToCentral(MainPtr, Pos);
+
+				Block = Block2;
+			}
+		}
+
+		void TLS::RemoteFree(ThreadCache *Owner, void *Block)
+		{
+			// Push the block onto the owner's remote free list.  The first pointer of the block links the list.
+			void *Head = NULL, *Head2;
+			do
+			{
+				if (Head == CUBICLESOFT_SYNC_TLS_ORPHANED)
 				{
-					::free(Node);
+					OrphanFree(Owner, Block);
+
+					if (Util::AtomicAdd32(&Owner->MxNumOutstanding, (std::uint32_t)-1) == 0)  delete Owner;
+
+					return;
 				}
+
+				*((void **)Block) = Head;
+				Head2 = Head;
+				Head = Util::AtomicCompareExchangePtr(&Owner->MxRemoteFree, Block, Head2);
+			} while (Head != Head2);
+		}
+
+		void TLS::OrphanFree(ThreadCache *Owner, void *Block)
+		{
+			size_t Pos = (size_t)((std::uint8_t *)Block)[HeaderSize - 1];
+
+			// Placement new.  Instantiates QueueNode.
+			Queue<char> TempQueue;
+			TempQueue.Push(new(Block) QueueNode<char>);
+
+			ReleaseToCentral(Owner->MxShard, Pos, TempQueue);
+		}
+
+		bool TLS::RefillFromCentral(ThreadCache *MainPtr, size_t Pos)
+		{
+			CentralShard *Shard = MainPtr->MxShard;
+			if (Shard == NULL || Pos >= MxCentralBits)  return false;
+
+			Queue<char> TempQueue;
+			size_t Num = GetBatchSize(Pos);
+
+			AcquireLock(Shard->MxLock);
+			Queue<char> &CentralQueue = Shard->MxBuckets[Pos];
+			if (CentralQueue.GetSize() <= Num)  TempQueue.DetachAllAndAppend(CentralQueue);
+			else
+			{
+				for (size_t x = 0; x < Num; x++)  TempQueue.Push(CentralQueue.Shift());
 			}
+			ReleaseLock(Shard->MxLock);
+
+			if (!TempQueue.GetSize())  return false;
 
-			delete MainPtr;
+			AddCachedNodes(MainPtr, TempQueue.GetSize());
+			MainPtr->MxBuckets[Pos].DetachAllAndAppend(TempQueue);
 
 			return true;
 		}
 
-		size_t TLS::NormalizeBitPosition(size_t &Size)
+		void TLS::SpillToCentral(ThreadCache *MainPtr, size_t Pos)
+		{
+			// Keep the most recently freed blocks local.
+			Queue<char> TempQueue;
+			Queue<char> &LocalQueue = MainPtr->MxBuckets[Pos];
+			size_t Num = LocalQueue.GetSize() - GetBatchSize(Pos);
+			for (size_t x = 0; x < Num; x++)  TempQueue.Push(LocalQueue.Shift());
+			MainPtr->MxStats.CachedNodes -= Num;
+
+			ReleaseToCentral(MainPtr->MxShard, Pos, TempQueue);
+		}
+
+		void TLS::ReleaseToCentral(CentralShard *Shard, size_t Pos, Queue<char> &TempQueue)
+		{
+			if (Shard != NULL && Pos < MxCentralBits)
+			{
+				// The central cache holds up to 32 batches per bucket per shard.  Slab blocks can't be freed individually.
+				size_t MaxNodes = (IsSlabPos(Pos) ? (size_t)-1 : GetBatchSize(Pos) * 32);
+
+				AcquireLock(Shard->MxLock);
+				Queue<char> &CentralQueue = Shard->MxBuckets[Pos];
+				if (CentralQueue.GetSize() + TempQueue.GetSize() <= MaxNodes)  CentralQueue.DetachAllAndAppend(TempQueue);
+				else
+				{
+					while (CentralQueue.GetSize() < MaxNodes)  CentralQueue.Push(TempQueue.Shift());
+				}
+				ReleaseLock(Shard->MxLock);
+			}
+
+			// Free the overflow.
+			QueueNode<char> *Node;
+			while ((Node = TempQueue.Shift()) != NULL)  ::free(Node);
+		}
+
+		QueueNode<char> *TLS::AllocSlabNode(ThreadCache *MainPtr, size_t Pos)
+		{
+			SlabCursor &Cursor = MainPtr->MxSlabCursors[Pos];
+			size_t Stride = GetSlabStride(Pos);
+
+			if (!Cursor.MxLeft)
+			{
+				// The slab header is padded to keep blocks aligned.
+				size_t Num = MxSlabSize / Stride;
+				char *Slab = (char *)::malloc(sizeof(void *) * 2 + Num * Stride);
+				if (Slab == NULL)  return NULL;
+
+				AcquireLock(MxSlabLock);
+				*((void **)Slab) = MxSlabs;
+				MxSlabs = Slab;
+				ReleaseLock(MxSlabLock);
+
+				Cursor.MxNext = Slab + sizeof(void *) * 2;
+				Cursor.MxLeft = Num;
+			}
+
+			// Placement new.  Instantiates QueueNode.
+			QueueNode<char> *Node = new(Cursor.MxNext) QueueNode<char>;
+			Cursor.MxNext += Stride;
+			Cursor.MxLeft--;
+
+			return Node;
+		}
+
+		void TLS::ReleaseSlabCursor(ThreadCache *MainPtr, size_t Pos)
+		{
+			SlabCursor &Cursor = MainPtr->MxSlabCursors[Pos];
+			if (!Cursor.MxLeft)  return;
+
+			// Carve the rest of the slab so other threads can use it.
+			Queue<char> TempQueue;
+			while (Cursor.MxLeft)  TempQueue.Push(AllocSlabNode(MainPtr, Pos));
+
+			ReleaseToCentral(MainPtr->MxShard, Pos, TempQueue);
+		}
+
+		void TLS::InitCentral(size_t NumCentralShards, size_t MaxCentralCacheBits, size_t SlabSize)
+		{
+			MxNumShards = NumCentralShards;
+			MxCentralBits = MaxCentralCacheBits;
+			MxShards = NULL;
+			MxSlabSize = SlabSize;
+			MxSlabs = NULL;
+			MxCaches = NULL;
+
+			InitLock(MxSlabLock);
+			InitLock(MxCacheListLock);
+
+			if (MxNumShards)
+			{
+				MxShards = new CentralShard[MxNumShards];
+				for (size_t x = 0; x < MxNumShards; x++)
+				{
+					InitLock(MxShards[x].MxLock);
+					MxShards[x].MxBuckets = new Queue<char>[MxCentralBits];
+				}
+			}
+		}
+
+		void TLS::FreeCentral()
+		{
+			QueueNode<char> *Node;
+
+			for (size_t x = 0; x < MxNumShards; x++)
+			{
+				for (size_t y = 0; y < MxCentralBits; y++)
+				{
+					// Slab blocks are released with their slab.
+					if (IsSlabPos(y))  while (MxShards[x].MxBuckets[y].Shift() != NULL);
+					else
+					{
+						while ((Node = MxShards[x].MxBuckets[y].Shift()) != NULL)  ::free(Node);
+					}
+				}
+
+				delete[] MxShards[x].MxBuckets;
+
+				FreeLock(MxShards[x].MxLock);
+			}
+
+			if (MxShards != NULL)  delete[] MxShards;
+
+			void *Slab;
+			while (MxSlabs != NULL)
+			{
+				Slab = MxSlabs;
+				MxSlabs = *((void **)Slab);
+
+				::free(Slab);
+			}
+
+			FreeLock(MxSlabLock);
+			FreeLock(MxCacheListLock);
+		}
+
+		size_t TLS::NormalizeBitPosition(size_t &Size) const
 		{
 			size_t Pos = 3;
 
 			while (((size_t)1 << Pos) < Size)  Pos++;
-			Size = ((size_t)1 << Pos);
+
+			if (!MxFineClasses)
+			{
+				Size = ((size_t)1 << Pos);
+
+				return Pos;
+			}
+
+			// Find the smallest quarter step above the previous power of two.
+			Pos *= 4;
+			if (Pos > 12)
+			{
+				size_t Pos2 = Pos - 3;
+				while (GetClassSize(Pos2) < Size)  Pos2++;
+				Pos = Pos2;
+			}
+			Size = GetClassSize(Pos);
 
 			return Pos;
 		}
@@ -247,6 +652,68 @@ namespace CubicleSoft
 		}
 
 
+		TLS::Arena::Arena(TLS *TLSPtr, size_t ChunkSize) : MxTLS(TLSPtr), MxPrevArena(NULL), MxChunkSize(ChunkSize), MxChunks(NULL), MxNext(NULL), MxLeft(0)
+		{
+			ThreadCache *MainPtr = MxTLS->GetMainPtr();
+			if (MainPtr != NULL)
+			{
+				MxPrevArena = MainPtr->MxArena;
+				MainPtr->MxArena = this;
+			}
+		}
+
+		TLS::Arena::~Arena()
+		{
+			ThreadCache *MainPtr = MxTLS->GetMainPtr();
+			if (MainPtr != NULL && MainPtr->MxArena == this)  MainPtr->MxArena = MxPrevArena;
+
+			char *Chunk;
+			while (MxChunks != NULL)
+			{
+				Chunk = MxChunks;
+				MxChunks = *((char **)Chunk);
+
+				::free(Chunk);
+			}
+		}
+
+		void *TLS::Arena::Alloc(size_t Size, size_t Pos)
+		{
+			// Keep blocks aligned the same way as slab blocks.
+			Size = (HeaderSize + Size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+			char *Data;
+			if (Size > MxLeft)
+			{
+				// Large allocations get their own chunk so the current chunk keeps its free space.
+				size_t ChunkSize = (Size > MxChunkSize / 4 ? Size : MxChunkSize);
+				char *Chunk = (char *)::malloc(sizeof(void *) * 2 + ChunkSize);
+				if (Chunk == NULL)  return NULL;
+
+				*((char **)Chunk) = MxChunks;
+				MxChunks = Chunk;
+
+				Data = Chunk + sizeof(void *) * 2;
+				if (ChunkSize == MxChunkSize)
+				{
+					MxNext = Data + Size;
+					MxLeft = ChunkSize - Size;
+				}
+			}
+			else
+			{
+				Data = MxNext;
+				MxNext += Size;
+				MxLeft -= Size;
+			}
+
+			*((ThreadCache **)Data) = CUBICLESOFT_SYNC_TLS_ARENA;
+			((std::uint8_t *)Data)[HeaderSize - 1] = (std::uint8_t)Pos;
+
+			return Data + HeaderSize;
+		}
+
+
 		TLS::MixedVar::MixedVar(TLS *TLSPtr) : MxMode(TMV_None), MxInt(0), MxDouble(0.0), MxStr(NULL), MxStrPos(0), MxTLS(TLSPtr)
 		{
 		}
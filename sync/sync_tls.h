@@ -23,7 +23,11 @@ namespace CubicleSoft
 		class TLS
 		{
 		public:
-			TLS();
+			// Blocks freed beyond each thread's high-water mark are spilled in batches to a shared central cache.
+			// Thread caches are spread across NumCentralShards shards to reduce lock contention (0 disables the central cache and thread caches keep every freed block).
+			// Cached block sizes are carved out of SlabSize byte slabs, which are only released when this object is destroyed (0 uses one malloc() per block).
+			// FineSizeClasses rounds allocations up to quarter-power steps (e.g. 4097 bytes uses a 5K block) instead of the next power of two.
+			TLS(size_t NumCentralShards = 8, size_t MaxCentralCacheBits = 15, size_t SlabSize = 65536, bool FineSizeClasses = false);
 			~TLS();
 
 			// Intended for use as a large, fixed-sized stack.
@@ -42,12 +46,41 @@ namespace CubicleSoft
 				void *MxData;
 			};
 
+			// Serves all malloc()/realloc() calls on the current thread from bump-allocated chunks while in scope.
+			// free() is a no-op for arena memory.  Everything is released at once when the arena is destroyed.
+			// Arenas nest.  Destroy them on the thread that created them and don't use arena memory after the arena is gone.
+			class Arena
+			{
+			public:
+				Arena(TLS *TLSPtr, size_t ChunkSize = 65536);
+				~Arena();
+
+			private:
+				// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+				Arena(const Arena &);
+				Arena &operator=(const Arena &);
+
+				void *Alloc(size_t Size, size_t Pos);
+
+				TLS *MxTLS;
+				Arena *MxPrevArena;
+				size_t MxChunkSize;
+
+				// Chunks are singly linked through their first pointer.
+				char *MxChunks;
+				char *MxNext;
+				size_t MxLeft;
+
+				friend class TLS;
+			};
+
 			// Initializes the local thread cache to cache allocations (Default is 15, 2 ^ 15 = up to 32K allocations).
 			// It is highly recommended to surround all code between ThreadInit() and ThreadEnd() with braces, especially when using AutoFree.
 			// Only call this function once per thread per TLS instance.
 			bool ThreadInit(size_t MaxCacheBits = 15);
 
-			// Standard malloc()-like call.  Do not mix with real malloc/realloc/free!  Do not send to other threads.
+			// Standard malloc()-like call.  Do not mix with real malloc/realloc/free!
+			// Memory may be sent to and freed by other threads.  It is returned to the allocating thread's cache on its next malloc().
 			void *malloc(size_t Size);
 
 			// Standard realloc()-like call.
@@ -57,9 +90,12 @@ namespace CubicleSoft
 			// For real new, just use a copy constructor and then free the memory.  That way a deep copy can more naturally happen.
 			void *dup_malloc(void *Data, bool Cache = true);
 
-			// Standard free()-like call.
+			// Standard free()-like call.  Cache is ignored when freeing memory allocated by another thread.
 			void free(void *Data, bool Cache = true);
 
+			// Returns the usable size of memory returned by malloc()/realloc().
+			size_t GetSize(void *Data);
+
 			// Some static versions of the above to be able to pass the class around to other snippet library functions.
 			inline static void *malloc(void *TLSPtr, size_t Size)
 			{
@@ -76,10 +112,32 @@ namespace CubicleSoft
 				((TLS *)TLSPtr)->free(Data);
 			}
 
-			// Extract stats.
+			// Extract stats.  With fine size classes, each power of two is split across four buckets.
 			bool GetBucketInfo(size_t Num, size_t &Nodes, size_t &Size);
 
-			// Frees up all resources associated with the local thread cache.
+			// Allocation counters.  Hits are served by the thread cache, CentralHits refill it from the central cache, and Misses allocate new blocks.
+			// OversizedBytes counts bytes requested past MaxCacheBits.  Frees include RemoteFrees of memory allocated by other threads.
+			class Stats
+			{
+			public:
+				Stats() : Hits(0), CentralHits(0), Misses(0), Frees(0), RemoteFrees(0), CachedNodes(0), CachedHighWater(0), OversizedAllocs(0), OversizedBytes(0), NumThreads(0)
+				{
+				}
+
+				std::uint64_t Hits, CentralHits, Misses;
+				std::uint64_t Frees, RemoteFrees;
+				std::uint64_t CachedNodes, CachedHighWater;
+				std::uint64_t OversizedAllocs, OversizedBytes;
+				size_t NumThreads;
+			};
+
+			// Retrieves the counters of the local thread cache.
+			bool GetThreadStats(Stats &Result);
+
+			// Retrieves the sum of the counters of all live thread caches.  Values are approximate while other threads are running.
+			void GetStats(Stats &Result);
+
+			// Frees up all resources associated with the local thread cache.  Cached blocks are moved to the central cache.
 			bool ThreadEnd();
 
 
@@ -246,16 +304,136 @@ namespace CubicleSoft
 			TLS(const TLS &);
 			TLS &operator=(const TLS &);
 
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			typedef CRITICAL_SECTION LockType;
+#else
+			typedef pthread_mutex_t LockType;
+#endif
+
+			// Central cache shard.  Buckets hold batches of blocks moved between thread caches.
+			class CentralShard
+			{
+			public:
+				LockType MxLock;
+				Queue<char> *MxBuckets;
+			};
+
+			size_t MxNumShards, MxCentralBits;
+			CentralShard *MxShards;
+
+			// Slabs are singly linked through their first pointer and released when the TLS object is destroyed.
+			size_t MxSlabSize;
+			LockType MxSlabLock;
+			void *MxSlabs;
+
+			// Uncarved space in the current slab of a bucket.
+			class SlabCursor
+			{
+			public:
+				SlabCursor() : MxNext(NULL), MxLeft(0)
+				{
+				}
+
+				char *MxNext;
+				size_t MxLeft;
+			};
+
+			// Per-thread cache.  Other threads push freed blocks onto the lock-free MxRemoteFree list.
+			class ThreadCache
+			{
+			public:
+				ThreadCache(size_t MaxCacheBits, CentralShard *Shard) : MxBuckets(MaxCacheBits), MxSlabCursors(MaxCacheBits), MxShard(Shard), MxNumLive(0), MxArena(NULL), MxPrevCache(NULL), MxNextCache(NULL), MxRemoteFree(NULL), MxNumOutstanding(0)
+				{
+				}
+
+				StaticVector<Queue<char>> MxBuckets;
+				StaticVector<SlabCursor> MxSlabCursors;
+				CentralShard *MxShard;
+				size_t MxNumLive;
+
+				// Active arena, if any.
+				Arena *MxArena;
+
+				// Only updated by the owning thread.
+				Stats MxStats;
+				ThreadCache *MxPrevCache, *MxNextCache;
+
+				void * volatile MxRemoteFree;
+				volatile std::uint32_t MxNumOutstanding;
+			};
+
+			// Each block starts with the owning ThreadCache (NULL for uncached sizes) followed by the one byte bucket position.
+			static const size_t HeaderSize = sizeof(ThreadCache *) + 1;
+
 #if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
 			DWORD MxTlsIndex;
 #else
 			pthread_key_t MxKey;
 #endif
 
-			bool SetMainPtr(StaticVector<Queue<char>> *MainPtr);
-			StaticVector<Queue<char>> *GetMainPtr();
+			// Registry of live thread caches for GetStats().
+			LockType MxCacheListLock;
+			ThreadCache *MxCaches;
+
+			bool SetMainPtr(ThreadCache *MainPtr);
+			ThreadCache *GetMainPtr();
+
+			static inline void AddCachedNodes(ThreadCache *MainPtr, size_t Num)
+			{
+				MainPtr->MxStats.CachedNodes += Num;
+				if (MainPtr->MxStats.CachedHighWater < MainPtr->MxStats.CachedNodes)  MainPtr->MxStats.CachedHighWater = MainPtr->MxStats.CachedNodes;
+			}
+
+			void DrainRemoteFree(ThreadCache *MainPtr);
+			void RemoteFree(ThreadCache *Owner, void *Block);
+
+			static void InitLock(LockType &Lock);
+			static void AcquireLock(LockType &Lock);
+			static void ReleaseLock(LockType &Lock);
+			static void FreeLock(LockType &Lock);
+
+			inline bool IsSlabPos(size_t Pos) const
+			{
+				return (MxSlabSize && MxNumShards && Pos < MxCentralBits && GetSlabStride(Pos) * 4 <= MxSlabSize);
+			}
+
+			// Size of each block carved from a slab.  Keeps the QueueNode pointer aligned.
+			inline size_t GetSlabStride(size_t Pos) const
+			{
+				size_t Size = HeaderSize + GetClassSize(Pos);
+				if (Size < sizeof(QueueNode<char>))  Size = sizeof(QueueNode<char>);
+
+				return (Size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+			}
+
+			QueueNode<char> *AllocSlabNode(ThreadCache *MainPtr, size_t Pos);
+			void ReleaseSlabCursor(ThreadCache *MainPtr, size_t Pos);
+			bool RefillFromCentral(ThreadCache *MainPtr, size_t Pos);
+			void SpillToCentral(ThreadCache *MainPtr, size_t Pos);
+			void ReleaseToCentral(CentralShard *Shard, size_t Pos, Queue<char> &TempQueue);
+			void OrphanFree(ThreadCache *Owner, void *Block);
+			void InitCentral(size_t NumCentralShards, size_t MaxCentralCacheBits, size_t SlabSize);
+			void FreeCentral();
+
+			// Number of blocks moved to/from the central cache at once.  Thread buckets spill above twice this amount.
+			inline size_t GetBatchSize(size_t Pos) const
+			{
+				size_t Num = (size_t)65536 / GetClassSize(Pos);
+
+				return (Num < 2 ? 2 : (Num > 32 ? 32 : Num));
+			}
+
+			bool MxFineClasses;
+
+			// The one byte bucket position is the power of two or, with fine size classes, four times the power of two plus the quarter step.
+			inline size_t GetClassSize(size_t Pos) const
+			{
+				if (!MxFineClasses)  return ((size_t)1 << Pos);
+
+				return ((size_t)(4 + (Pos & 3)) << (Pos >> 2)) >> 2;
+			}
 
-			static size_t NormalizeBitPosition(size_t &Size);
+			size_t NormalizeBitPosition(size_t &Size) const;
 		};
 	}
 }
@@ -16,9 +16,15 @@
 
 	#include <cstring>
 
+	#include <time.h>
+
+	#ifdef __linux__
+		#include <linux/futex.h>
+		#include <sys/syscall.h>
+	#endif
+
 	#ifdef __APPLE__
-		#include <mach/clock.h>
-		#include <mach/mach.h>
+		#include <mach/mach_time.h>
 
 		#ifndef SHM_NAME_MAX
 			#define SHM_NAME_MAX 31
@@ -58,27 +64,16 @@ namespace CubicleSoft
 
 			return Result;
 		}
-#else
-		// Dear Apple:  You hire plenty of developers, so please fix your OS.
-		int CSGX__ClockGetTimeRealtime(struct timespec *ts)
-		{
-	#ifdef __APPLE__
-			clock_serv_t cclock;
-			mach_timespec_t mts;
 
-			if (host_get_clock_service(mach_host_self(), CALENDAR_CLOCK, &cclock) != KERN_SUCCESS)  return -1;
-			if (clock_get_time(cclock, &mts) != KERN_SUCCESS)  return -1;
-			if (mach_port_deallocate(mach_task_self(), cclock) != KERN_SUCCESS)  return -1;
+		std::uint64_t Util::GetMonotonicNanosecondTime()
+		{
+			LARGE_INTEGER Freq, Counter;
 
-			ts->tv_sec = mts.tv_sec;
-			ts->tv_nsec = mts.tv_nsec;
+			if (!::QueryPerformanceFrequency(&Freq) || !::QueryPerformanceCounter(&Counter))  return 0;
 
-			return 0;
-	#else
-			return clock_gettime(CLOCK_REALTIME, ts);
-	#endif
+			return (std::uint64_t)(Counter.QuadPart / Freq.QuadPart) * 1000000000ULL + (std::uint64_t)(Counter.QuadPart % Freq.QuadPart) * 1000000000ULL / (std::uint64_t)Freq.QuadPart;
 		}
-
+#else
 		// POSIX pthreads.
 		ThreadIDType Util::GetCurrentThreadID()
 		{
@@ -94,6 +89,24 @@ namespace CubicleSoft
 			return (std::uint64_t)((std::uint64_t)TempTime.tv_sec * (std::uint64_t)1000000 + (std::uint64_t)TempTime.tv_usec);
 		}
 
+		std::uint64_t Util::GetMonotonicNanosecondTime()
+		{
+	#ifdef __APPLE__
+			// Dear Apple:  You hire plenty of developers, so please fix your OS.
+			static mach_timebase_info_data_t TimebaseInfo;
+
+			if (!TimebaseInfo.denom)  mach_timebase_info(&TimebaseInfo);
+
+			return (std::uint64_t)mach_absolute_time() * TimebaseInfo.numer / TimebaseInfo.denom;
+	#else
+			struct timespec TempTime;
+
+			if (clock_gettime(CLOCK_MONOTONIC, &TempTime) != 0)  return 0;
+
+			return (std::uint64_t)TempTime.tv_sec * 1000000000ULL + (std::uint64_t)TempTime.tv_nsec;
+	#endif
+		}
+
 		size_t Util::GetUnixSystemAlignmentSize()
 		{
 			struct {
@@ -341,6 +354,137 @@ namespace CubicleSoft
 			Mem += AlignUnixSize(sizeof(std::uint32_t));
 
 			Result.MxCond = reinterpret_cast<pthread_cond_t *>(Mem);
+			Result.MxWaiters = reinterpret_cast<std::uint32_t *>(Mem);
+		}
+
+	#ifdef __linux__
+		// Linux futex support.  Futexes are not private to the process since the memory might be shared.
+		inline int CSGX__FutexWait(volatile std::uint32_t *Addr, std::uint32_t Val, struct timespec *Timeout)
+		{
+			return (int)syscall(SYS_futex, Addr, FUTEX_WAIT, Val, Timeout, NULL, 0);
+		}
+
+		inline void CSGX__FutexWake(volatile std::uint32_t *Addr, int Num)
+		{
+			syscall(SYS_futex, Addr, FUTEX_WAKE, Num, NULL, NULL, 0);
+		}
+
+		std::uint64_t CSGX__GetFutexDeadline(std::uint64_t WaitNS)
+		{
+			if (WaitNS == INFINITE_NS || WaitNS == 0)  return 0;
+
+			std::uint64_t CurrTime = Util::GetMonotonicNanosecondTime();
+
+			return (WaitNS < INFINITE_NS - CurrTime ? CurrTime + WaitNS : INFINITE_NS - 1);
+		}
+
+		// FUTEX_WAIT timeouts are relative.  Returns false once the deadline has passed.
+		bool CSGX__GetFutexTimeout(struct timespec &Result, std::uint64_t Deadline)
+		{
+			std::uint64_t CurrTime = Util::GetMonotonicNanosecondTime();
+			if (CurrTime >= Deadline)  return false;
+
+			Result.tv_sec = (time_t)((Deadline - CurrTime) / 1000000000ULL);
+			Result.tv_nsec = (long)((Deadline - CurrTime) % 1000000000ULL);
+
+			return true;
+		}
+
+		void Util::InitUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore, bool, std::uint32_t Start, std::uint32_t Max)
+		{
+			if (Start > Max)  Start = Max;
+			UnixSemaphore.MxCount[0] = Start;
+			UnixSemaphore.MxMax[0] = Max;
+			UnixSemaphore.MxWaiters[0] = 0;
+		}
+
+		bool Util::WaitForUnixSemaphoreNS(UnixSemaphoreWrapper &UnixSemaphore, std::uint64_t WaitNS)
+		{
+			std::uint64_t Deadline = CSGX__GetFutexDeadline(WaitNS);
+			struct timespec TempTime;
+			std::uint32_t Count, Count2;
+
+			do
+			{
+				// Fast path.
+				Count = UnixSemaphore.MxCount[0];
+				while (Count)
+				{
+					Count2 = AtomicCompareExchange32(UnixSemaphore.MxCount, Count - 1, Count);
+					if (Count2 == Count)  return true;
+
+					Count = Count2;
+				}
+
+				if (WaitNS == 0)  return false;
+				if (WaitNS != INFINITE_NS && !CSGX__GetFutexTimeout(TempTime, Deadline))  return false;
+
+				// Sleep until the count changes from 0.
+				AtomicAdd32(UnixSemaphore.MxWaiters, 1);
+				if (!UnixSemaphore.MxCount[0])  CSGX__FutexWait(UnixSemaphore.MxCount, 0, (WaitNS == INFINITE_NS ? NULL : &TempTime));
+				AtomicAdd32(UnixSemaphore.MxWaiters, (std::uint32_t)-1);
+			} while (1);
+		}
+
+		bool Util::ReleaseUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore, std::uint32_t *PrevVal)
+		{
+			std::uint32_t Count, Count2 = UnixSemaphore.MxCount[0];
+
+			do
+			{
+				Count = Count2;
+				Count2 = AtomicCompareExchange32(UnixSemaphore.MxCount, (Count < UnixSemaphore.MxMax[0] ? Count + 1 : UnixSemaphore.MxMax[0]), Count);
+			} while (Count2 != Count);
+
+			if (PrevVal != NULL)  *PrevVal = Count;
+
+			// Let a waiting thread have at it.
+			if (UnixSemaphore.MxWaiters[0])  CSGX__FutexWake(UnixSemaphore.MxCount, 1);
+
+			return true;
+		}
+
+		void Util::FreeUnixSemaphore(UnixSemaphoreWrapper &)
+		{
+		}
+	#else
+		// Timed waits use the monotonic clock so that system clock changes don't shorten or extend them.
+		void CSGX__InitCondAttrClock(pthread_condattr_t *CondAttr)
+		{
+		#ifdef __APPLE__
+			(void)CondAttr;
+		#else
+			pthread_condattr_setclock(CondAttr, CLOCK_MONOTONIC);
+		#endif
+		}
+
+		int CSGX__CondTimedWait(pthread_cond_t *Cond, pthread_mutex_t *Mutex, std::uint64_t Deadline)
+		{
+			struct timespec TempTime;
+
+		#ifdef __APPLE__
+			// Mac OSX doesn't support pthread_condattr_setclock() but does have relative waits.
+			std::uint64_t CurrTime = Util::GetMonotonicNanosecondTime();
+			if (CurrTime >= Deadline)  return ETIMEDOUT;
+
+			TempTime.tv_sec = (time_t)((Deadline - CurrTime) / 1000000000ULL);
+			TempTime.tv_nsec = (long)((Deadline - CurrTime) % 1000000000ULL);
+
+			return pthread_cond_timedwait_relative_np(Cond, Mutex, &TempTime);
+		#else
+			TempTime.tv_sec = (time_t)(Deadline / 1000000000ULL);
+			TempTime.tv_nsec = (long)(Deadline % 1000000000ULL);
+
+			return pthread_cond_timedwait(Cond, Mutex, &TempTime);
+		#endif
+		}
+
+		// Large finite waits are clamped instead of wrapping around to a deadline in the past.
+		std::uint64_t CSGX__GetCondDeadline(std::uint64_t WaitNS)
+		{
+			std::uint64_t CurrTime = Util::GetMonotonicNanosecondTime();
+
+			return (WaitNS < INFINITE_NS - CurrTime ? CurrTime + WaitNS : INFINITE_NS - 1);
 		}
 
 		void Util::InitUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore, bool Shared, std::uint32_t Start, std::uint32_t Max)
@@ -350,6 +494,7 @@ namespace CubicleSoft
 
 			pthread_mutexattr_init(&MutexAttr);
 			pthread_condattr_init(&CondAttr);
+			CSGX__InitCondAttrClock(&CondAttr);
 
 			if (Shared)
 			{
@@ -367,9 +512,9 @@ namespace CubicleSoft
 			pthread_mutexattr_destroy(&MutexAttr);
 		}
 
-		bool Util::WaitForUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore, std::uint32_t Wait)
+		bool Util::WaitForUnixSemaphoreNS(UnixSemaphoreWrapper &UnixSemaphore, std::uint64_t WaitNS)
 		{
-			if (Wait == 0)
+			if (WaitNS == 0)
 			{
 				// Avoid the scenario of deadlock on the semaphore itself for 0 wait.
 				if (pthread_mutex_trylock(UnixSemaphore.MxMutex) != 0)  return false;
@@ -387,7 +532,7 @@ namespace CubicleSoft
 
 				Result = true;
 			}
-			else if (Wait == INFINITE)
+			else if (WaitNS == INFINITE_NS)
 			{
 				int Result2;
 				do
@@ -403,25 +548,19 @@ namespace CubicleSoft
 					Result = true;
 				}
 			}
-			else if (Wait == 0)
+			else if (WaitNS == 0)
 			{
 				// Failed to obtain lock.  Nothing to do.
 			}
 			else
 			{
-				struct timespec TempTime;
-
-				if (CSGX__ClockGetTimeRealtime(&TempTime) == -1)  return false;
-				TempTime.tv_sec += Wait / 1000;
-				TempTime.tv_nsec += (Wait % 1000) * 1000000;
-				TempTime.tv_sec += TempTime.tv_nsec / 1000000000;
-				TempTime.tv_nsec = TempTime.tv_nsec % 1000000000;
+				std::uint64_t Deadline = CSGX__GetCondDeadline(WaitNS);
 
 				int Result2;
 				do
 				{
 					// Some platforms have pthread_cond_timedwait() but not pthread_mutex_timedlock() or sem_timedwait() (e.g. Mac OSX).
-					Result2 = pthread_cond_timedwait(UnixSemaphore.MxCond, UnixSemaphore.MxMutex, &TempTime);
+					Result2 = CSGX__CondTimedWait(UnixSemaphore.MxCond, UnixSemaphore.MxMutex, Deadline);
 					if (Result2 != 0)  break;
 				} while (!UnixSemaphore.MxCount[0]);
 
@@ -459,6 +598,7 @@ namespace CubicleSoft
 			pthread_mutex_destroy(UnixSemaphore.MxMutex);
 			pthread_cond_destroy(UnixSemaphore.MxCond);
 		}
+	#endif
 
 
 		size_t Util::GetUnixEventSize()
@@ -479,8 +619,82 @@ namespace CubicleSoft
 			Mem += AlignUnixSize(sizeof(std::uint32_t));
 
 			Result.MxCond = reinterpret_cast<pthread_cond_t *>(Mem);
+			Result.MxSeq = reinterpret_cast<std::uint32_t *>(Mem);
+		}
+
+	#ifdef __linux__
+		void Util::InitUnixEvent(UnixEventWrapper &UnixEvent, bool, bool Manual, bool Signaled)
+		{
+			UnixEvent.MxManual[0] = (Manual ? '\x01' : '\x00');
+			UnixEvent.MxSignaled[0] = (Signaled ? '\x01' : '\x00');
+			UnixEvent.MxWaiting[0] = 0;
+			UnixEvent.MxSeq[0] = 0;
+		}
+
+		// Consumes the signal of auto events.
+		inline bool CSGX__TryWaitForUnixEvent(Util::UnixEventWrapper &UnixEvent)
+		{
+			if (UnixEvent.MxSignaled[0] == '\x00')  return false;
+			if (UnixEvent.MxManual[0] != '\x00')  return true;
+
+			return (__sync_val_compare_and_swap(UnixEvent.MxSignaled, '\x01', '\x00') == '\x01');
+		}
+
+		bool Util::WaitForUnixEventNS(UnixEventWrapper &UnixEvent, std::uint64_t WaitNS)
+		{
+			// Avoid a potential starvation issue by only allowing signaled manual events OR if there are no other waiting threads.
+			if ((UnixEvent.MxManual[0] != '\x00' || !UnixEvent.MxWaiting[0]) && CSGX__TryWaitForUnixEvent(UnixEvent))  return true;
+			if (WaitNS == 0)  return false;
+
+			std::uint64_t Deadline = CSGX__GetFutexDeadline(WaitNS);
+			struct timespec TempTime;
+			std::uint32_t Seq;
+			bool Result;
+
+			AtomicAdd32(UnixEvent.MxWaiting, 1);
+
+			do
+			{
+				Seq = UnixEvent.MxSeq[0];
+
+				Result = CSGX__TryWaitForUnixEvent(UnixEvent);
+				if (Result)  break;
+				if (WaitNS != INFINITE_NS && !CSGX__GetFutexTimeout(TempTime, Deadline))  break;
+
+				// Sleep until the event is fired.
+				CSGX__FutexWait(UnixEvent.MxSeq, Seq, (WaitNS == INFINITE_NS ? NULL : &TempTime));
+			} while (1);
+
+			AtomicAdd32(UnixEvent.MxWaiting, (std::uint32_t)-1);
+
+			return Result;
+		}
+
+		bool Util::FireUnixEvent(UnixEventWrapper &UnixEvent)
+		{
+			__sync_lock_test_and_set(UnixEvent.MxSignaled, '\x01');
+			AtomicAdd32(UnixEvent.MxSeq, 1);
+
+			// Let all waiting threads through for manual events, otherwise just one waiting thread (if any).
+			if (UnixEvent.MxWaiting[0])  CSGX__FutexWake(UnixEvent.MxSeq, (UnixEvent.MxManual[0] != '\x00' ? INT_MAX : 1));
+
+			return true;
 		}
 
+		// Only call for manual events.
+		bool Util::ResetUnixEvent(UnixEventWrapper &UnixEvent)
+		{
+			if (UnixEvent.MxManual[0] == '\x00')  return false;
+
+			__sync_lock_test_and_set(UnixEvent.MxSignaled, '\x00');
+
+			return true;
+		}
+
+		void Util::FreeUnixEvent(UnixEventWrapper &)
+		{
+		}
+	#else
 		void Util::InitUnixEvent(UnixEventWrapper &UnixEvent, bool Shared, bool Manual, bool Signaled)
 		{
 			pthread_mutexattr_t MutexAttr;
@@ -488,6 +702,7 @@ namespace CubicleSoft
 
 			pthread_mutexattr_init(&MutexAttr);
 			pthread_condattr_init(&CondAttr);
+			CSGX__InitCondAttrClock(&CondAttr);
 
 			if (Shared)
 			{
@@ -505,9 +720,9 @@ namespace CubicleSoft
 			pthread_mutexattr_destroy(&MutexAttr);
 		}
 
-		bool Util::WaitForUnixEvent(UnixEventWrapper &UnixEvent, std::uint32_t Wait)
+		bool Util::WaitForUnixEventNS(UnixEventWrapper &UnixEvent, std::uint64_t WaitNS)
 		{
-			if (Wait == 0)
+			if (WaitNS == 0)
 			{
 				// Avoid the scenario of deadlock on the semaphore itself for 0 wait.
 				if (pthread_mutex_trylock(UnixEvent.MxMutex) != 0)  return false;
@@ -527,7 +742,7 @@ namespace CubicleSoft
 
 				Result = true;
 			}
-			else if (Wait == INFINITE)
+			else if (WaitNS == INFINITE_NS)
 			{
 				UnixEvent.MxWaiting[0]++;
 
@@ -548,25 +763,13 @@ namespace CubicleSoft
 					Result = true;
 				}
 			}
-			else if (Wait == 0)
+			else if (WaitNS == 0)
 			{
 				// Failed to obtain lock.  Nothing to do.
 			}
 			else
 			{
-				struct timespec TempTime;
-
-				if (CSGX__ClockGetTimeRealtime(&TempTime) == -1)
-				{
-					pthread_mutex_unlock(UnixEvent.MxMutex);
-
-					return false;
-				}
-
-				TempTime.tv_sec += Wait / 1000;
-				TempTime.tv_nsec += (Wait % 1000) * 1000000;
-				TempTime.tv_sec += TempTime.tv_nsec / 1000000000;
-				TempTime.tv_nsec = TempTime.tv_nsec % 1000000000;
+				std::uint64_t Deadline = CSGX__GetCondDeadline(WaitNS);
 
 				UnixEvent.MxWaiting[0]++;
 
@@ -574,7 +777,7 @@ namespace CubicleSoft
 				do
 				{
 					// Some platforms have pthread_cond_timedwait() but not pthread_mutex_timedlock() or sem_timedwait() (e.g. Mac OSX).
-					Result2 = pthread_cond_timedwait(UnixEvent.MxCond, UnixEvent.MxMutex, &TempTime);
+					Result2 = CSGX__CondTimedWait(UnixEvent.MxCond, UnixEvent.MxMutex, Deadline);
 					if (Result2 != 0)  break;
 				} while (UnixEvent.MxSignaled[0] == '\x00');
 
@@ -627,6 +830,135 @@ namespace CubicleSoft
 			pthread_mutex_destroy(UnixEvent.MxMutex);
 			pthread_cond_destroy(UnixEvent.MxCond);
 		}
+	#endif
+
+
+	#ifdef __linux__
+		// Not all kernel headers define futex_waitv() (Linux 5.16 and later).
+		#ifndef SYS_futex_waitv
+			#define SYS_futex_waitv   449
+		#endif
+
+		#define CUBICLESOFT_SYNC_UTIL_FUTEX_WAITV_MAX   128
+		#define CUBICLESOFT_SYNC_UTIL_FUTEX2_SIZE_U32   0x02
+
+		struct CSGX__FutexWaitv
+		{
+			std::uint64_t val;
+			std::uint64_t uaddr;
+			std::uint32_t flags;
+			std::uint32_t __reserved;
+		};
+
+		static volatile bool CSGX__NoFutexWaitv = false;
+
+		bool Util::TryWaitForUnixEvent(UnixEventWrapper &UnixEvent)
+		{
+			return CSGX__TryWaitForUnixEvent(UnixEvent);
+		}
+
+		void Util::BeginUnixWaitMultiple(UnixWaitMultipleInfo *Infos, size_t Num)
+		{
+			for (size_t x = 0; x < Num; x++)
+			{
+				if (Infos[x].MxSemaphore != NULL)  AtomicAdd32(Infos[x].MxSemaphore->MxWaiters, 1);
+				else
+				{
+					AtomicAdd32(Infos[x].MxEvent->MxWaiting, 1);
+					Infos[x].MxSeq = Infos[x].MxEvent->MxSeq[0];
+				}
+
+				Infos[x].MxSleep = true;
+			}
+		}
+
+		void Util::SleepUnixWaitMultiple(UnixWaitMultipleInfo *Infos, size_t Num, std::uint64_t WaitNS)
+		{
+			if (!CSGX__NoFutexWaitv)
+			{
+				CSGX__FutexWaitv Waiters[CUBICLESOFT_SYNC_UTIL_FUTEX_WAITV_MAX];
+				size_t x, y = 0;
+
+				for (x = 0; x < Num && y < CUBICLESOFT_SYNC_UTIL_FUTEX_WAITV_MAX; x++)
+				{
+					if (!Infos[x].MxSleep)  continue;
+
+					// Semaphores sleep while the count is 0.  Events sleep until the sequence number changes.
+					if (Infos[x].MxSemaphore != NULL)
+					{
+						Waiters[y].val = 0;
+						Waiters[y].uaddr = (std::uint64_t)(size_t)Infos[x].MxSemaphore->MxCount;
+					}
+					else
+					{
+						Waiters[y].val = Infos[x].MxSeq;
+						Waiters[y].uaddr = (std::uint64_t)(size_t)Infos[x].MxEvent->MxSeq;
+					}
+
+					Waiters[y].flags = CUBICLESOFT_SYNC_UTIL_FUTEX2_SIZE_U32;
+					Waiters[y].__reserved = 0;
+					y++;
+				}
+
+				if (!y)  return;
+
+				// futex_waitv() timeouts are absolute.
+				struct timespec TempTime;
+				std::uint64_t Deadline = CSGX__GetFutexDeadline(WaitNS);
+				if (Deadline)
+				{
+					TempTime.tv_sec = (time_t)(Deadline / 1000000000ULL);
+					TempTime.tv_nsec = (long)(Deadline % 1000000000ULL);
+				}
+
+				if (syscall(SYS_futex_waitv, Waiters, (unsigned int)y, 0, (Deadline ? &TempTime : NULL), CLOCK_MONOTONIC) > -1 || errno != ENOSYS)  return;
+
+				CSGX__NoFutexWaitv = true;
+			}
+
+			usleep(WaitNS < 1000000 ? (useconds_t)(WaitNS / 1000) : 1000);
+		}
+
+		void Util::EndUnixWaitMultiple(UnixWaitMultipleInfo *Infos, size_t Num)
+		{
+			for (size_t x = 0; x < Num; x++)
+			{
+				if (Infos[x].MxSemaphore != NULL)
+				{
+					AtomicAdd32(Infos[x].MxSemaphore->MxWaiters, (std::uint32_t)-1);
+
+					// A release may have woken this thread instead of a regular waiter.  Pass it along.
+					if (Infos[x].MxSemaphore->MxCount[0] && Infos[x].MxSemaphore->MxWaiters[0])  CSGX__FutexWake(Infos[x].MxSemaphore->MxCount, 1);
+				}
+				else
+				{
+					AtomicAdd32(Infos[x].MxEvent->MxWaiting, (std::uint32_t)-1);
+
+					if (Infos[x].MxEvent->MxSignaled[0] != '\x00' && Infos[x].MxEvent->MxWaiting[0])  CSGX__FutexWake(Infos[x].MxEvent->MxSeq, 1);
+				}
+			}
+		}
+	#else
+		bool Util::TryWaitForUnixEvent(UnixEventWrapper &UnixEvent)
+		{
+			return WaitForUnixEvent(UnixEvent, 0);
+		}
+
+		void Util::BeginUnixWaitMultiple(UnixWaitMultipleInfo *Infos, size_t Num)
+		{
+			for (size_t x = 0; x < Num; x++)  Infos[x].MxSleep = true;
+		}
+
+		void Util::SleepUnixWaitMultiple(UnixWaitMultipleInfo *, size_t, std::uint64_t WaitNS)
+		{
+			// Condition variables can't be waited on together.
+			usleep(WaitNS < 1000000 ? (useconds_t)(WaitNS / 1000) : 1000);
+		}
+
+		void Util::EndUnixWaitMultiple(UnixWaitMultipleInfo *, size_t)
+		{
+		}
+	#endif
 #endif
 	}
 }
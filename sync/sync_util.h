@@ -16,6 +16,11 @@
 	#define INFINITE   0xFFFFFFFF
 #endif
 
+// Nanosecond equivalent of INFINITE for the ...NS() wait functions.
+#ifndef INFINITE_NS
+	#define INFINITE_NS   0xFFFFFFFFFFFFFFFFULL
+#endif
+
 // Cross-platform utility class/functions.
 namespace CubicleSoft
 {
@@ -33,6 +38,119 @@ namespace CubicleSoft
 			static ThreadIDType GetCurrentThreadID();
 			static std::uint64_t GetUnixMicrosecondTime();
 
+			// Not affected by system clock changes.  Only useful for measuring intervals.
+			static std::uint64_t GetMonotonicNanosecondTime();
+
+			// Converts between millisecond and nanosecond waits, keeping INFINITE.  Nanoseconds round up to the next millisecond.
+			// The ...NS() wait functions of the Sync classes take nanoseconds (INFINITE_NS waits forever) and measure them with a monotonic clock, so clock changes don't affect them.
+			// Windows waits on kernel objects round up to the next millisecond.
+			static inline std::uint64_t GetWaitNS(std::uint32_t Wait)
+			{
+				return (Wait == INFINITE ? INFINITE_NS : (std::uint64_t)Wait * 1000000ULL);
+			}
+
+			static inline std::uint32_t GetWaitMS(std::uint64_t WaitNS)
+			{
+				if (WaitNS == INFINITE_NS)  return INFINITE;
+
+				WaitNS = (WaitNS + 999999ULL) / 1000000ULL;
+
+				return (WaitNS >= INFINITE ? INFINITE - 1 : (std::uint32_t)WaitNS);
+			}
+
+			// Lock-free atomic operations.  Each function acts as a full memory barrier.
+			// Safe to use on memory shared across processes.
+			static inline void *AtomicCompareExchangePtr(void * volatile *Dest, void *Exchange, void *Comparand)
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				return ::InterlockedCompareExchangePointer((PVOID volatile *)Dest, Exchange, Comparand);
+#else
+				return __sync_val_compare_and_swap(Dest, Comparand, Exchange);
+#endif
+			}
+
+			static inline void *AtomicExchangePtr(void * volatile *Dest, void *Val)
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				return ::InterlockedExchangePointer((PVOID volatile *)Dest, Val);
+#else
+				return __atomic_exchange_n(Dest, Val, __ATOMIC_SEQ_CST);
+#endif
+			}
+
+			// Returns the previous value.
+			static inline std::uint32_t AtomicCompareExchange32(volatile std::uint32_t *Dest, std::uint32_t Exchange, std::uint32_t Comparand)
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				return (std::uint32_t)::InterlockedCompareExchange((volatile LONG *)Dest, (LONG)Exchange, (LONG)Comparand);
+#else
+				return __sync_val_compare_and_swap(Dest, Comparand, Exchange);
+#endif
+			}
+
+			// Returns the previous value.  Plain loads of aligned 64-bit values are only atomic on 64-bit platforms.
+			static inline std::uint64_t AtomicCompareExchange64(volatile std::uint64_t *Dest, std::uint64_t Exchange, std::uint64_t Comparand)
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				return (std::uint64_t)::InterlockedCompareExchange64((volatile LONG64 *)Dest, (LONG64)Exchange, (LONG64)Comparand);
+#else
+				return __sync_val_compare_and_swap(Dest, Comparand, Exchange);
+#endif
+			}
+
+			// Returns the new value.
+			static inline std::uint32_t AtomicAdd32(volatile std::uint32_t *Dest, std::uint32_t Val)
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				return (std::uint32_t)::InterlockedExchangeAdd((volatile LONG *)Dest, (LONG)Val) + Val;
+#else
+				return __sync_add_and_fetch(Dest, Val);
+#endif
+			}
+
+			// Memory fences for ordering plain loads and stores around atomic operations.
+			static inline void AcquireFence()
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				MemoryBarrier();
+#else
+				__atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+			}
+
+			static inline void ReleaseFence()
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				MemoryBarrier();
+#else
+				__atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+			}
+
+			// Orders earlier stores before later loads (e.g. store flag, then check the other side's flag).
+			static inline void FullFence()
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				MemoryBarrier();
+#else
+				__sync_synchronize();
+#endif
+			}
+
+			// Hints to the CPU that the caller is in a spin-wait loop.
+			static inline void CPUPause()
+			{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+				YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+				__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+				__asm__ __volatile__("yield" ::: "memory");
+#else
+				__sync_synchronize();
+#endif
+			}
+
 #if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
 #else
 			// *NIX OSes require a lot of extra logic for named object support.
@@ -47,6 +165,8 @@ namespace CubicleSoft
 			// Some platforms are broken even for unnamed semaphores (e.g. Mac OSX).
 			// Implements semaphores directly, bypassing POSIX semaphores.
 			// Semaphores can be used in place of mutexes (i.e. Start = 1, Max = 1).
+			// On Linux, uncontended operations are a single atomic operation on MxCount and waiting uses futexes.
+			// MxWaiters then occupies the start of the otherwise unused condition variable space so the shared memory layout stays the same.
 			class UnixSemaphoreWrapper
 			{
 			public:
@@ -54,16 +174,19 @@ namespace CubicleSoft
 				volatile std::uint32_t *MxCount;
 				volatile std::uint32_t *MxMax;
 				pthread_cond_t *MxCond;
+				volatile std::uint32_t *MxWaiters;
 			};
 
 			static size_t GetUnixSemaphoreSize();
 			static void GetUnixSemaphore(UnixSemaphoreWrapper &Result, char *Mem);
 			static void InitUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore, bool Shared, std::uint32_t Start, std::uint32_t Max);
-			static bool WaitForUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore, std::uint32_t Wait);
+			static bool WaitForUnixSemaphoreNS(UnixSemaphoreWrapper &UnixSemaphore, std::uint64_t WaitNS);
+			static inline bool WaitForUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore, std::uint32_t Wait)  { return WaitForUnixSemaphoreNS(UnixSemaphore, GetWaitNS(Wait)); }
 			static bool ReleaseUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore, std::uint32_t *PrevVal);
 			static void FreeUnixSemaphore(UnixSemaphoreWrapper &UnixSemaphore);
 
 			// Implements a more efficient (and portable) event object interface than trying to use semaphores.
+			// On Linux, MxSignaled is accessed atomically and waiters sleep on the MxSeq futex, which occupies the condition variable space.
 			class UnixEventWrapper
 			{
 			public:
@@ -72,15 +195,33 @@ namespace CubicleSoft
 				volatile char *MxSignaled;
 				volatile std::uint32_t *MxWaiting;
 				pthread_cond_t *MxCond;
+				volatile std::uint32_t *MxSeq;
 			};
 
 			static size_t GetUnixEventSize();
 			static void GetUnixEvent(UnixEventWrapper &Result, char *Mem);
 			static void InitUnixEvent(UnixEventWrapper &UnixEvent, bool Shared, bool Manual, bool Signaled = false);
-			static bool WaitForUnixEvent(UnixEventWrapper &UnixEvent, std::uint32_t Wait);
+			static bool WaitForUnixEventNS(UnixEventWrapper &UnixEvent, std::uint64_t WaitNS);
+			static inline bool WaitForUnixEvent(UnixEventWrapper &UnixEvent, std::uint32_t Wait)  { return WaitForUnixEventNS(UnixEvent, GetWaitNS(Wait)); }
 			static bool FireUnixEvent(UnixEventWrapper &UnixEvent);
 			static bool ResetUnixEvent(UnixEventWrapper &UnixEvent);
 			static void FreeUnixEvent(UnixEventWrapper &UnixEvent);
+
+			// Sync::WaitMultiple support.  Register on every object, attempt to acquire them, sleep until any of them changes, then unregister.
+			// On Linux, sleeping uses a single futex_waitv() call.  Other platforms (and older kernels) fall back to sleeping for short intervals.
+			class UnixWaitMultipleInfo
+			{
+			public:
+				UnixSemaphoreWrapper *MxSemaphore;
+				UnixEventWrapper *MxEvent;
+				std::uint32_t MxSeq;
+				bool MxSleep;
+			};
+
+			static bool TryWaitForUnixEvent(UnixEventWrapper &UnixEvent);
+			static void BeginUnixWaitMultiple(UnixWaitMultipleInfo *Infos, size_t Num);
+			static void SleepUnixWaitMultiple(UnixWaitMultipleInfo *Infos, size_t Num, std::uint64_t WaitNS);
+			static void EndUnixWaitMultiple(UnixWaitMultipleInfo *Infos, size_t Num);
 #endif
 		};
 	}
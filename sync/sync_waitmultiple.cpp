@@ -0,0 +1,238 @@
+// Cross-platform wait on multiple events, semaphores, and mutexes (named or unnamed) at the same time.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#include "sync_waitmultiple.h"
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		WaitMultiple::WaitMultiple() : MxNum(0)
+		{
+		}
+
+		bool WaitMultiple::Add(Event *Obj)
+		{
+			if (MxNum >= CUBICLESOFT_SYNC_WAITMULTIPLE_MAX)  return false;
+
+			MxTypes[MxNum] = TypeEvent;
+			MxObjs[MxNum] = Obj;
+			MxNum++;
+
+			return true;
+		}
+
+		bool WaitMultiple::Add(Semaphore *Obj)
+		{
+			if (MxNum >= CUBICLESOFT_SYNC_WAITMULTIPLE_MAX)  return false;
+
+			MxTypes[MxNum] = TypeSemaphore;
+			MxObjs[MxNum] = Obj;
+			MxNum++;
+
+			return true;
+		}
+
+		bool WaitMultiple::Add(Mutex *Obj)
+		{
+			if (MxNum >= CUBICLESOFT_SYNC_WAITMULTIPLE_MAX)  return false;
+
+			MxTypes[MxNum] = TypeMutex;
+			MxObjs[MxNum] = Obj;
+			MxNum++;
+
+			return true;
+		}
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+		// Windows.
+		bool WaitMultiple::WaitNS(bool All, std::uint64_t WaitNS, size_t *Index)
+		{
+			if (!MxNum)  return false;
+
+			HANDLE Handles[CUBICLESOFT_SYNC_WAITMULTIPLE_MAX];
+			size_t x;
+
+			for (x = 0; x < MxNum; x++)
+			{
+				if (MxTypes[x] == TypeEvent)  Handles[x] = ((Event *)MxObjs[x])->MxWinWaitEvent;
+				else if (MxTypes[x] == TypeSemaphore)  Handles[x] = ((Semaphore *)MxObjs[x])->MxWinSemaphore;
+				else  Handles[x] = ((Mutex *)MxObjs[x])->MxWinMutex;
+
+				if (Handles[x] == NULL)  return false;
+			}
+
+			DWORD Result = ::WaitForMultipleObjects((DWORD)MxNum, Handles, (All ? TRUE : FALSE), Util::GetWaitMS(WaitNS));
+			if (Result >= WAIT_OBJECT_0 && Result < WAIT_OBJECT_0 + MxNum)  x = Result - WAIT_OBJECT_0;
+			else if (Result >= WAIT_ABANDONED_0 && Result < WAIT_ABANDONED_0 + MxNum)  x = Result - WAIT_ABANDONED_0;
+			else  return false;
+
+			// Mutexes track their owner outside of the kernel object.
+			if (!All)
+			{
+				if (MxTypes[x] == TypeMutex)  MutexAcquired((Mutex *)MxObjs[x]);
+			}
+			else
+			{
+				for (x = 0; x < MxNum; x++)
+				{
+					if (MxTypes[x] == TypeMutex)  MutexAcquired((Mutex *)MxObjs[x]);
+				}
+			}
+
+			if (Index != NULL)  *Index = (All ? 0 : x);
+
+			return true;
+		}
+
+		void WaitMultiple::MutexAcquired(Mutex *Obj)
+		{
+			::EnterCriticalSection(&Obj->MxWinCritSection);
+
+			if (Obj->MxOwnerID == Util::GetCurrentThreadID())
+			{
+				// Windows mutexes are recursive.  Keep the kernel object at a single level like Mutex::Lock() does.
+				Obj->MxCount++;
+				::ReleaseMutex(Obj->MxWinMutex);
+			}
+			else
+			{
+				Obj->MxOwnerID = Util::GetCurrentThreadID();
+				Obj->MxCount = 1;
+			}
+
+			::LeaveCriticalSection(&Obj->MxWinCritSection);
+		}
+#else
+		// POSIX pthreads.
+		bool WaitMultiple::WaitNS(bool All, std::uint64_t WaitNS, size_t *Index)
+		{
+			if (!MxNum)  return false;
+
+			Util::UnixWaitMultipleInfo Infos[CUBICLESOFT_SYNC_WAITMULTIPLE_MAX];
+			size_t x, y;
+
+			for (x = 0; x < MxNum; x++)
+			{
+				Infos[x].MxSemaphore = NULL;
+				Infos[x].MxEvent = NULL;
+
+				if (MxTypes[x] == TypeEvent)
+				{
+					if (((Event *)MxObjs[x])->MxMem == NULL)  return false;
+
+					Infos[x].MxEvent = &((Event *)MxObjs[x])->MxPthreadEvent;
+				}
+				else if (MxTypes[x] == TypeSemaphore)
+				{
+					if (((Semaphore *)MxObjs[x])->MxMem == NULL)  return false;
+
+					Infos[x].MxSemaphore = &((Semaphore *)MxObjs[x])->MxPthreadSemaphore;
+				}
+				else
+				{
+					if (((Mutex *)MxObjs[x])->MxMem == NULL)  return false;
+
+					Infos[x].MxSemaphore = &((Mutex *)MxObjs[x])->MxPthreadMutex;
+				}
+			}
+
+			std::uint64_t StartTime = 0, Elapsed = 0;
+			bool Result;
+
+			do
+			{
+				// Registering first avoids missing a release or fire that happens between the attempt and going to sleep.
+				Util::BeginUnixWaitMultiple(Infos, MxNum);
+
+				Result = false;
+				if (!All)
+				{
+					for (x = 0; x < MxNum && !Result; x++)
+					{
+						if (TryAcquire(x))
+						{
+							if (Index != NULL)  *Index = x;
+
+							Result = true;
+						}
+					}
+				}
+				else
+				{
+					for (x = 0; x < MxNum && TryAcquire(x); x++)
+					{
+					}
+
+					if (x == MxNum)
+					{
+						if (Index != NULL)  *Index = 0;
+
+						Result = true;
+					}
+					else
+					{
+						// Put back what was acquired and sleep until the unavailable object changes.
+						for (y = 0; y < x; y++)
+						{
+							UndoAcquire(y);
+
+							Infos[y].MxSleep = false;
+						}
+
+						for (y = x + 1; y < MxNum; y++)  Infos[y].MxSleep = false;
+					}
+				}
+
+				if (!Result && WaitNS != 0)
+				{
+					if (WaitNS != INFINITE_NS)
+					{
+						if (!StartTime)  StartTime = Util::GetMonotonicNanosecondTime();
+						else  Elapsed = Util::GetMonotonicNanosecondTime() - StartTime;
+					}
+
+					if (WaitNS == INFINITE_NS || Elapsed < WaitNS)
+					{
+						Util::SleepUnixWaitMultiple(Infos, MxNum, (WaitNS == INFINITE_NS ? INFINITE_NS : WaitNS - Elapsed));
+
+						Util::EndUnixWaitMultiple(Infos, MxNum);
+
+						continue;
+					}
+				}
+
+				Util::EndUnixWaitMultiple(Infos, MxNum);
+
+				return Result;
+			} while (1);
+		}
+
+		bool WaitMultiple::TryAcquire(size_t Pos)
+		{
+			if (MxTypes[Pos] == TypeEvent)  return Util::TryWaitForUnixEvent(((Event *)MxObjs[Pos])->MxPthreadEvent);
+			else if (MxTypes[Pos] == TypeSemaphore)  return Util::WaitForUnixSemaphore(((Semaphore *)MxObjs[Pos])->MxPthreadSemaphore, 0);
+
+			return ((Mutex *)MxObjs[Pos])->Lock(0);
+		}
+
+		void WaitMultiple::UndoAcquire(size_t Pos)
+		{
+			if (MxTypes[Pos] == TypeEvent)
+			{
+				// Manual events are not consumed by waiting.
+				Util::UnixEventWrapper &UnixEvent = ((Event *)MxObjs[Pos])->MxPthreadEvent;
+				if (UnixEvent.MxManual[0] == '\x00')  Util::FireUnixEvent(UnixEvent);
+			}
+			else if (MxTypes[Pos] == TypeSemaphore)
+			{
+				Util::ReleaseUnixSemaphore(((Semaphore *)MxObjs[Pos])->MxPthreadSemaphore, NULL);
+			}
+			else
+			{
+				((Mutex *)MxObjs[Pos])->Unlock();
+			}
+		}
+#endif
+	}
+}
@@ -0,0 +1,64 @@
+// Cross-platform wait on multiple events, semaphores, and mutexes (named or unnamed) at the same time.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#ifndef CUBICLESOFT_SYNC_WAITMULTIPLE
+#define CUBICLESOFT_SYNC_WAITMULTIPLE
+
+#include "sync_event.h"
+#include "sync_semaphore.h"
+#include "sync_mutex.h"
+
+// The same limit as WaitForMultipleObjects() on Windows.
+#define CUBICLESOFT_SYNC_WAITMULTIPLE_MAX   64
+
+namespace CubicleSoft
+{
+	namespace Sync
+	{
+		// Objects are not owned and must outlive their use here.  Do not add the same object more than once.
+		class WaitMultiple
+		{
+		public:
+			WaitMultiple();
+
+			// Returns false if the list is full.
+			bool Add(Event *Obj);
+			bool Add(Semaphore *Obj);
+			bool Add(Mutex *Obj);
+
+			inline void Clear()  { MxNum = 0; }
+			inline size_t GetSize()  { return MxNum; }
+
+			// Waits for any (All = false) or every (All = true) object to become available.  Wait is in milliseconds.
+			// Acquired objects are acquired exactly as if Lock()/Wait() had been called on them.  Unlock semaphores and mutexes as usual.
+			// For wait-any, Index receives the position of the acquired object.
+			inline bool Wait(bool All = false, std::uint32_t Wait = INFINITE, size_t *Index = NULL)  { return WaitNS(All, Util::GetWaitNS(Wait), Index); }
+			bool WaitNS(bool All, std::uint64_t WaitNS, size_t *Index = NULL);
+
+		private:
+			// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+			WaitMultiple(const WaitMultiple &);
+			WaitMultiple &operator=(const WaitMultiple &);
+
+			enum ObjectType
+			{
+				TypeEvent,
+				TypeSemaphore,
+				TypeMutex
+			};
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			void MutexAcquired(Mutex *Obj);
+#else
+			bool TryAcquire(size_t Pos);
+			void UndoAcquire(size_t Pos);
+#endif
+
+			size_t MxNum;
+			ObjectType MxTypes[CUBICLESOFT_SYNC_WAITMULTIPLE_MAX];
+			void *MxObjs[CUBICLESOFT_SYNC_WAITMULTIPLE_MAX];
+		};
+	}
+}
+
+#endif
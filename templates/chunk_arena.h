@@ -0,0 +1,135 @@
+// Chunked bump allocator for lots of small allocations that are all freed at the same time (e.g. hash keys).
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#ifndef CUBICLESOFT_CHUNK_ARENA
+#define CUBICLESOFT_CHUNK_ARENA
+
+#include <cstddef>
+
+namespace CubicleSoft
+{
+	// Allocations are packed one after another into large chunks and can't be freed individually.  Empty() frees all of them at once.
+	class ChunkArena
+	{
+	public:
+		typedef void *(*MallocFunc)(void *AllocData, size_t Size);
+		typedef void (*FreeFunc)(void *AllocData, void *Data);
+
+		// Chunks are allocated with new[] unless MallocFn and FreeFn are both set, in which case AllocData is passed to them.
+		// For example, (ChunkArena::MallocFunc)&Sync::TLS::malloc, (ChunkArena::FreeFunc)&Sync::TLS::free, and a pointer to a Sync::TLS object.
+		ChunkArena(size_t ChunkSize = 65536, MallocFunc MallocFn = NULL, FreeFunc FreeFn = NULL, void *AllocData = NULL)
+			: MxChunks(NULL), MxPos(NULL), MxEnd(NULL), MxChunkSize(ChunkSize < 256 ? 256 : ChunkSize), MxNumChunks(0), MxTotalSize(0),
+			MxMallocFn(MallocFn != NULL && FreeFn != NULL ? MallocFn : NULL), MxFreeFn(MallocFn != NULL && FreeFn != NULL ? FreeFn : NULL), MxAllocData(AllocData)
+		{
+		}
+
+		~ChunkArena()
+		{
+			Empty();
+		}
+
+		// Align must be a power of two no larger than 16.  Returns NULL if a chunk can't be allocated.
+		inline void *Alloc(size_t Size, size_t Align = 1)
+		{
+			char *Result = (char *)(((size_t)MxPos + Align - 1) & ~(Align - 1));
+			if (MxPos != NULL && Result <= MxEnd && Size <= (size_t)(MxEnd - Result))
+			{
+				MxPos = Result + Size;
+
+				return Result;
+			}
+
+			return AllocChunk(Size, Align);
+		}
+
+		// Frees every allocation.
+		void Empty()
+		{
+			Chunk *Next;
+
+			while (MxChunks != NULL)
+			{
+				Next = MxChunks->MxNext;
+
+				if (MxFreeFn != NULL)  MxFreeFn(MxAllocData, MxChunks->MxData);
+				else  delete[] (char *)MxChunks->MxData;
+
+				MxChunks = Next;
+			}
+
+			MxPos = NULL;
+			MxEnd = NULL;
+			MxNumChunks = 0;
+			MxTotalSize = 0;
+		}
+
+		inline size_t GetChunkSize() const  { return MxChunkSize; }
+		inline MallocFunc GetMallocFunc() const  { return MxMallocFn; }
+		inline FreeFunc GetFreeFunc() const  { return MxFreeFn; }
+		inline void *GetAllocData() const  { return MxAllocData; }
+
+		inline size_t GetNumChunks() const  { return MxNumChunks; }
+
+		// Total bytes of all chunks, including chunk headers and unused space.  Excludes alignment padding for custom allocators.
+		inline size_t GetTotalSize() const  { return MxTotalSize; }
+
+	private:
+		// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+		ChunkArena(const ChunkArena &);
+		ChunkArena &operator=(const ChunkArena &);
+
+		// Each chunk starts with this header.  MxData is the pointer that was allocated.
+		class Chunk
+		{
+		public:
+			Chunk *MxNext;
+			void *MxData;
+		};
+
+		void *AllocChunk(size_t Size, size_t Align)
+		{
+			// Large allocations get their own chunk so the current chunk can keep filling up.
+			bool Large = (Size + Align > (MxChunkSize >> 2));
+			size_t Size2 = sizeof(Chunk) + (Large ? Size + Align : MxChunkSize);
+
+			// Custom allocators might not return aligned memory (e.g. Sync::TLS), so the chunk header gets aligned manually.
+			void *Data = (MxMallocFn != NULL ? MxMallocFn(MxAllocData, Size2 + 15) : new char[Size2]);
+			if (Data == NULL)  return NULL;
+
+			Chunk *NewChunk = (Chunk *)(MxMallocFn != NULL ? (((size_t)Data + 15) & ~(size_t)15) : (size_t)Data);
+			NewChunk->MxData = Data;
+
+			MxNumChunks++;
+			MxTotalSize += Size2;
+
+			char *Result = (char *)(((size_t)(NewChunk + 1) + Align - 1) & ~(Align - 1));
+
+			if (Large && MxChunks != NULL)
+			{
+				NewChunk->MxNext = MxChunks->MxNext;
+				MxChunks->MxNext = NewChunk;
+			}
+			else
+			{
+				NewChunk->MxNext = MxChunks;
+				MxChunks = NewChunk;
+
+				MxPos = Result + Size;
+				MxEnd = (char *)NewChunk + Size2;
+			}
+
+			return Result;
+		}
+
+		// The first chunk is the one being filled.
+		Chunk *MxChunks;
+		char *MxPos, *MxEnd;
+		size_t MxChunkSize, MxNumChunks, MxTotalSize;
+
+		MallocFunc MxMallocFn;
+		FreeFunc MxFreeFn;
+		void *MxAllocData;
+	};
+}
+
+#endif
@@ -0,0 +1,257 @@
+// Thread-safe queues that accept the same detachable nodes as Queue.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#ifndef CUBICLESOFT_DETACHABLE_CONCURRENT_QUEUE
+#define CUBICLESOFT_DETACHABLE_CONCURRENT_QUEUE
+
+#include "detachable_queue.h"
+
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+	#include <windows.h>
+#endif
+
+namespace CubicleSoft
+{
+	// Pointer-sized atomic operations used by the concurrent queues.
+	// These mirror Sync::Util (e.g. CPUPause()) on purpose.  The templates are header-only and sync/ builds on them, so they must not depend on sync/.
+	class ConcurrentQueueUtil
+	{
+	public:
+		template <class T>
+		static inline T *Exchange(T **Dest, T *Val)
+		{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			return (T *)::InterlockedExchangePointer((PVOID volatile *)Dest, Val);
+#else
+			return __atomic_exchange_n(Dest, Val, __ATOMIC_ACQ_REL);
+#endif
+		}
+
+		template <class T>
+		static inline T *Load(T **Src)
+		{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			T *Result = *(T * volatile *)Src;
+			MemoryBarrier();
+
+			return Result;
+#else
+			return __atomic_load_n(Src, __ATOMIC_ACQUIRE);
+#endif
+		}
+
+		template <class T>
+		static inline void Store(T **Dest, T *Val)
+		{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			::InterlockedExchangePointer((PVOID volatile *)Dest, Val);
+#else
+			__atomic_store_n(Dest, Val, __ATOMIC_RELEASE);
+#endif
+		}
+
+		// Returns the previous value.
+		static inline long ExchangeFlag(volatile long *Dest, long Val)
+		{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			return ::InterlockedExchange(Dest, Val);
+#else
+			return __atomic_exchange_n(Dest, Val, __ATOMIC_ACQ_REL);
+#endif
+		}
+
+		static inline void ReleaseFlag(volatile long *Dest)
+		{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			::InterlockedExchange(Dest, 0);
+#else
+			__atomic_store_n(Dest, 0, __ATOMIC_RELEASE);
+#endif
+		}
+
+		static inline void Pause()
+		{
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+			YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+			__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+			__asm__ __volatile__("yield" ::: "memory");
+#else
+			__sync_synchronize();
+#endif
+		}
+	};
+
+	// Intrusive multiple producer, single consumer queue (Vyukov).
+	// Push() may be called by any number of threads at once and is one atomic exchange plus one store.  Shift() may only be called by one thread at a time.
+	// Nodes are never allocated or freed by Push(QueueNode<T> *) and Shift(), so they can be passed between threads and Queue objects freely.
+	template <class T>
+	class ConcurrentQueue
+	{
+	public:
+		ConcurrentQueue() : MxHead(&MxStub), MxTail(&MxStub)
+		{
+		}
+
+		~ConcurrentQueue()
+		{
+			Empty();
+		}
+
+		QueueNode<T> *Push(const T &Value)
+		{
+			QueueNode<T> *Node;
+
+			Node = new QueueNode<T>;
+			Node->Value = Value;
+
+			return Push(Node);
+		}
+
+		// Only use with detached nodes.
+		QueueNode<T> *Push(QueueNode<T> *Node)
+		{
+			if (Node->NextNode != NULL)  return NULL;
+
+			InternalPush(Node);
+
+			return Node;
+		}
+
+		// Consumer only.  Returns a detached node or NULL when the queue is empty.
+		// May also return NULL for a moment while a producer is in the middle of Push().
+		QueueNode<T> *Shift()
+		{
+			QueueNode<T> *Tail = MxTail;
+			QueueNode<T> *Next = ConcurrentQueueUtil::Load(&Tail->NextNode);
+
+			if (Tail == &MxStub)
+			{
+				if (Next == NULL)  return NULL;
+
+				MxTail = Next;
+				Tail = Next;
+				Next = ConcurrentQueueUtil::Load(&Next->NextNode);
+			}
+
+			if (Next == NULL)
+			{
+				// The last node can only be removed once something is behind it.  Put the stub node back.
+				if (Tail != ConcurrentQueueUtil::Load(&MxHead))  return NULL;
+
+				MxStub.NextNode = NULL;
+				InternalPush(&MxStub);
+
+				Next = ConcurrentQueueUtil::Load(&Tail->NextNode);
+				if (Next == NULL)  return NULL;
+			}
+
+			MxTail = Next;
+			Tail->NextNode = NULL;
+
+			return Tail;
+		}
+
+		// Consumer only.  Nodes that are still being pushed might not be seen yet.
+		inline bool IsEmpty()
+		{
+			return (MxTail == &MxStub && ConcurrentQueueUtil::Load(&MxStub.NextNode) == NULL);
+		}
+
+		// Consumer only.  Frees all nodes in the queue.
+		void Empty()
+		{
+			QueueNode<T> *Node;
+
+			while ((Node = Shift()) != NULL)  delete Node;
+		}
+
+	private:
+		// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+		ConcurrentQueue(const ConcurrentQueue<T> &);
+		ConcurrentQueue<T> &operator=(const ConcurrentQueue<T> &);
+
+		inline void InternalPush(QueueNode<T> *Node)
+		{
+			QueueNode<T> *Prev = ConcurrentQueueUtil::Exchange(&MxHead, Node);
+
+			// Until this store happens, the consumer sees the queue end at Prev.
+			ConcurrentQueueUtil::Store(&Prev->NextNode, Node);
+		}
+
+		// Producers only touch the head and consumers only touch the tail.  Keep them on separate cache lines.
+		QueueNode<T> *MxHead;
+		char MxPad1[64];
+		QueueNode<T> *MxTail;
+		char MxPad2[64];
+		QueueNode<T> MxStub;
+	};
+
+	// Multiple producer, multiple consumer queue with lock-free producers and spin-locked consumers.
+	// Producers are the same as ConcurrentQueue.  Consumers take turns via a spin flag, so Shift() can wait on another consumer.
+	// Node based lock-free dequeuing isn't safe when consumers may detach and reuse nodes while another consumer is still reading them (ABA).
+	template <class T>
+	class ConcurrentQueueMPMC
+	{
+	public:
+		ConcurrentQueueMPMC() : MxConsumerFlag(0)
+		{
+		}
+
+		inline QueueNode<T> *Push(const T &Value)  { return MxQueue.Push(Value); }
+
+		// Only use with detached nodes.
+		inline QueueNode<T> *Push(QueueNode<T> *Node)  { return MxQueue.Push(Node); }
+
+		// Returns a detached node or NULL when the queue is empty.
+		QueueNode<T> *Shift()
+		{
+			QueueNode<T> *Node;
+
+			while (ConcurrentQueueUtil::ExchangeFlag(&MxConsumerFlag, 1))
+			{
+				while (MxConsumerFlag)  ConcurrentQueueUtil::Pause();
+			}
+
+			Node = MxQueue.Shift();
+
+			ConcurrentQueueUtil::ReleaseFlag(&MxConsumerFlag);
+
+			return Node;
+		}
+
+		// Returns NULL instead of waiting when another consumer is busy.
+		QueueNode<T> *TryShift()
+		{
+			QueueNode<T> *Node;
+
+			if (ConcurrentQueueUtil::ExchangeFlag(&MxConsumerFlag, 1))  return NULL;
+
+			Node = MxQueue.Shift();
+
+			ConcurrentQueueUtil::ReleaseFlag(&MxConsumerFlag);
+
+			return Node;
+		}
+
+		// Frees all nodes in the queue.
+		void Empty()
+		{
+			QueueNode<T> *Node;
+
+			while ((Node = Shift()) != NULL)  delete Node;
+		}
+
+	private:
+		// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+		ConcurrentQueueMPMC(const ConcurrentQueueMPMC<T> &);
+		ConcurrentQueueMPMC<T> &operator=(const ConcurrentQueueMPMC<T> &);
+
+		ConcurrentQueue<T> MxQueue;
+		char MxPad[64];
+		volatile long MxConsumerFlag;
+	};
+}
+
+#endif
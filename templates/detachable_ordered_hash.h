@@ -7,22 +7,31 @@
 #include <cstdint>
 #include <cstddef>
 #include <cstring>
+#include "chunk_arena.h"
+#include "hash_policy.h"
 
 namespace CubicleSoft
 {
-	template <class T>
+	template <class HashFunc, class HashBucket>
+	class OrderedHashPolicy;
+	class OrderedHashBucketPrime;
+
+	// HashPolicy combines a hash function policy from 'hash_policy.h' with a bucket policy.  See OrderedHashPolicy.
+	template <class T, class HashPolicy = OrderedHashPolicy<HashFuncRuntime, OrderedHashBucketPrime> >
 	class OrderedHash;
-	template <class T>
+	template <class T, class HashPolicy = OrderedHashPolicy<HashFuncRuntime, OrderedHashBucketPrime> >
 	class OrderedHashNoCopy;
 
 	template <class T>
 	class OrderedHashNode
 	{
-		friend class OrderedHash<T>;
-		friend class OrderedHashNoCopy<T>;
+		template <class T2, class HashPolicy>
+		friend class OrderedHash;
+		template <class T2, class HashPolicy>
+		friend class OrderedHashNoCopy;
 
 	public:
-		OrderedHashNode() : PrevHashNode(NULL), NextHashNode(NULL), PrevListNode(NULL), NextListNode(NULL), HashKey(0), IntKey(0), StrKey(NULL)
+		OrderedHashNode() : PrevHashNode(NULL), NextHashNode(NULL), PrevListNode(NULL), NextListNode(NULL), HashKey(0), IntKey(0), StrKey(NULL), StrKeyOwner(0)
 		{
 		}
 
@@ -36,6 +45,7 @@ namespace CubicleSoft
 		{
 			HashKey = TempNode.HashKey;
 			IntKey = TempNode.IntKey;
+			StrKeyOwner = 0;
 
 			if (TempNode.StrKey == NULL)  StrKey = NULL;
 			else
@@ -54,8 +64,9 @@ namespace CubicleSoft
 				HashKey = TempNode.HashKey;
 				IntKey = TempNode.IntKey;
 
-				if (StrKey != NULL)  delete[] StrKey;
+				if (StrKey != NULL && !StrKeyOwner)  delete[] StrKey;
 
+				StrKeyOwner = 0;
 				if (TempNode.StrKey == NULL)  StrKey = NULL;
 				else
 				{
@@ -84,21 +95,27 @@ namespace CubicleSoft
 			IntKey = NewIntKey;
 			if (FreeStrKey && StrKey != NULL)  delete[] StrKey;
 			StrKey = NULL;
+			StrKeyOwner = 0;
 		}
 
 		// When CopyStr is false (i.e. managing your own memory),
 		// SetStrKey() only copies the pointer and you are expected to
 		// later call SetStrKey(NULL, 0, false) on the node.
 		// Best used with OrderedHashNoCopy to avoid accidental
-		// assignment/copy constructor issues.
+		// assignment/copy constructor issues.  An OrderedHash key arena
+		// leaves these keys where they are (see UseKeyArena()).
 		void SetStrKey(const char *NewStrKey, const size_t NewStrLen, const bool CopyStr)
 		{
 			HashKey = 0;
 
-			if (!CopyStr)  StrKey = (char *)NewStrKey;
+			if (!CopyStr)
+			{
+				StrKey = (char *)(std::uintptr_t)NewStrKey;
+				StrKeyOwner = 1;
+			}
 			else
 			{
-				if (StrKey == NULL)  StrKey = new char[NewStrLen];
+				if (StrKey == NULL || StrKeyOwner)  StrKey = new char[NewStrLen];
 				else if (IntKey < (std::int64_t)NewStrLen)
 				{
 					delete[] StrKey;
@@ -106,6 +123,7 @@ namespace CubicleSoft
 				}
 
 				std::memcpy(StrKey, NewStrKey, NewStrLen);
+				StrKeyOwner = 0;
 			}
 
 			IntKey = (std::int64_t)NewStrLen;
@@ -125,6 +143,9 @@ namespace CubicleSoft
 		std::int64_t IntKey;
 		char *StrKey;
 
+		// 0 (StrKey is from new[]), 1 (StrKey is managed by the caller), or 2 (StrKey is in the key arena of the OrderedHash that the node is attached to).
+		std::uint8_t StrKeyOwner;
+
 	public:
 		T Value;
 	};
@@ -137,6 +158,64 @@ namespace CubicleSoft
 		static std::uint64_t GetSipHashKey(const std::uint8_t *Str, size_t Size, std::uint64_t Key1, std::uint64_t Key2, size_t cRounds, size_t dRounds);
 	};
 
+	// Bucket policies reduce a hash key to a position in the hash.
+	// GetHashSize() returns the hash size used for a requested size.  GetNextHashSize() returns the size to automatically grow to once there are that many nodes (0 to stop growing).
+
+	// HashKey % HashSize with prime hash sizes (OrderedHashUtil::Primes).  The default.  Tolerates weak hash functions but costs a 64-bit division per operation.
+	class OrderedHashBucketPrime
+	{
+	public:
+		static inline size_t GetBucket(std::uint64_t HashKey, size_t HashSize)  { return (size_t)(HashKey % (std::uint64_t)HashSize); }
+		static inline size_t GetHashSize(size_t Size)  { return Size; }
+
+		static inline size_t GetNextHashSize(size_t HashSize)
+		{
+			for (size_t x = 0; x < sizeof(OrderedHashUtil::Primes) / sizeof(size_t); x++)
+			{
+				if (OrderedHashUtil::Primes[x] > HashSize)  return OrderedHashUtil::Primes[x];
+			}
+
+			return 0;
+		}
+	};
+
+	// HashKey & (HashSize - 1) with power of two hash sizes.  Only uses the low bits of the hash key, so pair it with a hash function that mixes well (e.g. HashFuncWyHash).
+	class OrderedHashBucketMask
+	{
+	public:
+		static inline size_t GetBucket(std::uint64_t HashKey, size_t HashSize)  { return (size_t)HashKey & (HashSize - 1); }
+
+		static inline size_t GetHashSize(size_t Size)
+		{
+			size_t Result = 1;
+			while (Result < Size && Result < ((size_t)1 << 30))  Result <<= 1;
+
+			return Result;
+		}
+
+		static inline size_t GetNextHashSize(size_t HashSize)  { return (HashSize < ((size_t)1 << 30) ? HashSize << 1 : 0); }
+	};
+
+	// Lemire's fastrange:  Maps the low 32 bits of the hash key onto any hash size with a multiply and shift.  Uses the high bits of those 32 bits the most.
+	class OrderedHashBucketFastRange
+	{
+	public:
+		static inline size_t GetBucket(std::uint64_t HashKey, size_t HashSize)  { return (size_t)(((HashKey & 0xFFFFFFFFULL) * (std::uint64_t)HashSize) >> 32); }
+		static inline size_t GetHashSize(size_t Size)  { return (Size < 0xFFFFFFFFUL ? Size : 0xFFFFFFFFUL); }
+		static inline size_t GetNextHashSize(size_t HashSize)  { return (HashSize < 0x7FFFFFFFUL ? HashSize * 2 + 1 : 0); }
+	};
+
+	// Combines a hash function policy with a bucket policy.  For example, OrderedHash<T, OrderedHashPolicy<HashFuncWyHash, OrderedHashBucketMask> >
+	// replaces the per-operation djb2/SipHash branch and the division with an inline hash and a mask.
+	template <class HashFunc = HashFuncRuntime, class HashBucket = OrderedHashBucketPrime>
+	class OrderedHashPolicy : public HashFunc, public HashBucket
+	{
+	public:
+		OrderedHashPolicy(bool UseSipHash, std::uint64_t HashKey1, std::uint64_t HashKey2) : HashFunc(UseSipHash, HashKey1, HashKey2)
+		{
+		}
+	};
+
 	// OrderedHash.  An ordered hash.
 	#include "detachable_ordered_hash_util.h"
 
@@ -4,7 +4,7 @@
 // NOTE:  This file is intended to be included from 'detachable_ordered_hash.h'.
 
 // Implements an ordered hash that grows dynamically and uses integer and string keys.
-template <class T>
+template <class T, class HashPolicy>
 #ifdef CUBICLESOFT_DETACHABLE_ORDEREDHASH_NOCOPYASSIGN
 class OrderedHashNoCopy
 #else
@@ -17,12 +17,13 @@ public:
 	// https://www.youtube.com/watch?v=R2Cq3CLI6H8
 	// https://www.youtube.com/watch?v=wGYj8fhhUVA
 	// For much better security with a slight performance reduction, use the other constructor, which implements SipHash.
+	// Both constructors pass their keys to HashPolicy, which can replace the djb2/SipHash choice and the bucket reduction at compile time.
 #ifdef CUBICLESOFT_DETACHABLE_ORDEREDHASH_NOCOPYASSIGN
 	OrderedHashNoCopy
 #else
 	OrderedHash
 #endif
-		(size_t EstimatedSize = 23, std::uint64_t HashKey = 5381) : UseSipHash(false), Key1(HashKey), Key2(0), HashNodes(NULL), HashSize(0), NextPrimePos(0), FirstListNode(NULL), LastListNode(NULL), NumListNodes(0)
+		(size_t EstimatedSize = 23, std::uint64_t HashKey = 5381) : Policy(false, HashKey, 0), KeyArena(NULL), HashNodes(NULL), HashSize(0), NextHashSize(0), OldHashNodes(NULL), PendingHashNodes(NULL), OldHashSize(0), PendingHashSize(0), MigratePos(0), ResizeStepSize(0), FirstListNode(NULL), LastListNode(NULL), NumListNodes(0)
 	{
 		ResizeHash(EstimatedSize);
 	}
@@ -34,7 +35,7 @@ public:
 #else
 	OrderedHash
 #endif
-		(size_t EstimatedSize, std::uint64_t HashKey1, std::uint64_t HashKey2) : UseSipHash(true), Key1(HashKey1), Key2(HashKey2), HashNodes(NULL), HashSize(0), NextPrimePos(0), FirstListNode(NULL), LastListNode(NULL), NumListNodes(0)
+		(size_t EstimatedSize, std::uint64_t HashKey1, std::uint64_t HashKey2) : Policy(true, HashKey1, HashKey2), KeyArena(NULL), HashNodes(NULL), HashSize(0), NextHashSize(0), OldHashNodes(NULL), PendingHashNodes(NULL), OldHashSize(0), PendingHashSize(0), MigratePos(0), ResizeStepSize(0), FirstListNode(NULL), LastListNode(NULL), NumListNodes(0)
 	{
 		ResizeHash(EstimatedSize);
 	}
@@ -51,79 +52,94 @@ public:
 
 			delete[] HashNodes;
 		}
+
+		if (KeyArena != NULL)  delete KeyArena;
 	}
 
 #ifdef CUBICLESOFT_DETACHABLE_ORDEREDHASH_NOCOPYASSIGN
-	OrderedHashNoCopy(const OrderedHashNoCopy<T> &TempHash);
-	OrderedHashNoCopy<T> &operator=(const OrderedHashNoCopy<T> &TempHash);
+	OrderedHashNoCopy(const OrderedHashNoCopy<T, HashPolicy> &TempHash);
+	OrderedHashNoCopy<T, HashPolicy> &operator=(const OrderedHashNoCopy<T, HashPolicy> &TempHash);
 #else
-	OrderedHash(const OrderedHash<T> &TempHash)
+	OrderedHash(const OrderedHash<T, HashPolicy> &TempHash) : Policy(TempHash.Policy)
 	{
 		size_t x;
 
-		UseSipHash = TempHash.UseSipHash;
-		Key1 = TempHash.Key1;
-		Key2 = TempHash.Key2;
+		KeyArena = (TempHash.KeyArena != NULL ? new ChunkArena(TempHash.KeyArena->GetChunkSize(), TempHash.KeyArena->GetMallocFunc(), TempHash.KeyArena->GetFreeFunc(), TempHash.KeyArena->GetAllocData()) : NULL);
 
+		// The copy is built in the new bucket array, so it starts out with any incremental resize already finished.
 		HashSize = TempHash.HashSize;
 		HashNodes = new OrderedHashNode<T> *[HashSize];
 		for (x = 0; x < HashSize; x++)  HashNodes[x] = NULL;
+		OldHashNodes = NULL;
+		PendingHashNodes = NULL;
+		OldHashSize = 0;
+		PendingHashSize = 0;
+		MigratePos = 0;
+		ResizeStepSize = TempHash.ResizeStepSize;
 		FirstListNode = NULL;
 		LastListNode = NULL;
 		OrderedHashNode<T> *Node = TempHash.FirstListNode;
-		OrderedHashNode<T> *Node2, *Node3;
+		OrderedHashNode<T> *Node2;
 		while (Node != NULL)
 		{
 			// Attach each cloned node to the end of the list.
 			Node2 = new OrderedHashNode<T>(*Node);
+			MoveKeyToArena(Node2);
+			Node2->PrevListNode = LastListNode;
 			Node2->NextListNode = NULL;
 
 			if (FirstListNode == NULL)  FirstListNode = Node2;
-			else
-			{
-				Node2->PrevListNode = LastListNode;
-				LastListNode->NextListNode = Node2;
-			}
+			else  LastListNode->NextListNode = Node2;
 
 			LastListNode = Node2;
 
 			// Attach cloned node to hash.
 			Node2->PrevHashNode = NULL;
-			x = (size_t)(Node2->HashKey % HashSize);
+			x = Policy.GetBucket(Node2->HashKey, HashSize);
 			Node2->NextHashNode = HashNodes[x];
 			if (HashNodes[x] != NULL)  HashNodes[x]->PrevHashNode = Node2;
+			HashNodes[x] = Node2;
 
 			Node = Node->NextListNode;
 		}
 
-		NextPrimePos = TempHash.NextPrimePos;
+		NextHashSize = TempHash.NextHashSize;
 		NumListNodes = TempHash.NumListNodes;
 	}
 
-	OrderedHash<T> &operator=(const OrderedHash<T> &TempHash)
+	OrderedHash<T, HashPolicy> &operator=(const OrderedHash<T, HashPolicy> &TempHash)
 	{
 		if (&TempHash != this)
 		{
 			size_t x;
 
-			UseSipHash = TempHash.UseSipHash;
-			Key1 = TempHash.Key1;
-			Key2 = TempHash.Key2;
+			Policy = TempHash.Policy;
 
 			if (HashNodes != NULL)  delete[] HashNodes;
+			if (OldHashNodes != NULL)  delete[] OldHashNodes;
+			if (PendingHashNodes != NULL)  delete[] PendingHashNodes;
 			OrderedHashNode<T> *Node = FirstListNode;
-			OrderedHashNode<T> *Node2, *Node3;
+			OrderedHashNode<T> *Node2;
 			while (Node != NULL)
 			{
 				Node2 = Node->NextListNode;
-				delete Node;
+				DeleteNode(Node);
 
 				Node = Node2;
 			}
 
+			if (KeyArena != NULL)  delete KeyArena;
+			KeyArena = (TempHash.KeyArena != NULL ? new ChunkArena(TempHash.KeyArena->GetChunkSize(), TempHash.KeyArena->GetMallocFunc(), TempHash.KeyArena->GetFreeFunc(), TempHash.KeyArena->GetAllocData()) : NULL);
+
 			HashSize = TempHash.HashSize;
 			HashNodes = new OrderedHashNode<T> *[HashSize];
 			for (x = 0; x < HashSize; x++)  HashNodes[x] = NULL;
+			OldHashNodes = NULL;
+			PendingHashNodes = NULL;
+			OldHashSize = 0;
+			PendingHashSize = 0;
+			MigratePos = 0;
+			ResizeStepSize = TempHash.ResizeStepSize;
 			FirstListNode = NULL;
 			LastListNode = NULL;
 			Node = TempHash.FirstListNode;
@@ -131,27 +147,26 @@ public:
 			{
 				// Attach each cloned node to the end of the list.
 				Node2 = new OrderedHashNode<T>(*Node);
+				MoveKeyToArena(Node2);
+				Node2->PrevListNode = LastListNode;
 				Node2->NextListNode = NULL;
 
 				if (FirstListNode == NULL)  FirstListNode = Node2;
-				else
-				{
-					Node2->PrevListNode = LastListNode;
-					LastListNode->NextListNode = Node2;
-				}
+				else  LastListNode->NextListNode = Node2;
 
 				LastListNode = Node2;
 
 				// Attach cloned node to hash.
 				Node2->PrevHashNode = NULL;
-				x = (size_t)(Node2->HashKey % HashSize);
+				x = Policy.GetBucket(Node2->HashKey, HashSize);
 				Node2->NextHashNode = HashNodes[x];
 				if (HashNodes[x] != NULL)  HashNodes[x]->PrevHashNode = Node2;
+				HashNodes[x] = Node2;
 
 				Node = Node->NextListNode;
 			}
 
-			NextPrimePos = TempHash.NextPrimePos;
+			NextHashSize = TempHash.NextHashSize;
 			NumListNodes = TempHash.NumListNodes;
 		}
 
@@ -245,28 +260,309 @@ public:
 
 	OrderedHashNode<T> *InsertBefore(OrderedHashNode<T> *Next, const char *StrKey, const size_t StrLen, const T &Value)
 	{
-		OrderedHashNode<T> *Node = CreateNode(StrKey, StrLen, Value);
-		OrderedHashNode<T> *Node2 = InsertBefore(Next, Node);
-		if (Node2 == NULL)  delete Node;
+		OrderedHashNode<T> *Node = CreateArenaNode(StrKey, StrLen, Value);
+		OrderedHashNode<T> *Node2 = InternalInsertBefore(Next, Node, false);
+		if (Node2 == NULL)  DeleteNode(Node);
 
 		return Node2;
 	}
 
 	// Only use with detached nodes.
-	OrderedHashNode<T> *InsertBefore(OrderedHashNode<T> *Next, OrderedHashNode<T> *Node)
+	inline OrderedHashNode<T> *InsertBefore(OrderedHashNode<T> *Next, OrderedHashNode<T> *Node)
+	{
+		return InternalInsertBefore(Next, Node, true);
+	}
+
+	// Only use with detached nodes.
+	inline OrderedHashNode<T> *InsertAfter(OrderedHashNode<T> *Prev, OrderedHashNode<T> *Node)
+	{
+		return InternalInsertAfter(Prev, Node, true);
+	}
+
+	OrderedHashNode<T> *InsertAfter(OrderedHashNode<T> *Prev, const std::int64_t IntKey, const T &Value)
+	{
+		OrderedHashNode<T> *Node = CreateNode(IntKey, Value);
+		OrderedHashNode<T> *Node2 = InsertAfter(Prev, Node);
+		if (Node2 == NULL)  delete Node;
+
+		return Node2;
+	}
+
+	OrderedHashNode<T> *InsertAfter(OrderedHashNode<T> *Prev, const char *StrKey, const size_t StrLen, const T &Value)
+	{
+		OrderedHashNode<T> *Node = CreateArenaNode(StrKey, StrLen, Value);
+		OrderedHashNode<T> *Node2 = InternalInsertAfter(Prev, Node, false);
+		if (Node2 == NULL)  DeleteNode(Node);
+
+		return Node2;
+	}
+
+	// ResetHashKey forces the hash key to be recalculated if the node is attached later.
+	// When a key arena is in use, the string key is copied out of the arena so that the node can outlive the hash.
+	bool Detach(OrderedHashNode<T> *Node, bool ResetHashKey)
+	{
+		if (!InternalDetach(Node, ResetHashKey))  return false;
+
+		MoveKeyFromArena(Node);
+
+		return true;
+	}
+
+	bool Remove(OrderedHashNode<T> *Node)
+	{
+		if (!InternalDetach(Node, false))  return false;
+
+		DeleteNode(Node);
+
+		return true;
+	}
+
+	void Empty(bool DeleteNodes = true, bool ResetHashKey = false)
+	{
+		OrderedHashNode<T> *Node = FirstListNode;
+		OrderedHashNode<T> *Node2;
+		while (Node != NULL)
+		{
+			Node2 = Node->NextListNode;
+			if (DeleteNodes)  DeleteNode(Node);
+			else
+			{
+				// Detach the node's hash pointers and optionally reset the hash key.
+				MoveKeyFromArena(Node);
+				Node->PrevHashNode = NULL;
+				Node->NextHashNode = NULL;
+
+				if (ResetHashKey)  Node->HashKey = 0;
+			}
+
+			Node = Node2;
+		}
+
+		size_t x;
+
+		for (x = 0; x < HashSize; x++)  HashNodes[x] = NULL;
+
+		CancelIncrementalResize();
+
+		FirstListNode = NULL;
+		LastListNode = NULL;
+		NumListNodes = 0;
+
+		if (KeyArena != NULL)  KeyArena->Empty();
+	}
+
+	// Allocates string keys of attached nodes from a ChunkArena owned by the hash instead of one new[] per key.  Existing keys are moved into the arena.
+	// Arena memory is only released by Empty() and the destructor.  Detaching a node copies its key back to a new[] allocation.
+	// Keys set with SetStrKey(..., false) are never moved and remain the caller's to manage.
+	// Chunks are allocated with MallocFn and FreeFn when set (e.g. from a Sync::TLS object).  See ChunkArena.
+	bool UseKeyArena(size_t ChunkSize = 65536, ChunkArena::MallocFunc MallocFn = NULL, ChunkArena::FreeFunc FreeFn = NULL, void *AllocData = NULL)
+	{
+		if (KeyArena != NULL)  return false;
+
+		KeyArena = new ChunkArena(ChunkSize, MallocFn, FreeFn, AllocData);
+
+		OrderedHashNode<T> *Node = FirstListNode;
+		while (Node != NULL)
+		{
+			MoveKeyToArena(Node);
+
+			Node = Node->NextListNode;
+		}
+
+		return true;
+	}
+
+	inline ChunkArena *GetKeyArena() { return KeyArena; }
+
+	OrderedHashNode<T> *Find(const std::int64_t IntKey) const
+	{
+		std::uint64_t HashKey = Policy.GetIntHashKey(IntKey);
+		OrderedHashNode<T> *Node = *GetHashBucket(HashKey);
+
+		while (Node != NULL && (Node->StrKey != NULL || Node->IntKey != IntKey))  Node = Node->NextHashNode;
+
+		return Node;
+	}
+
+	OrderedHashNode<T> *Find(const char *StrKey, const size_t StrLen) const
+	{
+		std::uint64_t HashKey = Policy.GetHashKey((const std::uint8_t *)StrKey, StrLen);
+		OrderedHashNode<T> *Node = *GetHashBucket(HashKey);
+
+		while (Node != NULL && (Node->StrKey == NULL || Node->HashKey != HashKey || (size_t)Node->IntKey != StrLen || memcmp(Node->StrKey, StrKey, StrLen)))  Node = Node->NextHashNode;
+
+		return Node;
+	}
+
+	OrderedHashNode<T> *Find(OrderedHashNode<T> *FindNode) const
+	{
+		std::uint64_t HashKey;
+
+		if (FindNode->HashKey)  HashKey = FindNode->HashKey;
+		else
+		{
+			if (FindNode->StrKey != NULL)  HashKey = Policy.GetHashKey((std::uint8_t *)FindNode->StrKey, (size_t)FindNode->IntKey);
+			else  HashKey = Policy.GetIntHashKey(FindNode->IntKey);
+		}
+
+		OrderedHashNode<T> *Node = *GetHashBucket(HashKey);
+
+		if (FindNode->StrKey == NULL)
+		{
+			while (Node != NULL && (Node->StrKey != NULL || Node->IntKey != FindNode->IntKey))  Node = Node->NextHashNode;
+		}
+		else
+		{
+			while (Node != NULL && (Node->StrKey == NULL || Node->HashKey != HashKey || Node->IntKey != FindNode->IntKey || memcmp(Node->StrKey, FindNode->StrKey, (size_t)FindNode->IntKey)))  Node = Node->NextHashNode;
+		}
+
+		return Node;
+	}
+
+	bool ResizeHash(size_t NewHashSize)
+	{
+		if (!NewHashSize)  return false;
+
+		if (HashNodes != NULL)
+		{
+			delete[] HashNodes;
+
+			HashNodes = NULL;
+		}
+
+		// Every node gets reattached from the list, so any incremental resize can be dropped.
+		CancelIncrementalResize();
+
+		size_t x;
+		HashSize = Policy.GetHashSize(NewHashSize);
+		HashNodes = new OrderedHashNode<T> *[HashSize];
+		for (x = 0; x < HashSize; x++)  HashNodes[x] = NULL;
+
+		// Attach the list nodes to the new hash.
+		OrderedHashNode<T> *Node = FirstListNode;
+		while (Node != NULL)
+		{
+			Node->PrevHashNode = NULL;
+			x = Policy.GetBucket(Node->HashKey, HashSize);
+			Node->NextHashNode = HashNodes[x];
+			if (HashNodes[x] != NULL)  HashNodes[x]->PrevHashNode = Node;
+			HashNodes[x] = Node;
+
+			Node = Node->NextListNode;
+		}
+
+		// Calculate the next auto-resize point.
+		NextHashSize = Policy.GetNextHashSize(HashSize);
+
+		return true;
+	}
+
+	// Instead of rehashing every node at once when the next auto-resize point is reached, spread the work of allocating
+	// the new bucket array and moving the nodes over to it across inserts and detaches.  Each one moves NumBuckets buckets
+	// of the old array (or clears 8 times as many buckets of the new array first).  Find() checks whichever array holds the
+	// key's bucket.  This trades a little speed for no long pauses on large hashes.
+	// 0 turns incremental resizing off and finishes any resize that is in progress.
+	void SetIncrementalResize(size_t NumBuckets)
+	{
+		ResizeStepSize = NumBuckets;
+
+		if (!ResizeStepSize)
+		{
+			while (ResizeStep(65536))  {}
+		}
+	}
+
+	inline size_t GetIncrementalResize() const  { return ResizeStepSize; }
+	inline bool IsResizing() const  { return (OldHashNodes != NULL || PendingHashNodes != NULL); }
+
+	// Advances an incremental resize by up to NumBuckets buckets (e.g. during idle time).
+	// Returns whether the resize is still in progress.
+	bool ResizeStep(size_t NumBuckets)
+	{
+		size_t x;
+
+		if (PendingHashNodes != NULL)
+		{
+			// Clear the new bucket array a little at a time so that its memory isn't all touched at once.
+			x = (NumBuckets < (PendingHashSize - MigratePos) / 8 ? MigratePos + NumBuckets * 8 : PendingHashSize);
+			for (; MigratePos < x; MigratePos++)  PendingHashNodes[MigratePos] = NULL;
+
+			if (MigratePos < PendingHashSize)  return true;
+
+			// Start moving nodes.
+			OldHashNodes = HashNodes;
+			OldHashSize = HashSize;
+			HashNodes = PendingHashNodes;
+			HashSize = PendingHashSize;
+			MigratePos = 0;
+
+			PendingHashNodes = NULL;
+			PendingHashSize = 0;
+
+			return true;
+		}
+
+		if (OldHashNodes == NULL)  return false;
+
+		OrderedHashNode<T> *Node, *Node2;
+
+		for (; NumBuckets && MigratePos < OldHashSize; NumBuckets--)
+		{
+			Node = OldHashNodes[MigratePos];
+			while (Node != NULL)
+			{
+				Node2 = Node->NextHashNode;
+
+				Node->PrevHashNode = NULL;
+				x = Policy.GetBucket(Node->HashKey, HashSize);
+				Node->NextHashNode = HashNodes[x];
+				if (HashNodes[x] != NULL)  HashNodes[x]->PrevHashNode = Node;
+				HashNodes[x] = Node;
+
+				Node = Node2;
+			}
+
+			OldHashNodes[MigratePos] = NULL;
+			MigratePos++;
+		}
+
+		if (MigratePos < OldHashSize)  return true;
+
+		delete[] OldHashNodes;
+
+		OldHashNodes = NULL;
+		OldHashSize = 0;
+		MigratePos = 0;
+
+		return false;
+	}
+
+	// During an incremental resize, the new bucket array doesn't contain all of the nodes yet.
+	inline OrderedHashNode<T> **RawHash() const  { return HashNodes; }
+	inline size_t GetHashSize() const  { return HashSize; }
+
+	inline OrderedHashNode<T> *FirstList() const  { return FirstListNode; }
+	inline OrderedHashNode<T> *LastList() const  { return LastListNode; }
+	inline size_t GetListSize() const  { return NumListNodes; }
+
+private:
+	// MoveKey moves a heap allocated string key into the arena.  String keys of nodes created by CreateArenaNode() are already there.
+	OrderedHashNode<T> *InternalInsertBefore(OrderedHashNode<T> *Next, OrderedHashNode<T> *Node, bool MoveKey)
 	{
 		if (Node->PrevHashNode != NULL || Node->NextHashNode != NULL)  return NULL;
 
 		// Calculate and cache the hash key.
 		if (Node->HashKey == 0)
 		{
-			if (Node->StrKey != NULL)  Node->HashKey = GetHashKey((std::uint8_t *)Node->StrKey, (size_t)Node->IntKey);
-			else  Node->HashKey = GetHashKey((std::uint8_t *)&(Node->IntKey), sizeof(std::int64_t));
+			if (Node->StrKey != NULL)  Node->HashKey = Policy.GetHashKey((std::uint8_t *)Node->StrKey, (size_t)Node->IntKey);
+			else  Node->HashKey = Policy.GetIntHashKey(Node->IntKey);
 		}
 
 		// Unable to have two of the same key in the list.
 		if (Find(Node) != NULL)  return NULL;
 
+		if (MoveKey)  MoveKeyToArena(Node);
+
 		// Insert into the list.
 		if (Next == NULL)
 		{
@@ -286,51 +582,28 @@ public:
 		NumListNodes++;
 
 		// Resize the hash or insert the node into the hash.
-		if (NextPrimePos < sizeof(OrderedHashUtil::Primes) / sizeof(size_t) && NumListNodes >= OrderedHashUtil::Primes[NextPrimePos])  ResizeHash(OrderedHashUtil::Primes[NextPrimePos]);
-		else
-		{
-			size_t x = (size_t)(Node->HashKey % (std::uint64_t)HashSize);
-			Node->NextHashNode = HashNodes[x];
-			if (HashNodes[x] != NULL)  HashNodes[x]->PrevHashNode = Node;
-			HashNodes[x] = Node;
-		}
+		if (NextHashSize && NumListNodes >= NextHashSize && !ResizeStepSize)  ResizeHash(NextHashSize);
+		else  InternalAttachHashNode(Node);
 
 		return Node;
 	}
 
-	OrderedHashNode<T> *InsertAfter(OrderedHashNode<T> *Prev, const std::int64_t IntKey, const T &Value)
-	{
-		OrderedHashNode<T> *Node = CreateNode(IntKey, Value);
-		OrderedHashNode<T> *Node2 = InsertAfter(Prev, Node);
-		if (Node2 == NULL)  delete Node;
-
-		return Node2;
-	}
-
-	OrderedHashNode<T> *InsertAfter(OrderedHashNode<T> *Prev, const char *StrKey, const size_t StrLen, const T &Value)
-	{
-		OrderedHashNode<T> *Node = CreateNode(StrKey, StrLen, Value);
-		OrderedHashNode<T> *Node2 = InsertAfter(Prev, Node);
-		if (Node2 == NULL)  delete Node;
-
-		return Node2;
-	}
-
-	// Only use with detached nodes.
-	OrderedHashNode<T> *InsertAfter(OrderedHashNode<T> *Prev, OrderedHashNode<T> *Node)
+	OrderedHashNode<T> *InternalInsertAfter(OrderedHashNode<T> *Prev, OrderedHashNode<T> *Node, bool MoveKey)
 	{
 		if (Node->PrevHashNode != NULL || Node->NextHashNode != NULL)  return NULL;
 
 		// Calculate and cache the hash key.
 		if (Node->HashKey == 0)
 		{
-			if (Node->StrKey != NULL)  Node->HashKey = GetHashKey((std::uint8_t *)Node->StrKey, (size_t)Node->IntKey);
-			else  Node->HashKey = GetHashKey((std::uint8_t *)&(Node->IntKey), sizeof(std::int64_t));
+			if (Node->StrKey != NULL)  Node->HashKey = Policy.GetHashKey((std::uint8_t *)Node->StrKey, (size_t)Node->IntKey);
+			else  Node->HashKey = Policy.GetIntHashKey(Node->IntKey);
 		}
 
 		// Unable to have two of the same key in the list.
 		if (Find(Node) != NULL)  return NULL;
 
+		if (MoveKey)  MoveKeyToArena(Node);
+
 		// Insert into the list.
 		if (Prev == NULL)
 		{
@@ -350,20 +623,13 @@ public:
 		NumListNodes++;
 
 		// Resize the hash or insert the node into the hash.
-		if (NextPrimePos < sizeof(OrderedHashUtil::Primes) / sizeof(size_t) && NumListNodes >= OrderedHashUtil::Primes[NextPrimePos])  ResizeHash(OrderedHashUtil::Primes[NextPrimePos]);
-		else
-		{
-			size_t x = (size_t)(Node->HashKey % (std::uint64_t)HashSize);
-			Node->NextHashNode = HashNodes[x];
-			if (HashNodes[x] != NULL)  HashNodes[x]->PrevHashNode = Node;
-			HashNodes[x] = Node;
-		}
+		if (NextHashSize && NumListNodes >= NextHashSize && !ResizeStepSize)  ResizeHash(NextHashSize);
+		else  InternalAttachHashNode(Node);
 
 		return Node;
 	}
 
-	// ResetHashKey forces the hash key to be recalculated if the node is attached later.
-	bool Detach(OrderedHashNode<T> *Node, bool ResetHashKey)
+	bool InternalDetach(OrderedHashNode<T> *Node, bool ResetHashKey)
 	{
 		if (Node == NULL)  return false;
 
@@ -391,9 +657,11 @@ public:
 		NumListNodes--;
 
 		// Detach the hash node.
-		size_t x = (size_t)(Node->HashKey % (std::uint64_t)HashSize);
+		if (IsResizing())  ResizeStep(ResizeStepSize);
+
+		OrderedHashNode<T> **Bucket = GetHashBucket(Node->HashKey);
 		if (Node->PrevHashNode != NULL)  Node->PrevHashNode->NextHashNode = Node->NextHashNode;
-		else if (HashNodes[x] == Node)  HashNodes[x] = Node->NextHashNode;
+		else if (*Bucket == Node)  *Bucket = Node->NextHashNode;
 
 		if (Node->NextHashNode != NULL)  Node->NextHashNode->PrevHashNode = Node->PrevHashNode;
 
@@ -405,146 +673,114 @@ public:
 		return true;
 	}
 
-	bool Remove(OrderedHashNode<T> *Node)
+	// Returns the bucket that holds the hash key.  Until an incremental resize reaches a bucket of the old array, its nodes stay there.
+	inline OrderedHashNode<T> **GetHashBucket(std::uint64_t HashKey) const
 	{
-		if (!Detach(Node, false))  return false;
-
-		delete Node;
+		if (OldHashNodes != NULL)
+		{
+			size_t x = Policy.GetBucket(HashKey, OldHashSize);
+			if (x >= MigratePos)  return OldHashNodes + x;
+		}
 
-		return true;
+		return HashNodes + Policy.GetBucket(HashKey, HashSize);
 	}
 
-	void Empty(bool DeleteNodes = true, bool ResetHashKey = false)
+	// Inserts an attached list node into the hash and advances an incremental resize.
+	void InternalAttachHashNode(OrderedHashNode<T> *Node)
 	{
-		OrderedHashNode<T> *Node = FirstListNode;
-		OrderedHashNode<T> *Node2;
-		while (Node != NULL)
+		if (ResizeStepSize)
 		{
-			Node2 = Node->NextListNode;
-			if (DeleteNodes)  delete Node;
-			else
+			if (NextHashSize && NumListNodes >= NextHashSize)
 			{
-				// Detach the node's hash pointers and optionally reset the hash key.
-				Node->PrevHashNode = NULL;
-				Node->NextHashNode = NULL;
+				// Finish the previous resize (if any) and start the next one.  The new bucket array is cleared by ResizeStep().
+				while (ResizeStep(65536))  {}
 
-				if (ResetHashKey)  Node->HashKey = 0;
+				PendingHashSize = Policy.GetHashSize(NextHashSize);
+				PendingHashNodes = new OrderedHashNode<T> *[PendingHashSize];
+				MigratePos = 0;
+
+				NextHashSize = Policy.GetNextHashSize(PendingHashSize);
 			}
 
-			Node = Node2;
+			if (IsResizing())  ResizeStep(ResizeStepSize);
 		}
 
-		size_t x;
-
-		for (x = 0; x < HashSize; x++)  HashNodes[x] = NULL;
-
-		FirstListNode = NULL;
-		LastListNode = NULL;
-		NumListNodes = 0;
+		OrderedHashNode<T> **Bucket = GetHashBucket(Node->HashKey);
+		Node->NextHashNode = *Bucket;
+		if (*Bucket != NULL)  (*Bucket)->PrevHashNode = Node;
+		*Bucket = Node;
 	}
 
-	OrderedHashNode<T> *Find(const std::int64_t IntKey) const
+	inline void CancelIncrementalResize()
 	{
-		std::uint64_t HashKey = GetHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t));
-		size_t x = (size_t)(HashKey % (std::uint64_t)HashSize);
-		OrderedHashNode<T> *Node = HashNodes[x];
-
-		while (Node != NULL && (Node->StrKey != NULL || Node->IntKey != IntKey))  Node = Node->NextHashNode;
-
-		return Node;
+		if (OldHashNodes != NULL)  delete[] OldHashNodes;
+		if (PendingHashNodes != NULL)  delete[] PendingHashNodes;
+
+		OldHashNodes = NULL;
+		PendingHashNodes = NULL;
+		OldHashSize = 0;
+		PendingHashSize = 0;
+		MigratePos = 0;
 	}
 
-	OrderedHashNode<T> *Find(const char *StrKey, const size_t StrLen) const
-	{
-		std::uint64_t HashKey = GetHashKey((const std::uint8_t *)StrKey, StrLen);
-		size_t x = (size_t)(HashKey % (std::uint64_t)HashSize);
-		OrderedHashNode<T> *Node = HashNodes[x];
-
-		while (Node != NULL && (Node->StrKey == NULL || Node->HashKey != HashKey || (size_t)Node->IntKey != StrLen || memcmp(Node->StrKey, StrKey, StrLen)))  Node = Node->NextHashNode;
-
-		return Node;
-	}
-
-	OrderedHashNode<T> *Find(OrderedHashNode<T> *FindNode) const
+	inline OrderedHashNode<T> *CreateArenaNode(const char *StrKey, const size_t StrLen, const T &Value)
 	{
-		std::uint64_t HashKey;
+		if (KeyArena == NULL)  return CreateNode(StrKey, StrLen, Value);
 
-		if (FindNode->HashKey)  HashKey = FindNode->HashKey;
-		else
-		{
-			if (FindNode->StrKey != NULL)  HashKey = GetHashKey((std::uint8_t *)FindNode->StrKey, (size_t)FindNode->IntKey);
-			else  HashKey = GetHashKey((std::uint8_t *)&(FindNode->IntKey), sizeof(std::int64_t));
-		}
+		OrderedHashNode<T> *Node = new OrderedHashNode<T>;
 
-		size_t x = (size_t)(HashKey % (std::uint64_t)HashSize);
-		OrderedHashNode<T> *Node = HashNodes[x];
+		Node->IntKey = (std::int64_t)StrLen;
+		Node->StrKey = (char *)KeyArena->Alloc(StrLen);
+		Node->StrKeyOwner = 2;
+		memcpy(Node->StrKey, StrKey, StrLen);
 
-		if (FindNode->StrKey == NULL)
-		{
-			while (Node != NULL && (Node->StrKey != NULL || Node->IntKey != FindNode->IntKey))  Node = Node->NextHashNode;
-		}
-		else
-		{
-			while (Node != NULL && (Node->StrKey == NULL || Node->HashKey != HashKey || Node->IntKey != FindNode->IntKey || memcmp(Node->StrKey, FindNode->StrKey, (size_t)FindNode->IntKey)))  Node = Node->NextHashNode;
-		}
+		Node->Value = Value;
 
 		return Node;
 	}
 
-	bool ResizeHash(size_t NewHashSize)
+	// Keeps the node destructor from delete[]'ing an arena allocated string key.
+	inline void DeleteNode(OrderedHashNode<T> *Node)
 	{
-		if (!NewHashSize)  return false;
+		if (Node->StrKeyOwner == 2)  Node->StrKey = NULL;
 
-		if (HashNodes != NULL)
-		{
-			delete[] HashNodes;
-
-			HashNodes = NULL;
-		}
-
-		size_t x;
-		HashSize = NewHashSize;
-		HashNodes = new OrderedHashNode<T> *[NewHashSize];
-		for (x = 0; x < NewHashSize; x++)  HashNodes[x] = NULL;
-
-		// Attach the list nodes to the new hash.
-		OrderedHashNode<T> *Node = FirstListNode;
-		while (Node != NULL)
-		{
-			Node->PrevHashNode = NULL;
-			x = (size_t)(Node->HashKey % HashSize);
-			Node->NextHashNode = HashNodes[x];
-			if (HashNodes[x] != NULL)  HashNodes[x]->PrevHashNode = Node;
-			HashNodes[x] = Node;
+		delete Node;
+	}
 
-			Node = Node->NextListNode;
-		}
+	// Only moves keys from new[].  Keys managed by the caller stay where they are.
+	inline void MoveKeyToArena(OrderedHashNode<T> *Node)
+	{
+		if (KeyArena == NULL || Node->StrKey == NULL || Node->StrKeyOwner)  return;
 
-		// Calculate the next auto-resize point.
-		for (x = 0; x < sizeof(OrderedHashUtil::Primes) / sizeof(size_t) && OrderedHashUtil::Primes[x] <= NewHashSize; x++);
-		NextPrimePos = x;
+		char *Str = (char *)KeyArena->Alloc((size_t)Node->IntKey);
+		memcpy(Str, Node->StrKey, (size_t)Node->IntKey);
 
-		return true;
+		delete[] Node->StrKey;
+		Node->StrKey = Str;
+		Node->StrKeyOwner = 2;
 	}
 
-	inline OrderedHashNode<T> **RawHash() const  { return HashNodes; }
-	inline size_t GetHashSize() const  { return HashSize; }
+	inline void MoveKeyFromArena(OrderedHashNode<T> *Node)
+	{
+		if (Node->StrKeyOwner != 2)  return;
 
-	inline OrderedHashNode<T> *FirstList() const  { return FirstListNode; }
-	inline OrderedHashNode<T> *LastList() const  { return LastListNode; }
-	inline size_t GetListSize() const  { return NumListNodes; }
+		char *Str = new char[(size_t)Node->IntKey];
+		memcpy(Str, Node->StrKey, (size_t)Node->IntKey);
 
-private:
-	inline std::uint64_t GetHashKey(const std::uint8_t *Str, size_t Size) const
-	{
-		return (UseSipHash ? OrderedHashUtil::GetSipHashKey(Str, Size, Key1, Key2, 2, 4) : (std::uint64_t)OrderedHashUtil::GetDJBX33XHashKey(Str, Size, (size_t)Key1));
+		Node->StrKey = Str;
+		Node->StrKeyOwner = 0;
 	}
 
-	bool UseSipHash;
-	std::uint64_t Key1, Key2;
+	HashPolicy Policy;
+	ChunkArena *KeyArena;
 
 	OrderedHashNode<T> **HashNodes;
-	size_t HashSize, NextPrimePos;
+	size_t HashSize, NextHashSize;
+
+	// Incremental resize state.  Buckets of PendingHashNodes below MigratePos have been cleared.
+	// Once it becomes HashNodes, buckets of OldHashNodes below MigratePos have been moved to it.
+	OrderedHashNode<T> **OldHashNodes, **PendingHashNodes;
+	size_t OldHashSize, PendingHashSize, MigratePos, ResizeStepSize;
 
 	OrderedHashNode<T> *FirstListNode, *LastListNode;
 	size_t NumListNodes;
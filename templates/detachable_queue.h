@@ -12,12 +12,15 @@ namespace CubicleSoft
 	class Queue;
 	template <class T>
 	class QueueNoCopy;
+	template <class T>
+	class ConcurrentQueue;
 
 	template <class T>
 	class QueueNode
 	{
 		friend class Queue<T>;
 		friend class QueueNoCopy<T>;
+		friend class ConcurrentQueue<T>;
 
 	public:
 		QueueNode() : NextNode(NULL)
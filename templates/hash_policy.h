@@ -0,0 +1,268 @@
+// Compile-time hash function policies for OrderedHash and PackedOrderedHash.
+// (C) 2016 CubicleSoft.  All Rights Reserved.
+
+#ifndef CUBICLESOFT_HASH_POLICY
+#define CUBICLESOFT_HASH_POLICY
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+	#include <intrin.h>
+#endif
+
+namespace CubicleSoft
+{
+	// Inline hash functions.  Being inline lets the compiler fold constant round counts and key sizes into each hash.
+	class HashPolicyUtil
+	{
+	public:
+		// djb2 (DJBX33X) over 4 bytes at a time.  Same results as OrderedHashUtil::GetDJBX33XHashKey().
+		static inline std::uint64_t GetDJBX33XHashKey(const std::uint8_t *Str, size_t Size, std::uint64_t InitVal)
+		{
+			std::uint32_t Result = (std::uint32_t)InitVal;
+			std::uint32_t y;
+			const std::uint8_t *StrEnd = Str + (Size & ~(size_t)3);
+
+			while (Str != StrEnd)
+			{
+				std::memcpy(&y, Str, sizeof(std::uint32_t));
+
+				Result = ((Result << 5) + Result) ^ y;
+
+				Str += 4;
+			}
+
+			for (size_t x = Size & 3; x; x--)  Result = ((Result << 5) + Result) ^ ((std::uint32_t)Str[x - 1]);
+
+			return (std::uint64_t)Result;
+		}
+
+		// SipHash-c-d.  Same results as OrderedHashUtil::GetSipHashKey().
+		static inline std::uint64_t GetSipHashKey(const std::uint8_t *Str, size_t Size, std::uint64_t Key1, std::uint64_t Key2, size_t cRounds, size_t dRounds)
+		{
+			// "somepseudorandomlygeneratedbytes"
+			std::uint64_t v[4] = { 0x736f6d6570736575ULL ^ Key1, 0x646f72616e646f6dULL ^ Key2, 0x6c7967656e657261ULL ^ Key1, 0x7465646279746573ULL ^ Key2 };
+			std::uint64_t Result = ((std::uint64_t)Size) << 56;
+			std::uint64_t y;
+			size_t x;
+			const std::uint8_t *StrEnd = Str + (Size & ~(size_t)7);
+
+			while (Str != StrEnd)
+			{
+				std::memcpy(&y, Str, sizeof(std::uint64_t));
+
+				v[3] ^= y;
+				for (x = 0; x < cRounds; x++)  SipRound(v);
+				v[0] ^= y;
+
+				Str += 8;
+			}
+
+			for (x = Size & 7; x; x--)  Result |= ((std::uint64_t)Str[x - 1]) << ((x - 1) * 8);
+
+			v[3] ^= Result;
+			for (x = 0; x < cRounds; x++)  SipRound(v);
+			v[0] ^= Result;
+
+			v[2] ^= 0xff;
+			for (x = 0; x < dRounds; x++)  SipRound(v);
+
+			return v[0] ^ v[1] ^ v[2] ^ v[3];
+		}
+
+		// Multiplies A and B into 128 bits and folds the high half into the low half.
+		static inline std::uint64_t MumMix(std::uint64_t A, std::uint64_t B)
+		{
+#if defined(__SIZEOF_INT128__)
+			__extension__ typedef unsigned __int128 UInt128;
+			UInt128 Result = (UInt128)A * B;
+
+			return (std::uint64_t)Result ^ (std::uint64_t)(Result >> 64);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+			std::uint64_t High, Low = _umul128(A, B, &High);
+
+			return Low ^ High;
+#else
+			std::uint64_t ALow = (std::uint32_t)A, AHigh = A >> 32, BLow = (std::uint32_t)B, BHigh = B >> 32;
+			std::uint64_t LL = ALow * BLow, LH = ALow * BHigh, HL = AHigh * BLow, HH = AHigh * BHigh;
+			std::uint64_t Mid = (LL >> 32) + (std::uint32_t)LH + (std::uint32_t)HL;
+
+			return ((Mid << 32) | (std::uint32_t)LL) ^ (HH + (LH >> 32) + (HL >> 32) + (Mid >> 32));
+#endif
+		}
+
+		// A wyhash style hash.  Every 16 bytes of input cost one 64x64 to 128-bit multiply.
+		static inline std::uint64_t GetWyHashKey(const std::uint8_t *Str, size_t Size, std::uint64_t Seed)
+		{
+			const std::uint64_t p0 = 0xa0761d6478bd642fULL, p1 = 0xe7037ed1a0b428dbULL;
+			std::uint64_t A, B;
+
+			Seed ^= MumMix(Seed ^ p0, p1);
+
+			if (Size <= 16)
+			{
+				if (Size >= 4)
+				{
+					A = (Read32(Str) << 32) | Read32(Str + ((Size >> 3) << 2));
+					B = (Read32(Str + Size - 4) << 32) | Read32(Str + Size - 4 - ((Size >> 3) << 2));
+				}
+				else if (Size > 0)
+				{
+					A = ((std::uint64_t)Str[0] << 16) | ((std::uint64_t)Str[Size >> 1] << 8) | (std::uint64_t)Str[Size - 1];
+					B = 0;
+				}
+				else
+				{
+					A = 0;
+					B = 0;
+				}
+			}
+			else
+			{
+				size_t x = Size;
+
+				while (x > 16)
+				{
+					Seed = MumMix(Read64(Str) ^ p1, Read64(Str + 8) ^ Seed);
+
+					Str += 16;
+					x -= 16;
+				}
+
+				A = Read64(Str + x - 16);
+				B = Read64(Str + x - 8);
+			}
+
+			return MumMix(MumMix(A ^ p1, B ^ Seed) ^ p0 ^ (std::uint64_t)Size, p1);
+		}
+
+	private:
+		static inline void SipRound(std::uint64_t *v)
+		{
+			v[0] += v[1];  v[1] = RotL(v[1], 13);  v[1] ^= v[0];  v[0] = RotL(v[0], 32);
+			v[2] += v[3];  v[3] = RotL(v[3], 16);  v[3] ^= v[2];
+			v[0] += v[3];  v[3] = RotL(v[3], 21);  v[3] ^= v[0];
+			v[2] += v[1];  v[1] = RotL(v[1], 17);  v[1] ^= v[2];  v[2] = RotL(v[2], 32);
+		}
+
+		static inline std::uint64_t RotL(std::uint64_t x, int b)  { return (x << b) | (x >> (64 - b)); }
+
+		static inline std::uint64_t Read32(const std::uint8_t *Str)
+		{
+			std::uint32_t Result;
+			std::memcpy(&Result, Str, sizeof(std::uint32_t));
+
+			return Result;
+		}
+
+		static inline std::uint64_t Read64(const std::uint8_t *Str)
+		{
+			std::uint64_t Result;
+			std::memcpy(&Result, Str, sizeof(std::uint64_t));
+
+			return Result;
+		}
+	};
+
+	// Hash function policies.  The hash templates construct their policy from the constructor used:  (UseSipHash = false, HashKey, 0) or (UseSipHash = true, HashKey1, HashKey2).
+	// GetHashKey() hashes string keys and GetIntHashKey() hashes integer keys.  Policies other than HashFuncRuntime don't branch on UseSipHash.
+
+	// djb2 or SipHash-2-4, chosen at runtime by the constructor used.  This is the default and the original behavior of the hash templates.
+	class HashFuncRuntime
+	{
+	public:
+		HashFuncRuntime(bool UseSipHash, std::uint64_t HashKey1, std::uint64_t HashKey2) : MxUseSipHash(UseSipHash), MxKey1(HashKey1), MxKey2(HashKey2)
+		{
+		}
+
+		inline std::uint64_t GetHashKey(const std::uint8_t *Str, size_t Size) const
+		{
+			return (MxUseSipHash ? HashPolicyUtil::GetSipHashKey(Str, Size, MxKey1, MxKey2, 2, 4) : HashPolicyUtil::GetDJBX33XHashKey(Str, Size, MxKey1));
+		}
+
+		inline std::uint64_t GetIntHashKey(std::int64_t IntKey) const
+		{
+			return GetHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t));
+		}
+
+	private:
+		bool MxUseSipHash;
+		std::uint64_t MxKey1, MxKey2;
+	};
+
+	// djb2 (DJBX33X) only.  WARNING:  Weak security-wise.  See OrderedHash.
+	class HashFuncDJB2
+	{
+	public:
+		HashFuncDJB2(bool, std::uint64_t HashKey1, std::uint64_t) : MxKey1(HashKey1)
+		{
+		}
+
+		inline std::uint64_t GetHashKey(const std::uint8_t *Str, size_t Size) const  { return HashPolicyUtil::GetDJBX33XHashKey(Str, Size, MxKey1); }
+		inline std::uint64_t GetIntHashKey(std::int64_t IntKey) const  { return HashPolicyUtil::GetDJBX33XHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t), MxKey1); }
+
+	private:
+		std::uint64_t MxKey1;
+	};
+
+	// SipHash-2-4.  Use with the two key constructor and good (CSPRNG generated) keys.
+	class HashFuncSipHash24
+	{
+	public:
+		HashFuncSipHash24(bool, std::uint64_t HashKey1, std::uint64_t HashKey2) : MxKey1(HashKey1), MxKey2(HashKey2)
+		{
+		}
+
+		inline std::uint64_t GetHashKey(const std::uint8_t *Str, size_t Size) const  { return HashPolicyUtil::GetSipHashKey(Str, Size, MxKey1, MxKey2, 2, 4); }
+		inline std::uint64_t GetIntHashKey(std::int64_t IntKey) const  { return HashPolicyUtil::GetSipHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t), MxKey1, MxKey2, 2, 4); }
+
+	private:
+		std::uint64_t MxKey1, MxKey2;
+	};
+
+	// SipHash-1-3.  Roughly twice as fast as SipHash-2-4 with a smaller security margin that is still considered fine for hash tables.
+	class HashFuncSipHash13
+	{
+	public:
+		HashFuncSipHash13(bool, std::uint64_t HashKey1, std::uint64_t HashKey2) : MxKey1(HashKey1), MxKey2(HashKey2)
+		{
+		}
+
+		inline std::uint64_t GetHashKey(const std::uint8_t *Str, size_t Size) const  { return HashPolicyUtil::GetSipHashKey(Str, Size, MxKey1, MxKey2, 1, 3); }
+		inline std::uint64_t GetIntHashKey(std::int64_t IntKey) const  { return HashPolicyUtil::GetSipHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t), MxKey1, MxKey2, 1, 3); }
+
+	private:
+		std::uint64_t MxKey1, MxKey2;
+	};
+
+	// wyhash style.  Fast for all key sizes with good distribution in every bit, but not a keyed PRF like SipHash.  Integer keys take a single multiply.
+	class HashFuncWyHash
+	{
+	public:
+		HashFuncWyHash(bool, std::uint64_t HashKey1, std::uint64_t HashKey2) : MxSeed(HashKey1 ^ HashKey2)
+		{
+		}
+
+		inline std::uint64_t GetHashKey(const std::uint8_t *Str, size_t Size) const  { return HashPolicyUtil::GetWyHashKey(Str, Size, MxSeed); }
+		inline std::uint64_t GetIntHashKey(std::int64_t IntKey) const  { return HashPolicyUtil::MumMix((std::uint64_t)IntKey ^ 0xe7037ed1a0b428dbULL, MxSeed ^ 0xa0761d6478bd642fULL); }
+
+	private:
+		std::uint64_t MxSeed;
+	};
+
+	// Integer keys are used as their own hash key, which is ideal for keys that are already hashes or dense sequential IDs.
+	// Only combine with power of two masking when the low bits of the keys are well distributed.  String keys use HashFuncWyHash.
+	class HashFuncIdentity : public HashFuncWyHash
+	{
+	public:
+		HashFuncIdentity(bool UseSipHash, std::uint64_t HashKey1, std::uint64_t HashKey2) : HashFuncWyHash(UseSipHash, HashKey1, HashKey2)
+		{
+		}
+
+		inline std::uint64_t GetIntHashKey(std::int64_t IntKey) const  { return (std::uint64_t)IntKey; }
+	};
+}
+
+#endif
@@ -20,8 +20,8 @@ namespace CubicleSoft
 
 		while (Str != StrEnd)
 		{
-			// Changes the official implementation.
-			y = *((const std::uint32_t *)Str);
+			// Changes the official implementation.  Keys aren't necessarily aligned (e.g. ChunkArena keys).
+			std::memcpy(&y, Str, sizeof(std::uint32_t));
 
 			Result = ((Result << 5) + Result) ^ y;
 
@@ -70,7 +70,7 @@ namespace CubicleSoft
 		while (Str != StrEnd)
 		{
 			// Minor change to the official implementation.  (Does endianness actually matter?)
-			y = *((const std::uint64_t *)Str);
+			std::memcpy(&y, Str, sizeof(std::uint64_t));
 
 			v3 ^= y;
 
@@ -1,5 +1,5 @@
 // Ordered hash map with integer and string keys in a memory compact format.  No detachable nodes but is CPU cache-friendly.
-// Primarily useful for array style hashes with lots of insertions (up to 2^31 values), frequent key- and index-based lookups, some iteration, and few deletions.
+// Primarily useful for array style hashes with lots of insertions (up to 2^31 values or 2^30 with the probe index), frequent key- and index-based lookups, some iteration, and few deletions.
 // (C) 2017 CubicleSoft.  All Rights Reserved.
 
 #ifndef CUBICLESOFT_PACKEDORDEREDHASH
@@ -9,41 +9,226 @@
 #include <cstddef>
 #include <cstring>
 #include <new>
+#include "chunk_arena.h"
+#include "hash_policy.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CUBICLESOFT_PACKEDORDEREDHASH_SSE2
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
 
 namespace CubicleSoft
 {
-	template <class T>
+	// HashPolicy is one of the hash function policies in 'hash_policy.h'.  InlineKeys stores string keys up to 15 bytes long inside the node, which makes every node 8 bytes larger.
+	template <class T, class HashPolicy = HashFuncRuntime, bool InlineKeys = false>
 	class PackedOrderedHash;
-	template <class T>
+	template <class T, class HashPolicy = HashFuncRuntime, bool InlineKeys = false>
 	class PackedOrderedHashNoCopy;
 
-	template <class T>
+	template <class T, bool InlineKeys = false>
 	class PackedOrderedHashNode
 	{
-		friend class PackedOrderedHash<T>;
-		friend class PackedOrderedHashNoCopy<T>;
+		template <class T2, class HashPolicy, bool InlineKeys2>
+		friend class PackedOrderedHash;
+		template <class T2, class HashPolicy, bool InlineKeys2>
+		friend class PackedOrderedHashNoCopy;
 
 	public:
+		// For string keys, IntKey is the hash of the string.
 		inline std::int64_t GetIntKey() { return IntKey; }
-		inline char *GetStrKey() { return StrKey; }
-		inline size_t GetStrLen() { return *(size_t *)(StrKey - sizeof(size_t)); }
+		inline char *GetStrKey() { return (GetKeyType() == 0xFF ? NULL : (IsLongStrKey() ? GetLongStrKey() : ShortKey)); }
+		inline size_t GetStrLen() { return (IsLongStrKey() ? *(size_t *)(GetLongStrKey() - sizeof(size_t)) : (GetKeyType() == 0xFF ? 0 : (size_t)GetKeyType())); }
 
 	private:
+		// The key type is 0 to 15 (the length of an inline string key), 0xFD or 0xFE (LongKey is the address of a length prefixed copy of the string key in a ChunkArena or from new[]),
+		// 0xFC (LongKey is the distance from the node to a length prefixed copy of the string key in the same snapshot), or 0xFF (integer key).
+		// With InlineKeys, the type is the last byte of ShortKey.  Otherwise, every string key is long, the type is in the low two bits of LongKey (0xFE minus the type), and integer keys have a LongKey of 0.
+		// Key copies and snapshot offsets are always aligned to at least 4 bytes.
+		inline std::uint8_t GetKeyType() const { return (InlineKeys ? (std::uint8_t)ShortKey[15] : (!LongKey ? 0xFF : (std::uint8_t)(0xFE - (LongKey & 3)))); }
+		inline bool IsLongStrKey() const { return (GetKeyType() >= 0xFC && GetKeyType() <= 0xFE); }
+
+		inline char *GetLongStrKey() const
+		{
+			std::uint64_t Data = (InlineKeys ? LongKey : LongKey & ~(std::uint64_t)3);
+
+			return (GetKeyType() == 0xFC ? (char *)((std::uintptr_t)this + (std::uintptr_t)Data) : (char *)(std::uintptr_t)Data);
+		}
+
+		inline void SetLongStrKey(std::uint64_t Data, std::uint8_t Type)
+		{
+			if (!InlineKeys)  LongKey = Data | (std::uint64_t)(0xFE - Type);
+			else
+			{
+				LongKey = Data;
+				ShortKey[15] = (char)Type;
+			}
+		}
+
+		inline void SetIntKeyType()
+		{
+			if (InlineKeys)  ShortKey[15] = (char)0xFF;
+			else  LongKey = 0;
+		}
+
+		// Long keys are allocated from KeyArena when it isn't NULL.
+		void SetStrKey(const char *Str, const size_t StrLen, ChunkArena *KeyArena)
+		{
+			if (InlineKeys && StrLen < 16)
+			{
+				memcpy(ShortKey, Str, StrLen);
+				ShortKey[15] = (char)StrLen;
+			}
+			else
+			{
+				char *Str2 = (KeyArena != NULL ? (char *)KeyArena->Alloc(StrLen + sizeof(size_t), sizeof(size_t)) : new char[StrLen + sizeof(size_t)]);
+				*((size_t *)Str2) = StrLen;
+				Str2 += sizeof(size_t);
+				memcpy(Str2, Str, StrLen);
+				SetLongStrKey((std::uint64_t)(std::uintptr_t)Str2, (KeyArena != NULL ? 0xFD : 0xFE));
+			}
+		}
+
+		// Only frees long string keys from new[].  Arena keys are freed with the arena.  The node is left with an integer key type.
+		inline void FreeStrKey()
+		{
+			if (GetKeyType() == 0xFE)  delete[] (GetLongStrKey() - sizeof(size_t));
+
+			SetIntKeyType();
+		}
+
+		inline void CopyKey(const PackedOrderedHashNode<T, InlineKeys> &TempNode, ChunkArena *KeyArena)
+		{
+			IntKey = TempNode.IntKey;
+
+			if (TempNode.IsLongStrKey())  SetStrKey(TempNode.GetLongStrKey(), *(size_t *)(TempNode.GetLongStrKey() - sizeof(size_t)), KeyArena);
+			else  memcpy(ShortKey, TempNode.ShortKey, sizeof(ShortKey));
+		}
+
+		// Length and inline bytes are checked before the string is compared and long keys are only followed when the length is long enough.
+		inline bool MatchStrKey(const char *Str, const size_t StrLen) const
+		{
+			if (InlineKeys && StrLen < 16)  return (GetKeyType() == StrLen && !memcmp(ShortKey, Str, StrLen));
+
+			if (!IsLongStrKey())  return false;
+
+			const char *Str2 = GetLongStrKey();
+
+			return (*(const size_t *)(Str2 - sizeof(size_t)) == StrLen && !memcmp(Str2, Str, StrLen));
+		}
+
+		// With the probe index, PrevHashIndex is the node's slot and NextHashIndex is unused.
 		std::uint32_t PrevHashIndex;
 		std::uint32_t NextHashIndex;
 
 		std::int64_t IntKey;
-		char *StrKey;
+
+		// With InlineKeys, string keys up to 15 bytes long are stored in ShortKey.
+		union
+		{
+			std::uint64_t LongKey;
+			char ShortKey[InlineKeys ? 16 : 8];
+		};
 
 	public:
 		T Value;
 	};
 
+	// The start of a snapshot file.  See PackedOrderedHash::SaveSnapshot().
+	struct PackedOrderedHashSnapshotHeader
+	{
+		char Magic[8];
+		std::uint32_t NodeSize, Flags;
+		std::uint64_t HashCheck;
+		std::uint64_t NumNodes, NumSlots, NextNodePos, NumUsed, NumDeletedSlots, KeyDataSize;
+	};
+
 	class PackedOrderedHashUtil
 	{
 	public:
+		// Nodes start this many bytes into a snapshot.
+		static const size_t SnapshotHeaderSize = 128;
+
 		static size_t GetDJBX33XHashKey(const std::uint8_t *Str, size_t Size, size_t InitVal);
 		static std::uint64_t GetSipHashKey(const std::uint8_t *Str, size_t Size, std::uint64_t Key1, std::uint64_t Key2, size_t cRounds, size_t dRounds);
+
+		// Mixes a hash key before the probe index splits it into a 7-bit tag and a group.  Otherwise, 32-bit hash keys (e.g. djb2) would only have 25 bits left for the group.
+		static inline std::uint64_t MixProbeHashKey(std::uint64_t HashKey)
+		{
+			return HashPolicyUtil::MumMix(HashKey, 0x9e3779b97f4a7c15ULL);
+		}
+
+		// Returns one bit for each of the 16 control bytes in Group that equals Tag.
+		static inline std::uint32_t MatchGroup(const std::uint8_t *Group, std::uint8_t Tag)
+		{
+#ifdef CUBICLESOFT_PACKEDORDEREDHASH_SSE2
+			return (std::uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)Group), _mm_set1_epi8((char)Tag)));
+#else
+			std::uint32_t Result = 0;
+
+			for (size_t x = 0; x < 16; x++)
+			{
+				if (Group[x] == Tag)  Result |= ((std::uint32_t)1 << x);
+			}
+
+			return Result;
+#endif
+		}
+
+		// Empty and deleted control bytes have the high bit set.
+		static inline std::uint32_t MatchEmptyOrDeleted(const std::uint8_t *Group)
+		{
+#ifdef CUBICLESOFT_PACKEDORDEREDHASH_SSE2
+			return (std::uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)Group));
+#else
+			std::uint32_t Result = 0;
+
+			for (size_t x = 0; x < 16; x++)
+			{
+				if (Group[x] & 0x80)  Result |= ((std::uint32_t)1 << x);
+			}
+
+			return Result;
+#endif
+		}
+
+		// Hints the CPU to start loading the cache line at Ptr.  Never faults.
+		static inline void Prefetch(const void *Ptr)
+		{
+#ifdef CUBICLESOFT_PACKEDORDEREDHASH_SSE2
+			_mm_prefetch((const char *)Ptr, _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+			__builtin_prefetch(Ptr);
+#else
+			(void)Ptr;
+#endif
+		}
+
+		// Bits must not be 0.
+		static inline size_t GetFirstBit(std::uint32_t Bits)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return (size_t)__builtin_ctz(Bits);
+#elif defined(_MSC_VER)
+			unsigned long Result;
+			_BitScanForward(&Result, Bits);
+
+			return (size_t)Result;
+#else
+			size_t Result = 0;
+
+			while (!(Bits & 1))
+			{
+				Bits >>= 1;
+				Result++;
+			}
+
+			return Result;
+#endif
+		}
 	};
 
 	// PackedOrderedHash.  A packed ordered hash.
@@ -4,7 +4,7 @@
 // NOTE:  This file is intended to be included from 'packed_ordered_hash.h'.
 
 // Implements a packed ordered hash that grows dynamically and uses integer and string keys.
-template <class T>
+template <class T, class HashPolicy, bool InlineKeys>
 #ifdef CUBICLESOFT_PACKEDORDEREDHASH_NOCOPYASSIGN
 class PackedOrderedHashNoCopy
 #else
@@ -17,14 +17,16 @@ public:
 	// https://www.youtube.com/watch?v=R2Cq3CLI6H8
 	// https://www.youtube.com/watch?v=wGYj8fhhUVA
 	// For much better security with a slight performance reduction, use the other constructor, which implements SipHash.
+	// Both constructors pass their keys to HashPolicy, which can replace the djb2/SipHash choice at compile time.
 #ifdef CUBICLESOFT_PACKEDORDEREDHASH_NOCOPYASSIGN
 	PackedOrderedHashNoCopy
 #else
 	PackedOrderedHash
 #endif
-		(size_t EstimatedSize = 8, std::uint64_t HashKey = 5381) : UseSipHash(false), Key1(HashKey), Key2(0),
-			ArrayNodes(NULL), HashNodes(NULL), Mask(0), NumNodes(0), NextNodePos(0), NumUsed(0),
-			CompactNumUsed50(0), CompactNextNodePos75(0), CompactNumUsed90(0), ResizeNumUsed40(0)
+		(size_t EstimatedSize = 8, std::uint64_t HashKey = 5381) : Policy(false, HashKey, 0), KeyArena(NULL),
+			ArrayNodes(NULL), HashNodes(NULL), CtrlBytes(NULL), UseProbeIndex(false), MappedSnapshot(false), Mask(0), NumNodes(0), NumSlots(0), NextNodePos(0), NumUsed(0),
+			CompactNumUsed50(0), CompactNextNodePos75(0), CompactNumUsed90(0), ResizeNumUsed40(0),
+			NumDeletedSlots(0), CompactStartPos(0), CompactDestPos(0), CompactSrcPos(0), CompactStepSize(0), Compacting(false)
 	{
 		ResizeHash(EstimatedSize);
 	}
@@ -36,9 +38,10 @@ public:
 #else
 	PackedOrderedHash
 #endif
-		(size_t EstimatedSize, std::uint64_t HashKey1, std::uint64_t HashKey2) : UseSipHash(true), Key1(HashKey1), Key2(HashKey2),
-			ArrayNodes(NULL), HashNodes(NULL), Mask(0), NumNodes(0), NextNodePos(0), NumUsed(0),
-			CompactNumUsed50(0), CompactNextNodePos75(0), CompactNumUsed90(0), ResizeNumUsed40(0)
+		(size_t EstimatedSize, std::uint64_t HashKey1, std::uint64_t HashKey2) : Policy(true, HashKey1, HashKey2), KeyArena(NULL),
+			ArrayNodes(NULL), HashNodes(NULL), CtrlBytes(NULL), UseProbeIndex(false), MappedSnapshot(false), Mask(0), NumNodes(0), NumSlots(0), NextNodePos(0), NumUsed(0),
+			CompactNumUsed50(0), CompactNextNodePos75(0), CompactNumUsed90(0), ResizeNumUsed40(0),
+			NumDeletedSlots(0), CompactStartPos(0), CompactDestPos(0), CompactSrcPos(0), CompactStepSize(0), Compacting(false)
 	{
 		ResizeHash(EstimatedSize);
 	}
@@ -49,59 +52,44 @@ public:
 	~PackedOrderedHash()
 #endif
 	{
-		PackedOrderedHashNode<T> *Node = ArrayNodes, *LastNode = ArrayNodes + NextNodePos;
-		while (Node != LastNode)
-		{
-			if (Node->PrevHashIndex != 0xFFFFFFFF)
-			{
-				Node->Value.~T();
-
-				if (Node->StrKey != NULL)  delete[] (Node->StrKey - sizeof(size_t));
-			}
+		InternalFreeNodes();
 
-			Node++;
-		}
-
-		delete[] (char *)ArrayNodes;
+		if (KeyArena != NULL)  delete KeyArena;
 	}
 
 #ifdef CUBICLESOFT_PACKEDORDEREDHASH_NOCOPYASSIGN
-	PackedOrderedHashNoCopy(const PackedOrderedHashNoCopy<T> &TempHash);
-	PackedOrderedHashNoCopy<T> &operator=(const PackedOrderedHashNoCopy<T> &TempHash);
+	PackedOrderedHashNoCopy(const PackedOrderedHashNoCopy<T, HashPolicy, InlineKeys> &TempHash);
+	PackedOrderedHashNoCopy<T, HashPolicy, InlineKeys> &operator=(const PackedOrderedHashNoCopy<T, HashPolicy, InlineKeys> &TempHash);
 #else
-	PackedOrderedHash(const PackedOrderedHash<T> &TempHash)
+	PackedOrderedHash(const PackedOrderedHash<T, HashPolicy, InlineKeys> &TempHash) : Policy(TempHash.Policy)
 	{
-		UseSipHash = TempHash.UseSipHash;
-		Key1 = TempHash.Key1;
-		Key2 = TempHash.Key2;
+		KeyArena = (TempHash.KeyArena != NULL ? new ChunkArena(TempHash.KeyArena->GetChunkSize(), TempHash.KeyArena->GetMallocFunc(), TempHash.KeyArena->GetFreeFunc(), TempHash.KeyArena->GetAllocData()) : NULL);
 
 		ArrayNodes = NULL;
+		UseProbeIndex = TempHash.UseProbeIndex;
+		MappedSnapshot = false;
 		NumNodes = 0;
 		NumUsed = 0;
 
 		InternalResizeHash(TempHash.NumNodes);
 		NextNodePos = TempHash.NextNodePos;
-		memcpy(HashNodes, TempHash.HashNodes, sizeof(std::uint32_t) * NumNodes);
+		if (CtrlBytes != NULL)  memcpy(CtrlBytes, TempHash.CtrlBytes, (NumSlots >> 4) * 80);
+		else  memcpy(HashNodes, TempHash.HashNodes, sizeof(std::uint32_t) * NumSlots);
 		NumUsed = TempHash.NumUsed;
+		NumDeletedSlots = TempHash.NumDeletedSlots;
+		CompactStartPos = TempHash.CompactStartPos;
+		CompactDestPos = TempHash.CompactDestPos;
+		CompactSrcPos = TempHash.CompactSrcPos;
+		CompactStepSize = TempHash.CompactStepSize;
+		Compacting = TempHash.Compacting;
 
-		PackedOrderedHashNode<T> *Node = TempHash.ArrayNodes, *Node2 = ArrayNodes, *LastNode = ArrayNodes + NextNodePos;
+		PackedOrderedHashNode<T, InlineKeys> *Node = TempHash.ArrayNodes, *Node2 = ArrayNodes, *LastNode = TempHash.ArrayNodes + NextNodePos;
 
 		while (Node != LastNode)
 		{
 			Node2->PrevHashIndex = Node->PrevHashIndex;
 			Node2->NextHashIndex = Node->NextHashIndex;
-			Node2->IntKey = Node->IntKey;
-
-			if (Node->StrKey == NULL)  Node2->StrKey = NULL;
-			else
-			{
-				size_t StrLen = Node->GetStrLen();
-				char *Str = new char[StrLen + sizeof(size_t)];
-				*((size_t *)Str) = StrLen;
-				Str += sizeof(size_t);
-				memcpy(Str, Node->StrKey, StrLen);
-				Node2->StrKey = Str;
-			}
+			Node2->CopyKey(*Node, KeyArena);
 
 			if (Node->PrevHashIndex != 0xFFFFFFFF)
 			{
@@ -113,58 +101,41 @@ public:
 		}
 	}
 
-	PackedOrderedHash<T> &operator=(const PackedOrderedHash<T> &TempHash)
+	PackedOrderedHash<T, HashPolicy, InlineKeys> &operator=(const PackedOrderedHash<T, HashPolicy, InlineKeys> &TempHash)
 	{
 		if (&TempHash != this)
 		{
-			UseSipHash = TempHash.UseSipHash;
-			Key1 = TempHash.Key1;
-			Key2 = TempHash.Key2;
+			Policy = TempHash.Policy;
 
-			PackedOrderedHashNode<T> *Node = ArrayNodes, *Node2, *LastNode = ArrayNodes + NextNodePos;
-			while (Node != LastNode)
-			{
-				if (Node->PrevHashIndex != 0xFFFFFFFF)
-				{
-					Node->Value.~T();
+			InternalFreeNodes();
 
-					if (Node->StrKey != NULL)  delete[] (Node->StrKey - sizeof(size_t));
-				}
-
-				Node++;
-			}
-
-			delete[] (char *)ArrayNodes;
+			if (KeyArena != NULL)  delete KeyArena;
+			KeyArena = (TempHash.KeyArena != NULL ? new ChunkArena(TempHash.KeyArena->GetChunkSize(), TempHash.KeyArena->GetMallocFunc(), TempHash.KeyArena->GetFreeFunc(), TempHash.KeyArena->GetAllocData()) : NULL);
 
 			ArrayNodes = NULL;
+			UseProbeIndex = TempHash.UseProbeIndex;
 			NumNodes = 0;
 			NumUsed = 0;
 
 			InternalResizeHash(TempHash.NumNodes);
 			NextNodePos = TempHash.NextNodePos;
-			memcpy(HashNodes, TempHash.HashNodes, sizeof(std::uint32_t) * NumNodes);
+			if (CtrlBytes != NULL)  memcpy(CtrlBytes, TempHash.CtrlBytes, (NumSlots >> 4) * 80);
+			else  memcpy(HashNodes, TempHash.HashNodes, sizeof(std::uint32_t) * NumSlots);
 			NumUsed = TempHash.NumUsed;
+			NumDeletedSlots = TempHash.NumDeletedSlots;
+			CompactStartPos = TempHash.CompactStartPos;
+			CompactDestPos = TempHash.CompactDestPos;
+			CompactSrcPos = TempHash.CompactSrcPos;
+			CompactStepSize = TempHash.CompactStepSize;
+			Compacting = TempHash.Compacting;
 
-			Node = TempHash.ArrayNodes;
-			Node2 = ArrayNodes;
-			LastNode = ArrayNodes + NextNodePos;
+			PackedOrderedHashNode<T, InlineKeys> *Node = TempHash.ArrayNodes, *Node2 = ArrayNodes, *LastNode = TempHash.ArrayNodes + NextNodePos;
 
 			while (Node != LastNode)
 			{
 				Node2->PrevHashIndex = Node->PrevHashIndex;
 				Node2->NextHashIndex = Node->NextHashIndex;
-				Node2->IntKey = Node->IntKey;
-
-				if (Node->StrKey == NULL)  Node2->StrKey = NULL;
-				else
-				{
-					size_t StrLen = Node->GetStrLen();
-					char *Str = new char[StrLen + sizeof(size_t)];
-					*((size_t *)Str) = StrLen;
-					Str += sizeof(size_t);
-					memcpy(Str, Node->StrKey, StrLen);
-					Node2->StrKey = Str;
-				}
+				Node2->CopyKey(*Node, KeyArena);
 
 				if (Node->PrevHashIndex != 0xFFFFFFFF)
 				{
@@ -180,87 +151,51 @@ public:
 	}
 #endif
 
-	PackedOrderedHashNode<T> *Set(const std::int64_t IntKey)
+	// Returns NULL when the hash is full.  See GetMaxHashSize().
+	inline PackedOrderedHashNode<T, InlineKeys> *Set(const std::int64_t IntKey)
 	{
-		size_t Pos;
-		std::uint64_t HashKey = GetHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t));
-		PackedOrderedHashNode<T> *Node = InternalFind(IntKey, Pos, HashKey);
-
-		if (Node != NULL)  return Node;
-
-		// Create a new node.
-		if (NextNodePos == NumNodes)  AutoResizeHash();
-
-		Node = ArrayNodes + NextNodePos;
-		new (&Node->Value) T;
-		Pos = NextNodePos;
-		NextNodePos++;
-
-		// Attach the node to the start of the hash list.
-		std::uint32_t HashPos = (std::uint32_t)HashKey & Mask;
-		Node->PrevHashIndex = 0x80000000 | HashPos;
-		Node->NextHashIndex = HashNodes[HashPos];
-		if (Node->NextHashIndex != 0xFFFFFFFF)  ArrayNodes[Node->NextHashIndex].PrevHashIndex = (std::uint32_t)Pos;
-		HashNodes[HashPos] = (std::uint32_t)Pos;
-
-		Node->IntKey = IntKey;
-		Node->StrKey = NULL;
-
-		NumUsed++;
-
-		return Node;
+		return InternalSet(IntKey, Policy.GetIntHashKey(IntKey));
 	}
 
-	inline PackedOrderedHashNode<T> *Set(const std::int64_t IntKey, const T &Value)
+	inline PackedOrderedHashNode<T, InlineKeys> *Set(const std::int64_t IntKey, const T &Value)
 	{
-		PackedOrderedHashNode<T> *Node = Set(IntKey);
-		Node->Value = Value;
+		PackedOrderedHashNode<T, InlineKeys> *Node = Set(IntKey);
+		if (Node != NULL)  Node->Value = Value;
 
 		return Node;
 	}
 
-	PackedOrderedHashNode<T> *Set(const char *StrKey, const size_t StrLen)
+	inline PackedOrderedHashNode<T, InlineKeys> *Set(const char *StrKey, const size_t StrLen)
 	{
-		size_t Pos;
-		std::uint64_t HashKey = GetHashKey((const std::uint8_t *)StrKey, StrLen);
-		PackedOrderedHashNode<T> *Node = InternalFind(StrKey, StrLen, Pos, HashKey);
-
-		if (Node != NULL)  return Node;
-
-		// Create a new node.
-		if (NextNodePos == NumNodes)  AutoResizeHash();
-
-		Node = ArrayNodes + NextNodePos;
-		Pos = NextNodePos;
-		new (&Node->Value) T;
-		NextNodePos++;
+		return InternalSet(StrKey, StrLen, Policy.GetHashKey((const std::uint8_t *)StrKey, StrLen));
+	}
 
-		// Attach the node to the start of the hash list.
-		std::uint32_t HashPos = (std::uint32_t)HashKey & Mask;
-		Node->PrevHashIndex = 0x80000000 | HashPos;
-		Node->NextHashIndex = HashNodes[HashPos];
-		if (Node->NextHashIndex != 0xFFFFFFFF)  ArrayNodes[Node->NextHashIndex].PrevHashIndex = (std::uint32_t)Pos;
-		HashNodes[HashPos] = (std::uint32_t)Pos;
+	inline PackedOrderedHashNode<T, InlineKeys> *Set(const char *StrKey, const size_t StrLen, const T &Value)
+	{
+		PackedOrderedHashNode<T, InlineKeys> *Node = Set(StrKey, StrLen);
+		if (Node != NULL)  Node->Value = Value;
 
-		Node->IntKey = (std::int64_t)HashKey;
+		return Node;
+	}
 
-		char *Str = new char[StrLen + sizeof(size_t)];
-		*((size_t *)Str) = StrLen;
-		Str += sizeof(size_t);
-		memcpy(Str, StrKey, StrLen);
-		Node->StrKey = Str;
+	// Sets NumKeys keys to the matching Values.  Returns the number of new keys.
+	// Works like FindBatch().  Node pointers aren't returned since later keys in the batch can resize the hash.
+	inline size_t SetBatch(const std::int64_t *IntKeys, size_t NumKeys, const T *Values)
+	{
+		size_t Num = NumUsed;
 
-		NumUsed++;
+		InternalBatch(IntKeys, NULL, NULL, NumKeys, NULL, Values);
 
-		return Node;
+		return NumUsed - Num;
 	}
 
-	inline PackedOrderedHashNode<T> *Set(const char *StrKey, const size_t StrLen, const T &Value)
+	inline size_t SetBatch(const char *const *StrKeys, const size_t *StrLens, size_t NumKeys, const T *Values)
 	{
-		PackedOrderedHashNode<T> *Node = Set(StrKey, StrLen);
-		Node->Value = Value;
+		size_t Num = NumUsed;
 
-		return Node;
+		InternalBatch(NULL, StrKeys, StrLens, NumKeys, NULL, Values);
+
+		return NumUsed - Num;
 	}
 
 	inline bool Unset(const std::int64_t IntKey)
@@ -273,41 +208,111 @@ public:
 		return Unset(Find(StrKey, StrLen));
 	}
 
-	bool Unset(PackedOrderedHashNode<T> *Node)
+	bool Unset(PackedOrderedHashNode<T, InlineKeys> *Node)
 	{
 		if (Node == NULL || Node->PrevHashIndex == 0xFFFFFFFF)  return false;
 
-		// Detach the node from the hash list.
-		if (Node->NextHashIndex != 0xFFFFFFFF)  ArrayNodes[Node->NextHashIndex].PrevHashIndex = Node->PrevHashIndex;
+		if (MappedSnapshot)
+		{
+			size_t Pos = (size_t)(Node - ArrayNodes);
+
+			InternalCopySnapshot();
 
-		if (Node->PrevHashIndex & 0x80000000)  HashNodes[Node->PrevHashIndex & 0x7FFFFFFF] = Node->NextHashIndex;
-		else  ArrayNodes[Node->PrevHashIndex].NextHashIndex = Node->NextHashIndex;
+			Node = ArrayNodes + Pos;
+		}
+
+		if (CtrlBytes != NULL)
+		{
+			// Probes stop at the first group with an empty slot.  If this slot's group has one, no probe sequence continues past it and the slot can become empty again.
+			// Otherwise, mark it deleted (0xFE).
+			std::uint8_t *GroupBytes = CtrlBytes + (size_t)(Node->PrevHashIndex >> 4) * 80;
+			GroupBytes[Node->PrevHashIndex & 15] = (PackedOrderedHashUtil::MatchGroup(GroupBytes, 0x80) ? 0x80 : 0xFE);
+			if (GroupBytes[Node->PrevHashIndex & 15] == 0xFE)  NumDeletedSlots++;
+		}
+		else
+		{
+			// Detach the node from the hash list.
+			if (Node->NextHashIndex != 0xFFFFFFFF)  ArrayNodes[Node->NextHashIndex].PrevHashIndex = Node->PrevHashIndex;
+
+			if (Node->PrevHashIndex & 0x80000000)  HashNodes[Node->PrevHashIndex & 0x7FFFFFFF] = Node->NextHashIndex;
+			else  ArrayNodes[Node->PrevHashIndex].NextHashIndex = Node->NextHashIndex;
+		}
 
 		// Cleanup.
 		Node->PrevHashIndex = 0xFFFFFFFF;
 		Node->Value.~T();
-		if (Node->StrKey != NULL)
+		Node->FreeStrKey();
+
+		NumUsed--;
+
+		if ((size_t)(Node - ArrayNodes) < CompactStartPos)  CompactStartPos = (size_t)(Node - ArrayNodes);
+
+		if (CompactStepSize)  InternalAutoCompact();
+
+		return true;
+	}
+
+	// Removes all nodes without shrinking the hash.
+	void Empty()
+	{
+		// A loaded snapshot is replaced with an empty array of the same size.
+		if (MappedSnapshot)
 		{
-			delete[] (Node->StrKey - sizeof(size_t));
-			Node->StrKey = NULL;
+			ArrayNodes = NULL;
+			MappedSnapshot = false;
+			NumUsed = 0;
+
+			InternalRebuildHash(NumNodes);
 		}
 
-		NumUsed--;
+		PackedOrderedHashNode<T, InlineKeys> *Node = ArrayNodes, *LastNode = ArrayNodes + NextNodePos;
+		while (Node != LastNode)
+		{
+			if (Node->PrevHashIndex != 0xFFFFFFFF)
+			{
+				Node->Value.~T();
+
+				Node->FreeStrKey();
+			}
+
+			Node++;
+		}
+
+		NextNodePos = 0;
+		NumUsed = 0;
+		CompactStartPos = 0;
+		Compacting = false;
+
+		InternalRebuildIndex();
+
+		if (KeyArena != NULL)  KeyArena->Empty();
+	}
+
+	// Allocates new long string keys (see InlineKeys) from a ChunkArena owned by the hash instead of one new[] per key.
+	// Arena keys are only freed by Empty() and the destructor, so the memory of unset keys isn't reused until then.
+	// Chunks are allocated with MallocFn and FreeFn when set (e.g. from a Sync::TLS object).  See ChunkArena.
+	bool UseKeyArena(size_t ChunkSize = 65536, ChunkArena::MallocFunc MallocFn = NULL, ChunkArena::FreeFunc FreeFn = NULL, void *AllocData = NULL)
+	{
+		if (KeyArena != NULL)  return false;
+
+		KeyArena = new ChunkArena(ChunkSize, MallocFn, FreeFn, AllocData);
 
 		return true;
 	}
 
+	inline ChunkArena *GetKeyArena() { return KeyArena; }
+
 	// Returns the node in the array by index.
-	inline PackedOrderedHashNode<T> *Get(size_t Pos)
+	inline PackedOrderedHashNode<T, InlineKeys> *Get(size_t Pos)
 	{
 		return (Pos >= NextNodePos || ArrayNodes[Pos].PrevHashIndex == 0xFFFFFFFF ? NULL : ArrayNodes + Pos);
 	}
 
 	// Gets the position of the node in the array.
-	inline size_t GetPos(PackedOrderedHashNode<T> *Node) { return (size_t)(Node - ArrayNodes); }
+	inline size_t GetPos(PackedOrderedHashNode<T, InlineKeys> *Node) { return (size_t)(Node - ArrayNodes); }
 
 	// Finds the node in the array via the hash.
-	inline PackedOrderedHashNode<T> *Find(const std::int64_t IntKey)
+	inline PackedOrderedHashNode<T, InlineKeys> *Find(const std::int64_t IntKey)
 	{
 		size_t Pos;
 
@@ -315,13 +320,13 @@ public:
 	}
 
 	// Finds the node in the array via the hash.
-	inline PackedOrderedHashNode<T> *Find(const std::int64_t IntKey, size_t &Pos)
+	inline PackedOrderedHashNode<T, InlineKeys> *Find(const std::int64_t IntKey, size_t &Pos)
 	{
-		return InternalFind(IntKey, Pos, GetHashKey((const std::uint8_t *)&IntKey, sizeof(std::int64_t)));
+		return InternalFind(IntKey, Pos, Policy.GetIntHashKey(IntKey));
 	}
 
 	// Finds the node in the array via the hash.
-	inline PackedOrderedHashNode<T> *Find(const char *StrKey, const size_t StrLen)
+	inline PackedOrderedHashNode<T, InlineKeys> *Find(const char *StrKey, const size_t StrLen)
 	{
 		size_t Pos;
 
@@ -329,13 +334,26 @@ public:
 	}
 
 	// Finds the node in the array via the hash.
-	inline PackedOrderedHashNode<T> *Find(const char *StrKey, const size_t StrLen, size_t &Pos)
+	inline PackedOrderedHashNode<T, InlineKeys> *Find(const char *StrKey, const size_t StrLen, size_t &Pos)
+	{
+		return InternalFind(StrKey, StrLen, Pos, Policy.GetHashKey((const std::uint8_t *)StrKey, StrLen));
+	}
+
+	// Finds NumKeys keys at once.  Results[x] is set to the node for IntKeys[x] or NULL.  Returns the number of keys found.
+	// Lookups are software pipelined:  All hashes are calculated and the index entries and then the nodes are prefetched a few keys ahead of where
+	// the lookups happen.  This overlaps the cache misses of separate lookups, which helps when the hash is much larger than the CPU cache.
+	inline size_t FindBatch(const std::int64_t *IntKeys, size_t NumKeys, PackedOrderedHashNode<T, InlineKeys> **Results)
+	{
+		return InternalBatch(IntKeys, NULL, NULL, NumKeys, Results, NULL);
+	}
+
+	inline size_t FindBatch(const char *const *StrKeys, const size_t *StrLens, size_t NumKeys, PackedOrderedHashNode<T, InlineKeys> **Results)
 	{
-		return InternalFind(StrKey, StrLen, Pos, GetHashKey((const std::uint8_t *)StrKey, StrLen));
+		return InternalBatch(NULL, StrKeys, StrLens, NumKeys, Results, NULL);
 	}
 
 	// Iterates over the array, skipping unset nodes.  Initialize the input Pos to GetNextPos() to start at the beginning.
-	inline PackedOrderedHashNode<T> *Next(size_t &Pos)
+	inline PackedOrderedHashNode<T, InlineKeys> *Next(size_t &Pos)
 	{
 		if (Pos >= NextNodePos)  Pos = 0;
 		else  Pos++;
@@ -349,7 +367,7 @@ public:
 	}
 
 	// Iterates over the array, skipping unset nodes.  Initialize the input Pos to GetNextPos() to start at the end.
-	inline PackedOrderedHashNode<T> *Prev(size_t &Pos)
+	inline PackedOrderedHashNode<T, InlineKeys> *Prev(size_t &Pos)
 	{
 		if (Pos > NextNodePos)  Pos = NextNodePos;
 
@@ -374,10 +392,15 @@ public:
 	// Compacts the array by moving elements to unset positions.
 	bool Optimize()
 	{
+		Compacting = false;
+		CompactStartPos = NumUsed;
+
 		if (NextNodePos == NumUsed)  return true;
 
+		if (MappedSnapshot)  InternalCopySnapshot();
+
 		// Find the first unset position.
-		PackedOrderedHashNode<T> *Node = ArrayNodes, *Node2, *LastNode = ArrayNodes + NextNodePos;
+		PackedOrderedHashNode<T, InlineKeys> *Node = ArrayNodes, *Node2, *LastNode = ArrayNodes + NextNodePos;
 		while (Node != LastNode && Node->PrevHashIndex != 0xFFFFFFFF)  Node++;
 
 		// Copy nodes.
@@ -387,13 +410,8 @@ public:
 			if (Node2->PrevHashIndex != 0xFFFFFFFF)
 			{
 				// Raw copy node.
-				memcpy(Node, Node2, sizeof(PackedOrderedHashNode<T>));
-
-				// Update node hash indexes.
-				if (Node->PrevHashIndex & 0x80000000)  HashNodes[Node->PrevHashIndex & 0x7FFFFFFF] = x;
-				else  ArrayNodes[Node->PrevHashIndex].NextHashIndex = x;
-
-				if (Node->NextHashIndex != 0xFFFFFFFF)  ArrayNodes[Node->NextHashIndex].PrevHashIndex = x;
+				memcpy(Node, Node2, sizeof(PackedOrderedHashNode<T, InlineKeys>));
+				InternalUpdateIndex(Node, x);
 
 				Node++;
 				x++;
@@ -404,14 +422,79 @@ public:
 		for (; Node != LastNode; Node++)
 		{
 			Node->PrevHashIndex = 0xFFFFFFFF;
-			Node->StrKey = NULL;
+			Node->SetIntKeyType();
 		}
 
 		NextNodePos = NumUsed;
 
+		// Deleted slots can only be reused by keys that probe past them.  Clear them out so that every probe sequence still reaches an empty slot.
+		if (CtrlBytes != NULL)  InternalRebuildIndex();
+
 		return true;
 	}
 
+	// Compacts the array a little at a time, e.g. during idle time.  Optimize() and automatic compaction move every node in one go, which is a long pause for large arrays.
+	// Examines up to Budget array positions and moves the nodes in use down into unset positions while keeping their order.  Starts a pass when there are unset nodes.
+	// Returns whether a pass is still in progress.  Nodes move, so node pointers and positions from before the call may no longer be valid.
+	bool CompactStep(size_t Budget)
+	{
+		if (!Compacting)
+		{
+			if (NumUsed == NextNodePos)  return false;
+
+			if (MappedSnapshot)  InternalCopySnapshot();
+
+			// Every unset node is at or after CompactStartPos.
+			if (CompactStartPos > NextNodePos)  CompactStartPos = NextNodePos;
+
+			CompactDestPos = CompactStartPos;
+			CompactSrcPos = CompactStartPos;
+			CompactStartPos = NextNodePos;
+			Compacting = true;
+		}
+
+		// Positions from CompactDestPos up to CompactSrcPos are unset.
+		PackedOrderedHashNode<T, InlineKeys> *Node = ArrayNodes + CompactDestPos, *Node2 = ArrayNodes + CompactSrcPos;
+		for (; Budget && CompactSrcPos < NextNodePos; Budget--)
+		{
+			if (Node2->PrevHashIndex != 0xFFFFFFFF)
+			{
+				if (Node != Node2)
+				{
+					// Raw copy node.
+					memcpy(Node, Node2, sizeof(PackedOrderedHashNode<T, InlineKeys>));
+					InternalUpdateIndex(Node, (std::uint32_t)CompactDestPos);
+
+					Node2->PrevHashIndex = 0xFFFFFFFF;
+					Node2->SetIntKeyType();
+				}
+
+				Node++;
+				CompactDestPos++;
+			}
+
+			Node2++;
+			CompactSrcPos++;
+		}
+
+		if (CompactSrcPos < NextNodePos)  return true;
+
+		NextNodePos = CompactDestPos;
+		if (CompactStartPos > NextNodePos)  CompactStartPos = NextNodePos;
+		Compacting = false;
+
+		// Unlike Optimize(), only clear out deleted probe index slots once they take up a quarter of the index.
+		if (CtrlBytes != NULL && NumDeletedSlots > (NumSlots >> 2))  InternalRebuildIndex();
+
+		return false;
+	}
+
+	// Runs CompactStep(StepSize) on each new key and each unset once more than 1/16th of the array is unset nodes and the array is close enough to full.  0 turns it off (the default).
+	// Nodes move during Set() calls for new keys and Unset() calls, so node pointers and positions are only valid until the next one.
+	inline void SetIncrementalCompaction(size_t StepSize)  { CompactStepSize = StepSize; }
+	inline size_t GetIncrementalCompaction()  { return CompactStepSize; }
+	inline bool IsCompacting()  { return Compacting; }
+
 // Compact when resizing the hash.
 
 	// Performs automatic resizing based on several rules:
@@ -422,7 +505,7 @@ public:
 	{
 		if (NumUsed < CompactNumUsed90)  return Optimize();
 		if (NumUsed < ResizeNumUsed40)  return InternalResizeHash(NumNodes >> 1);
-		if (NextNodePos == NumNodes)  return InternalResizeHash(NumNodes << 1);
+		if (NextNodePos == NumNodes && NumNodes < GetMaxHashSize(UseProbeIndex))  return InternalResizeHash(NumNodes << 1);
 
 		return false;
 	}
@@ -435,22 +518,199 @@ public:
 		return InternalResizeHash(NewSize);
 	}
 
+	// Switches between hash chains (the default) and an open addressing index.
+	// The open addressing index keeps a 7-bit tag of each key's hash in groups of 16 control bytes that are compared at once (SSE2 when available).
+	// Lookups of missing keys rarely touch a node and string keys are only compared when the tag matches.
+	// It has at least two slots per node and costs 10 bytes per node instead of 4.
+	// Fails if there are more nodes than the probe index supports.
+	bool SetProbeIndex(bool Enable)
+	{
+		if (UseProbeIndex == Enable)  return true;
+		if (NumUsed > GetMaxHashSize(Enable))  return false;
+
+		UseProbeIndex = Enable;
+
+		return InternalRebuildHash(NumNodes > GetMaxHashSize(Enable) ? GetMaxHashSize(Enable) : NumNodes);
+	}
+
+	// The most nodes the hash can hold.  Node positions and probe index slots have to stay below the unset marker (0xFFFFFFFF) in PrevHashIndex.
+	static inline size_t GetMaxHashSize(bool Probe)  { return (Probe ? (size_t)1 << 30 : (size_t)1 << 31); }
+
+	inline bool IsProbeIndex() { return UseProbeIndex; }
+
 	inline size_t GetHashSize() { return NumNodes; }
 	inline size_t GetNextPos() { return NextNodePos; }
 	inline size_t GetSize() { return NumUsed; }
 
-private:
-	inline std::uint64_t GetHashKey(const std::uint8_t *Str, size_t Size) const
+	// Writes the hash to File (e.g. a UTF8::File opened for writing) in a format that LoadSnapshot() uses in place.  Only for POD values (no pointers).
+	// The header is followed by the nodes, the index, and then long string keys.  Long key pointers are written as offsets from the node.
+	// Snapshots can only be loaded by builds with the same node layout, byte order, and hash policy and keys.  Returns false when a write fails.
+	template <class FileType>
+	bool SaveSnapshot(FileType &File)
 	{
-		return (UseSipHash ? PackedOrderedHashUtil::GetSipHashKey(Str, Size, Key1, Key2, 2, 4) : (std::uint64_t)PackedOrderedHashUtil::GetDJBX33XHashKey(Str, Size, (size_t)Key1));
+		const size_t NodeSize = sizeof(PackedOrderedHashNode<T, InlineKeys>), BufferSize = 65536 + NodeSize;
+		size_t x, y, BufferPos, IndexSize = InternalGetIndexSize();
+		std::uint64_t KeyStart, KeyPos;
+		const std::uint8_t Padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		PackedOrderedHashSnapshotHeader Header;
+		PackedOrderedHashNode<T, InlineKeys> *Node;
+		bool Result = true;
+
+		KeyStart = ((std::uint64_t)PackedOrderedHashUtil::SnapshotHeaderSize + (std::uint64_t)NodeSize * NextNodePos + IndexSize + 7) & ~(std::uint64_t)7;
+
+		memset(&Header, 0, sizeof(Header));
+		memcpy(Header.Magic, "POHSNAP1", 8);
+		Header.NodeSize = (std::uint32_t)NodeSize;
+		Header.Flags = (CtrlBytes != NULL ? 1 : 0) | (InlineKeys ? 2 : 0);
+		Header.HashCheck = InternalGetSnapshotHashCheck();
+		Header.NumNodes = NumNodes;
+		Header.NumSlots = NumSlots;
+		Header.NextNodePos = NextNodePos;
+		Header.NumUsed = NumUsed;
+		Header.NumDeletedSlots = NumDeletedSlots;
+		for (x = 0; x < NextNodePos; x++)
+		{
+			if (ArrayNodes[x].PrevHashIndex != 0xFFFFFFFF && ArrayNodes[x].IsLongStrKey())  Header.KeyDataSize += (sizeof(size_t) + ArrayNodes[x].GetStrLen() + 7) & ~(size_t)7;
+		}
+
+		std::uint8_t *Buffer = new std::uint8_t[BufferSize];
+		memset(Buffer, 0, PackedOrderedHashUtil::SnapshotHeaderSize);
+		memcpy(Buffer, &Header, sizeof(Header));
+		BufferPos = PackedOrderedHashUtil::SnapshotHeaderSize;
+
+		// Unset nodes are zeroed out so that the file doesn't contain stale keys or values.
+		KeyPos = KeyStart;
+		for (x = 0; Result && x < NextNodePos; x++)
+		{
+			if (BufferPos + NodeSize > BufferSize)  Result = InternalSnapshotWrite(File, Buffer, BufferPos, BufferSize, NULL, 0);
+
+			Node = (PackedOrderedHashNode<T, InlineKeys> *)(Buffer + BufferPos);
+			if (ArrayNodes[x].PrevHashIndex == 0xFFFFFFFF)
+			{
+				memset((void *)Node, 0, NodeSize);
+				Node->PrevHashIndex = 0xFFFFFFFF;
+				Node->NextHashIndex = 0xFFFFFFFF;
+				Node->SetIntKeyType();
+			}
+			else
+			{
+				memcpy((void *)Node, ArrayNodes + x, NodeSize);
+
+				if (Node->IsLongStrKey())
+				{
+					Node->SetLongStrKey(KeyPos + sizeof(size_t) - ((std::uint64_t)PackedOrderedHashUtil::SnapshotHeaderSize + (std::uint64_t)NodeSize * x), 0xFC);
+
+					KeyPos += (sizeof(size_t) + ArrayNodes[x].GetStrLen() + 7) & ~(size_t)7;
+				}
+			}
+
+			BufferPos += NodeSize;
+		}
+
+		if (Result)  Result = InternalSnapshotWrite(File, Buffer, BufferPos, BufferSize, (CtrlBytes != NULL ? (const void *)CtrlBytes : (const void *)HashNodes), IndexSize);
+
+		y = (size_t)(KeyStart - (PackedOrderedHashUtil::SnapshotHeaderSize + (std::uint64_t)NodeSize * NextNodePos + IndexSize));
+		if (Result && y)  Result = InternalSnapshotWrite(File, Buffer, BufferPos, BufferSize, Padding, y);
+
+		for (x = 0; Result && x < NextNodePos; x++)
+		{
+			if (ArrayNodes[x].PrevHashIndex != 0xFFFFFFFF && ArrayNodes[x].IsLongStrKey())
+			{
+				y = ArrayNodes[x].GetStrLen();
+
+				Result = InternalSnapshotWrite(File, Buffer, BufferPos, BufferSize, ArrayNodes[x].GetLongStrKey() - sizeof(size_t), sizeof(size_t) + y);
+				if (Result && (y & 7))  Result = InternalSnapshotWrite(File, Buffer, BufferPos, BufferSize, Padding, 8 - (y & 7));
+			}
+		}
+
+		if (Result)  Result = InternalSnapshotWrite(File, Buffer, BufferPos, BufferSize, NULL, 0);
+
+		delete[] Buffer;
+
+		return Result;
+	}
+
+	// Uses a snapshot from SaveSnapshot() in place without rebuilding the index, e.g. the data from UTF8::File::Map().  Data must be 16 byte aligned and stay mapped and unchanged
+	// until the hash is destroyed or changed.  The current nodes are removed.  Find(), Next(), etc. return nodes in the snapshot, which must not be changed.
+	// The first call that changes the hash (Set(), Unset(), Optimize(), etc.) copies it into memory owned by the hash.  Returns false if the snapshot doesn't match this hash.
+	// Key offsets aren't checked, so only load trusted snapshots.
+	bool LoadSnapshot(const void *Data, size_t Size)
+	{
+		const PackedOrderedHashSnapshotHeader *Header = (const PackedOrderedHashSnapshotHeader *)Data;
+
+		if (Data == NULL || ((std::uintptr_t)Data & 15) || Size < PackedOrderedHashUtil::SnapshotHeaderSize)  return false;
+		if (memcmp(Header->Magic, "POHSNAP1", 8) || Header->NodeSize != sizeof(PackedOrderedHashNode<T, InlineKeys>) || ((Header->Flags & 2) != 0) != InlineKeys || Header->HashCheck != InternalGetSnapshotHashCheck())  return false;
+
+		bool Probe = ((Header->Flags & 1) != 0);
+		if (!Header->NumNodes || Header->NumNodes > GetMaxHashSize(Probe) || (Header->NumNodes & (Header->NumNodes - 1)) || Header->NextNodePos > Header->NumNodes || Header->NumUsed > Header->NextNodePos)  return false;
+		if (Header->NumSlots != InternalGetNumSlots(Probe, (size_t)Header->NumNodes) || Header->NumDeletedSlots > Header->NumSlots)  return false;
+
+		std::uint64_t IndexSize = (Probe ? (Header->NumSlots >> 4) * 80 : sizeof(std::uint32_t) * Header->NumSlots);
+		std::uint64_t KeyStart = ((std::uint64_t)PackedOrderedHashUtil::SnapshotHeaderSize + (std::uint64_t)sizeof(PackedOrderedHashNode<T, InlineKeys>) * Header->NextNodePos + IndexSize + 7) & ~(std::uint64_t)7;
+		if (KeyStart > Size || Header->KeyDataSize > Size - KeyStart)  return false;
+
+		InternalFreeNodes();
+
+		if (KeyArena != NULL)  KeyArena->Empty();
+
+		std::uint8_t *Data2 = (std::uint8_t *)(std::uintptr_t)Data;
+
+		ArrayNodes = (PackedOrderedHashNode<T, InlineKeys> *)(Data2 + PackedOrderedHashUtil::SnapshotHeaderSize);
+		UseProbeIndex = Probe;
+		HashNodes = (UseProbeIndex ? NULL : (std::uint32_t *)(ArrayNodes + Header->NextNodePos));
+		CtrlBytes = (UseProbeIndex ? (std::uint8_t *)(ArrayNodes + Header->NextNodePos) : NULL);
+		MappedSnapshot = true;
+		NextNodePos = (size_t)Header->NextNodePos;
+		NumUsed = (size_t)Header->NumUsed;
+		NumDeletedSlots = (size_t)Header->NumDeletedSlots;
+
+		InternalSetSize((size_t)Header->NumNodes, (size_t)Header->NumSlots);
+
+		CompactStartPos = 0;
+		Compacting = false;
+
+		return true;
 	}
 
-	PackedOrderedHashNode<T> *InternalFind(const std::int64_t IntKey, size_t &Pos, std::uint64_t HashKey)
+	// Whether the nodes are still in a snapshot from LoadSnapshot().
+	inline bool IsMappedSnapshot() { return MappedSnapshot; }
+
+private:
+	PackedOrderedHashNode<T, InlineKeys> *InternalFind(const std::int64_t IntKey, size_t &Pos, std::uint64_t HashKey)
 	{
+		if (CtrlBytes != NULL)
+		{
+			std::uint32_t Matches;
+			std::uint64_t ProbeKey = PackedOrderedHashUtil::MixProbeHashKey(HashKey);
+			std::uint8_t Tag = (std::uint8_t)(ProbeKey & 0x7F);
+			size_t Group = (size_t)(ProbeKey >> 7) & Mask, Step = 0;
+
+			for (;;)
+			{
+				const std::uint8_t *GroupBytes = CtrlBytes + Group * 80;
+
+				for (Matches = PackedOrderedHashUtil::MatchGroup(GroupBytes, Tag); Matches; Matches &= Matches - 1)
+				{
+					Pos = ((const std::uint32_t *)(GroupBytes + 16))[PackedOrderedHashUtil::GetFirstBit(Matches)];
+					if (ArrayNodes[Pos].IntKey == IntKey && ArrayNodes[Pos].GetKeyType() == 0xFF)  return ArrayNodes + Pos;
+				}
+
+				// Probe sequences end at the first group with an empty slot.
+				if (PackedOrderedHashUtil::MatchGroup(GroupBytes, 0x80))  break;
+
+				Step++;
+				Group = (Group + Step) & Mask;
+			}
+
+			Pos = 0xFFFFFFFF;
+
+			return NULL;
+		}
+
 		Pos = HashNodes[(std::uint32_t)HashKey & Mask];
 		while (Pos != 0xFFFFFFFF)
 		{
-			if (ArrayNodes[Pos].IntKey == IntKey && ArrayNodes[Pos].StrKey == NULL)  return ArrayNodes + Pos;
+			if (ArrayNodes[Pos].IntKey == IntKey && ArrayNodes[Pos].GetKeyType() == 0xFF)  return ArrayNodes + Pos;
 
 			Pos = ArrayNodes[Pos].NextHashIndex;
 		}
@@ -458,13 +718,43 @@ private:
 		return NULL;
 	}
 
-	PackedOrderedHashNode<T> *InternalFind(const char *StrKey, const size_t StrLen, size_t &Pos, std::uint64_t HashKey)
+	PackedOrderedHashNode<T, InlineKeys> *InternalFind(const char *StrKey, const size_t StrLen, size_t &Pos, std::uint64_t HashKey)
 	{
 		std::int64_t IntKey = (std::int64_t)HashKey;
+
+		if (CtrlBytes != NULL)
+		{
+			std::uint32_t Matches;
+			std::uint64_t ProbeKey = PackedOrderedHashUtil::MixProbeHashKey(HashKey);
+			std::uint8_t Tag = (std::uint8_t)(ProbeKey & 0x7F);
+			size_t Group = (size_t)(ProbeKey >> 7) & Mask, Step = 0;
+
+			for (;;)
+			{
+				const std::uint8_t *GroupBytes = CtrlBytes + Group * 80;
+
+				for (Matches = PackedOrderedHashUtil::MatchGroup(GroupBytes, Tag); Matches; Matches &= Matches - 1)
+				{
+					Pos = ((const std::uint32_t *)(GroupBytes + 16))[PackedOrderedHashUtil::GetFirstBit(Matches)];
+					if (ArrayNodes[Pos].IntKey == IntKey && ArrayNodes[Pos].MatchStrKey(StrKey, StrLen))  return ArrayNodes + Pos;
+				}
+
+				// Probe sequences end at the first group with an empty slot.
+				if (PackedOrderedHashUtil::MatchGroup(GroupBytes, 0x80))  break;
+
+				Step++;
+				Group = (Group + Step) & Mask;
+			}
+
+			Pos = 0xFFFFFFFF;
+
+			return NULL;
+		}
+
 		Pos = HashNodes[(std::uint32_t)HashKey & Mask];
 		while (Pos != 0xFFFFFFFF)
 		{
-			if (ArrayNodes[Pos].IntKey == IntKey && ArrayNodes[Pos].StrKey != NULL && StrLen == ArrayNodes[Pos].GetStrLen() && !memcmp(StrKey, ArrayNodes[Pos].StrKey, StrLen))  return ArrayNodes + Pos;
+			if (ArrayNodes[Pos].IntKey == IntKey && ArrayNodes[Pos].MatchStrKey(StrKey, StrLen))  return ArrayNodes + Pos;
 
 			Pos = ArrayNodes[Pos].NextHashIndex;
 		}
@@ -472,68 +762,402 @@ private:
 		return NULL;
 	}
 
+	PackedOrderedHashNode<T, InlineKeys> *InternalSet(const std::int64_t IntKey, std::uint64_t HashKey)
+	{
+		// Set() returns nodes that can be changed.
+		if (MappedSnapshot)  InternalCopySnapshot();
+
+		size_t Pos;
+		PackedOrderedHashNode<T, InlineKeys> *Node = InternalFind(IntKey, Pos, HashKey);
+
+		if (Node != NULL)  return Node;
+
+		// Create a new node.
+		if (CompactStepSize)  InternalAutoCompact();
+		if (NextNodePos == NumNodes)  AutoResizeHash();
+		if (NextNodePos == NumNodes)  return NULL;
+
+		Node = ArrayNodes + NextNodePos;
+		new (&Node->Value) T;
+		Pos = NextNodePos;
+		NextNodePos++;
+
+		InternalAttach(Node, (std::uint32_t)Pos, HashKey);
+
+		Node->IntKey = IntKey;
+		Node->SetIntKeyType();
+
+		NumUsed++;
+
+		return Node;
+	}
+
+	PackedOrderedHashNode<T, InlineKeys> *InternalSet(const char *StrKey, const size_t StrLen, std::uint64_t HashKey)
+	{
+		// Set() returns nodes that can be changed.
+		if (MappedSnapshot)  InternalCopySnapshot();
+
+		size_t Pos;
+		PackedOrderedHashNode<T, InlineKeys> *Node = InternalFind(StrKey, StrLen, Pos, HashKey);
+
+		if (Node != NULL)  return Node;
+
+		// Create a new node.
+		if (CompactStepSize)  InternalAutoCompact();
+		if (NextNodePos == NumNodes)  AutoResizeHash();
+		if (NextNodePos == NumNodes)  return NULL;
+
+		Node = ArrayNodes + NextNodePos;
+		Pos = NextNodePos;
+		new (&Node->Value) T;
+		NextNodePos++;
+
+		InternalAttach(Node, (std::uint32_t)Pos, HashKey);
+
+		Node->IntKey = (std::int64_t)HashKey;
+		Node->SetStrKey(StrKey, StrLen, KeyArena);
+
+		NumUsed++;
+
+		return Node;
+	}
+
+	// Prefetches the index entry of a hash key.  A probe index group spans up to two cache lines.  ProbeKey is the mixed hash key.
+	inline void InternalPrefetchIndex(std::uint64_t HashKey, std::uint64_t ProbeKey)
+	{
+		if (CtrlBytes == NULL)  PackedOrderedHashUtil::Prefetch(HashNodes + ((std::uint32_t)HashKey & Mask));
+		else
+		{
+			const std::uint8_t *GroupBytes = CtrlBytes + ((size_t)(ProbeKey >> 7) & Mask) * 80;
+
+			PackedOrderedHashUtil::Prefetch(GroupBytes);
+			PackedOrderedHashUtil::Prefetch(GroupBytes + 79);
+		}
+	}
+
+	// Prefetches the first candidate node of a hash key.  Only reads the index entry, which should already be in the cache.
+	inline void InternalPrefetchNode(std::uint64_t HashKey, std::uint64_t ProbeKey)
+	{
+		std::uint32_t Pos;
+
+		if (CtrlBytes == NULL)  Pos = HashNodes[(std::uint32_t)HashKey & Mask];
+		else
+		{
+			const std::uint8_t *GroupBytes = CtrlBytes + ((size_t)(ProbeKey >> 7) & Mask) * 80;
+			std::uint32_t Matches = PackedOrderedHashUtil::MatchGroup(GroupBytes, (std::uint8_t)(ProbeKey & 0x7F));
+
+			Pos = (Matches ? ((const std::uint32_t *)(GroupBytes + 16))[PackedOrderedHashUtil::GetFirstBit(Matches)] : 0xFFFFFFFF);
+		}
+
+		if (Pos != 0xFFFFFFFF)  PackedOrderedHashUtil::Prefetch(ArrayNodes + Pos);
+	}
+
+	// Three stage pipeline for FindBatch() and SetBatch().  Key x is hashed and its index entry prefetched, key x - BatchDist has its node prefetched,
+	// and key x - 2 * BatchDist is looked up (Values == NULL) or set.  String keys are used when IntKeys is NULL.
+	size_t InternalBatch(const std::int64_t *IntKeys, const char *const *StrKeys, const size_t *StrLens, size_t NumKeys, PackedOrderedHashNode<T, InlineKeys> **Results, const T *Values)
+	{
+		const size_t BatchDist = 8;
+		std::uint64_t HashKeys[32], ProbeKeys[32];
+		size_t x, y, Pos, Result = 0;
+		PackedOrderedHashNode<T, InlineKeys> *Node;
+
+		for (x = 0; x < NumKeys + BatchDist * 2; x++)
+		{
+			if (x < NumKeys)
+			{
+				HashKeys[x & 31] = (IntKeys != NULL ? Policy.GetIntHashKey(IntKeys[x]) : Policy.GetHashKey((const std::uint8_t *)StrKeys[x], StrLens[x]));
+
+				ProbeKeys[x & 31] = PackedOrderedHashUtil::MixProbeHashKey(HashKeys[x & 31]);
+
+				InternalPrefetchIndex(HashKeys[x & 31], ProbeKeys[x & 31]);
+			}
+
+			if (x >= BatchDist && x - BatchDist < NumKeys)  InternalPrefetchNode(HashKeys[(x - BatchDist) & 31], ProbeKeys[(x - BatchDist) & 31]);
+
+			if (x >= BatchDist * 2)
+			{
+				y = x - BatchDist * 2;
+
+				if (Values != NULL)
+				{
+					Node = (IntKeys != NULL ? InternalSet(IntKeys[y], HashKeys[y & 31]) : InternalSet(StrKeys[y], StrLens[y], HashKeys[y & 31]));
+					if (Node != NULL)  Node->Value = Values[y];
+				}
+				else
+				{
+					Node = (IntKeys != NULL ? InternalFind(IntKeys[y], Pos, HashKeys[y & 31]) : InternalFind(StrKeys[y], StrLens[y], Pos, HashKeys[y & 31]));
+					Results[y] = Node;
+				}
+
+				if (Node != NULL)  Result++;
+			}
+		}
+
+		return Result;
+	}
+
+	// Each group of the probe index is 16 control bytes followed by the positions of the nodes in those 16 slots.
+	// A tag match is usually resolved without touching another cache line.
+	inline std::uint32_t *GetGroupNodes(size_t Group)
+	{
+		return (std::uint32_t *)(CtrlBytes + Group * 80 + 16);
+	}
+
+	// Attaches the node at Pos to the index.
+	void InternalAttach(PackedOrderedHashNode<T, InlineKeys> *Node, std::uint32_t Pos, std::uint64_t HashKey)
+	{
+		if (CtrlBytes != NULL)
+		{
+			// Take the first empty (0x80) or deleted (0xFE) slot in the probe sequence.  PrevHashIndex is the slot.
+			std::uint32_t Matches;
+			std::uint64_t ProbeKey = PackedOrderedHashUtil::MixProbeHashKey(HashKey);
+			size_t Group = (size_t)(ProbeKey >> 7) & Mask, Step = 0;
+
+			while (!(Matches = PackedOrderedHashUtil::MatchEmptyOrDeleted(CtrlBytes + Group * 80)))
+			{
+				Step++;
+				Group = (Group + Step) & Mask;
+			}
+
+			size_t x = PackedOrderedHashUtil::GetFirstBit(Matches);
+			if (CtrlBytes[Group * 80 + x] == 0xFE)  NumDeletedSlots--;
+			CtrlBytes[Group * 80 + x] = (std::uint8_t)(ProbeKey & 0x7F);
+			GetGroupNodes(Group)[x] = Pos;
+
+			Node->PrevHashIndex = (std::uint32_t)((Group << 4) + x);
+			Node->NextHashIndex = 0xFFFFFFFF;
+		}
+		else
+		{
+			// Attach the node to the start of the hash list.
+			std::uint32_t HashPos = (std::uint32_t)HashKey & Mask;
+			Node->PrevHashIndex = 0x80000000 | HashPos;
+			Node->NextHashIndex = HashNodes[HashPos];
+			if (Node->NextHashIndex != 0xFFFFFFFF)  ArrayNodes[Node->NextHashIndex].PrevHashIndex = Pos;
+			HashNodes[HashPos] = Pos;
+		}
+	}
+
+	// Points the index at the node's new position after the node was moved to Pos.
+	inline void InternalUpdateIndex(PackedOrderedHashNode<T, InlineKeys> *Node, std::uint32_t Pos)
+	{
+		if (CtrlBytes != NULL)  GetGroupNodes(Node->PrevHashIndex >> 4)[Node->PrevHashIndex & 15] = Pos;
+		else
+		{
+			if (Node->PrevHashIndex & 0x80000000)  HashNodes[Node->PrevHashIndex & 0x7FFFFFFF] = Pos;
+			else  ArrayNodes[Node->PrevHashIndex].NextHashIndex = Pos;
+
+			if (Node->NextHashIndex != 0xFFFFFFFF)  ArrayNodes[Node->NextHashIndex].PrevHashIndex = Pos;
+		}
+	}
+
+	// Each pass moves every node after the first unset node.  Passes start as late as possible (with a 2x margin) so that they are rare but still finish before the array fills up.
+	inline void InternalAutoCompact()
+	{
+		if (Compacting || (NextNodePos - NumUsed > (NumNodes >> 4) && (NumNodes - NextNodePos) * CompactStepSize < (NextNodePos - CompactStartPos) * 2))  CompactStep(CompactStepSize);
+	}
+
+	// Clears the index and attaches every node in use to it.
+	void InternalRebuildIndex()
+	{
+		NumDeletedSlots = 0;
+
+		if (CtrlBytes == NULL)  memset(HashNodes, 0xFF, sizeof(std::uint32_t) * NumSlots);
+		else
+		{
+			for (size_t x = 0; x < NumSlots; x += 16)  memset(CtrlBytes + x * 5, 0x80, 16);
+		}
+
+		PackedOrderedHashNode<T, InlineKeys> *Node = ArrayNodes;
+		for (size_t x = 0; x < NextNodePos; x++)
+		{
+			if (Node->PrevHashIndex != 0xFFFFFFFF)  InternalAttach(Node, (std::uint32_t)x, (Node->GetKeyType() != 0xFF ? (std::uint64_t)Node->IntKey : Policy.GetIntHashKey(Node->IntKey)));
+
+			Node++;
+		}
+	}
+
 	bool InternalResizeHash(size_t NewHashSize)
 	{
 		while (NewHashSize < NumUsed)  NewHashSize <<= 1;
+		if (NewHashSize > GetMaxHashSize(UseProbeIndex))  NewHashSize = GetMaxHashSize(UseProbeIndex);
 		if (NewHashSize == NumNodes || (NewHashSize < 512 && NewHashSize < NumNodes))  return false;
 
-		PackedOrderedHashNode<T> *ArrayNodes2 = (PackedOrderedHashNode<T> *)(new char[sizeof(PackedOrderedHashNode<T>) * NewHashSize + sizeof(std::uint32_t) * NewHashSize]);
-		std::uint32_t *HashNodes2 = (std::uint32_t *)(ArrayNodes2 + NewHashSize);
+		return InternalRebuildHash(NewHashSize);
+	}
 
-		memset(HashNodes2, 0xFF, sizeof(std::uint32_t) * NewHashSize);
+	bool InternalRebuildHash(size_t NewHashSize)
+	{
+		size_t NewNumSlots = InternalGetNumSlots(UseProbeIndex, NewHashSize);
+
+		if (MappedSnapshot)  InternalCopySnapshot();
+
+		PackedOrderedHashNode<T, InlineKeys> *ArrayNodes2 = (PackedOrderedHashNode<T, InlineKeys> *)(new char[sizeof(PackedOrderedHashNode<T, InlineKeys>) * NewHashSize + (UseProbeIndex ? (NewNumSlots >> 4) * 80 : sizeof(std::uint32_t) * NewNumSlots)]);
 
 		if (ArrayNodes != NULL)
 		{
-			std::uint64_t HashKey;
-			std::uint32_t HashPos, Mask2, x = 0;
-			PackedOrderedHashNode<T> *Node = ArrayNodes, *Node2 = ArrayNodes2, *LastNode = ArrayNodes + NextNodePos;
-			Mask2 = (std::uint32_t)(NewHashSize - 1);
+			PackedOrderedHashNode<T, InlineKeys> *Node = ArrayNodes, *Node2 = ArrayNodes2, *LastNode = ArrayNodes + NextNodePos;
 			while (Node != LastNode)
 			{
 				if (Node->PrevHashIndex != 0xFFFFFFFF)
 				{
 					// Raw copy node.
-					memcpy(Node2, Node, sizeof(PackedOrderedHashNode<T>));
-
-					HashKey = (Node2->StrKey != NULL ? (std::uint64_t)Node2->IntKey : GetHashKey((const std::uint8_t *)&Node2->IntKey, sizeof(std::int64_t)));
-
-					// Attach the node to the start of the hash list.
-					HashPos = (std::uint32_t)HashKey & Mask2;
-					Node2->PrevHashIndex = 0x80000000 | HashPos;
-					Node2->NextHashIndex = HashNodes2[HashPos];
-					if (Node2->NextHashIndex != 0xFFFFFFFF)  ArrayNodes2[Node2->NextHashIndex].PrevHashIndex = x;
-					HashNodes2[HashPos] = x;
+					memcpy(Node2, Node, sizeof(PackedOrderedHashNode<T, InlineKeys>));
 
 					Node2++;
-					x++;
 				}
 
 				Node++;
 			}
+
+			delete[] (char *)ArrayNodes;
 		}
 
 		ArrayNodes = ArrayNodes2;
-		HashNodes = HashNodes2;
-		NumNodes = NewHashSize;
-		Mask = (std::uint32_t)(NumNodes - 1);
+		HashNodes = (UseProbeIndex ? NULL : (std::uint32_t *)(ArrayNodes2 + NewHashSize));
+		CtrlBytes = (UseProbeIndex ? (std::uint8_t *)(ArrayNodes2 + NewHashSize) : NULL);
 		NextNodePos = NumUsed;
 
+		InternalSetSize(NewHashSize, NewNumSlots);
+
+		CompactStartPos = NextNodePos;
+		Compacting = false;
+
+		InternalRebuildIndex();
+
+		return true;
+	}
+
+	// The probe index has at least twice as many slots as there are nodes so every probe sequence ends at an empty slot.
+	// There are at most 2^30 hash chains so that the chain marker in PrevHashIndex (0x80000000 | chain) never equals the unset marker.
+	static inline size_t InternalGetNumSlots(bool Probe, size_t NewHashSize)
+	{
+		if (Probe)  return (NewHashSize < 8 ? 16 : NewHashSize << 1);
+
+		return (NewHashSize > ((size_t)1 << 30) ? ((size_t)1 << 30) : NewHashSize);
+	}
+
+	// Sets the size of the array and index and the sizes that trigger automatic resizing and compaction.
+	void InternalSetSize(size_t NewHashSize, size_t NewNumSlots)
+	{
+		NumNodes = NewHashSize;
+		NumSlots = NewNumSlots;
+		Mask = (std::uint32_t)(UseProbeIndex ? (NumSlots >> 4) - 1 : NumSlots - 1);
+
 		CompactNumUsed50 = (NumNodes >> 1);
 		CompactNextNodePos75 = NumNodes - (NumNodes >> 3);
 		CompactNumUsed90 = NumNodes - (NumNodes / 10);
 		ResizeNumUsed40 = (size_t)((std::uint64_t)(NumNodes << 3) / 10);
+	}
+
+	inline size_t InternalGetIndexSize()
+	{
+		return (CtrlBytes != NULL ? (NumSlots >> 4) * 80 : sizeof(std::uint32_t) * NumSlots);
+	}
+
+	// Destroys the nodes in use and frees the array.  A loaded snapshot isn't owned by the hash.
+	void InternalFreeNodes()
+	{
+		if (MappedSnapshot)  MappedSnapshot = false;
+		else
+		{
+			PackedOrderedHashNode<T, InlineKeys> *Node = ArrayNodes, *LastNode = ArrayNodes + NextNodePos;
+			while (Node != LastNode)
+			{
+				if (Node->PrevHashIndex != 0xFFFFFFFF)
+				{
+					Node->Value.~T();
+
+					Node->FreeStrKey();
+				}
+
+				Node++;
+			}
+
+			delete[] (char *)ArrayNodes;
+		}
+
+		ArrayNodes = NULL;
+	}
+
+	// Copies a loaded snapshot into a new array.  Long string keys are copied out of the snapshot into new[] or the key arena.
+	void InternalCopySnapshot()
+	{
+		size_t IndexSize = InternalGetIndexSize();
+		PackedOrderedHashNode<T, InlineKeys> *ArrayNodes2 = (PackedOrderedHashNode<T, InlineKeys> *)(new char[sizeof(PackedOrderedHashNode<T, InlineKeys>) * NumNodes + IndexSize]);
+		PackedOrderedHashNode<T, InlineKeys> *Node = ArrayNodes, *Node2 = ArrayNodes2, *LastNode = ArrayNodes + NextNodePos;
+
+		while (Node != LastNode)
+		{
+			Node2->PrevHashIndex = Node->PrevHashIndex;
+			Node2->NextHashIndex = Node->NextHashIndex;
+			Node2->CopyKey(*Node, KeyArena);
+
+			if (Node->PrevHashIndex != 0xFFFFFFFF)
+			{
+				new (&Node2->Value) T(Node->Value);
+			}
+
+			Node++;
+			Node2++;
+		}
+
+		memcpy(ArrayNodes2 + NumNodes, (CtrlBytes != NULL ? (const void *)CtrlBytes : (const void *)HashNodes), IndexSize);
+
+		ArrayNodes = ArrayNodes2;
+		HashNodes = (UseProbeIndex ? NULL : (std::uint32_t *)(ArrayNodes2 + NumNodes));
+		CtrlBytes = (UseProbeIndex ? (std::uint8_t *)(ArrayNodes2 + NumNodes) : NULL);
+		MappedSnapshot = false;
+	}
+
+	// Snapshots only work with the same hash policy and keys.
+	inline std::uint64_t InternalGetSnapshotHashCheck()
+	{
+		return Policy.GetHashKey((const std::uint8_t *)"PackedOrderedHash", 17) ^ Policy.GetIntHashKey(17);
+	}
+
+	// Appends Size bytes to Buffer.  Writes out the buffer when it is full or Data is NULL.  Data that doesn't fit in the buffer is written directly.
+	template <class FileType>
+	static bool InternalSnapshotWrite(FileType &File, std::uint8_t *Buffer, size_t &BufferPos, size_t BufferSize, const void *Data, size_t Size)
+	{
+		size_t y;
+
+		if (Data == NULL || BufferPos + Size > BufferSize)
+		{
+			if (BufferPos && (!File.Write(Buffer, BufferPos, y) || y != BufferPos))  return false;
+
+			BufferPos = 0;
+		}
+
+		if (Data == NULL)  return true;
+
+		if (Size > BufferSize)  return (File.Write((const std::uint8_t *)Data, Size, y) && y == Size);
+
+		memcpy(Buffer + BufferPos, Data, Size);
+		BufferPos += Size;
 
 		return true;
 	}
 
-	bool UseSipHash;
-	std::uint64_t Key1, Key2;
+	HashPolicy Policy;
+	ChunkArena *KeyArena;
 
-	PackedOrderedHashNode<T> *ArrayNodes;
+	// HashNodes holds the first node of each hash chain.  CtrlBytes holds the groups of the probe index.  Only one of them is used at a time.
+	PackedOrderedHashNode<T, InlineKeys> *ArrayNodes;
 	std::uint32_t *HashNodes;
+	std::uint8_t *CtrlBytes;
+	bool UseProbeIndex;
+
+	// Whether ArrayNodes points at a snapshot from LoadSnapshot() instead of memory owned by the hash.
+	bool MappedSnapshot;
 
+	// Mask selects a hash chain or, with the probe index, a group of 16 slots.
 	std::uint32_t Mask;
-	size_t NumNodes, NextNodePos, NumUsed;
+	size_t NumNodes, NumSlots, NextNodePos, NumUsed;
 	size_t CompactNumUsed50, CompactNextNodePos75;
 	size_t CompactNumUsed90, ResizeNumUsed40;
+
+	// Incremental compaction state.  See CompactStep().
+	size_t NumDeletedSlots, CompactStartPos, CompactDestPos, CompactSrcPos, CompactStepSize;
+	bool Compacting;
 };
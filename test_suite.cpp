@@ -15,17 +15,24 @@
 
 #include "convert/convert_int.h"
 #include "security/security_csprng.h"
+#include "sync/sync_concurrentorderedhash.h"
 #include "sync/sync_event.h"
 #include "sync/sync_mutex.h"
 #include "sync/sync_readwritelock.h"
+#include "sync/sync_ringbuffer.h"
+#include "sync/sync_seqlock.h"
 #include "sync/sync_semaphore.h"
 #include "sync/sync_sharedmem.h"
+#include "sync/sync_threadpool.h"
 #include "sync/sync_tls.h"
 #include "sync/sync_util.h"
+#include "sync/sync_waitmultiple.h"
 #include "templates/cache.h"
+#include "templates/chunk_arena.h"
 #include "templates/detachable_list.h"
 #include "templates/detachable_ordered_hash.h"
 #include "templates/detachable_queue.h"
+#include "templates/detachable_concurrent_queue.h"
 #include "templates/static_vector.h"
 #include "templates/static_2d_array.h"
 #include "templates/static_mixed_var.h"
@@ -47,7 +54,9 @@ CubicleSoft::Sync::Event GxSyncEvent;
 CubicleSoft::Sync::Mutex GxSyncMutex;
 CubicleSoft::Sync::Semaphore GxSyncSemaphore;
 CubicleSoft::Sync::ReadWriteLock GxSyncReadWriteLock;
+CubicleSoft::Sync::SeqLock GxSyncSeqLock;
 CubicleSoft::Sync::SharedMem GxSyncSharedMem;
+CubicleSoft::Sync::ThreadPool GxSyncThreadPool;
 CubicleSoft::Sync::TLS GxSyncTLS;
 CubicleSoft::Sync::TLS::MixedVar GxSyncTLSMixedVar;
 CubicleSoft::Cache<int, int> GxCache(11);
@@ -68,6 +77,40 @@ CubicleSoft::JSON::Serializer GxJSONSerializer;
 //CubicleSoft::Network::AsyncHelper GxAsyncHelper;
 //CubicleSoft::Network::Server GxServer;
 
+// Minimal cross-platform thread support for multithreaded tests.
+#if defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(WIN64)
+typedef HANDLE TestThreadType;
+#define TEST_THREAD_FUNC(Name)   DWORD WINAPI Name(LPVOID Data)
+#define TEST_THREAD_RETURN()   return 0
+
+bool Test_StartThread(TestThreadType &Result, LPTHREAD_START_ROUTINE Func, void *Data)
+{
+	Result = ::CreateThread(NULL, 0, Func, Data, 0, NULL);
+
+	return (Result != NULL);
+}
+
+void Test_JoinThread(TestThreadType &Thread)
+{
+	::WaitForSingleObject(Thread, INFINITE);
+	::CloseHandle(Thread);
+}
+#else
+typedef pthread_t TestThreadType;
+#define TEST_THREAD_FUNC(Name)   void *Name(void *Data)
+#define TEST_THREAD_RETURN()   return NULL
+
+bool Test_StartThread(TestThreadType &Result, void *(*Func)(void *), void *Data)
+{
+	return (pthread_create(&Result, NULL, Func, Data) == 0);
+}
+
+void Test_JoinThread(TestThreadType &Thread)
+{
+	pthread_join(Thread, NULL);
+}
+#endif
+
 int Test_Convert_Int(FILE *Testfp)
 {
 	TEST_START(Test_Convert_Int);
@@ -193,6 +236,13 @@ int Test_Security_CSPRNG(FILE *Testfp)
 	TEST_RETURN();
 }
 
+TEST_THREAD_FUNC(Test_Sync_Event_FireThread)
+{
+	((CubicleSoft::Sync::Event *)Data)->Fire();
+
+	TEST_THREAD_RETURN();
+}
+
 int Test_Sync_Event(FILE *Testfp)
 {
 	TEST_START(Test_Sync_Event);
@@ -216,6 +266,30 @@ int Test_Sync_Event(FILE *Testfp)
 	x = TestEvent.Wait(0);
 	TEST_COMPARE(x, 0);
 
+	x = TestEvent.Wait(10);
+	TEST_COMPARE(x, 0);
+
+	// Sub-millisecond timeout measured with the monotonic clock.
+	std::uint64_t StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+	x = TestEvent.WaitNS(500000);
+	TEST_COMPARE(x, 0);
+
+	x = (CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime >= 500000);
+	TEST_COMPARE(x, 1);
+
+	// Fired by another thread.
+	TestThreadType Thread;
+	x = Test_StartThread(Thread, Test_Sync_Event_FireThread, &TestEvent);
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		x = TestEvent.Wait(5000);
+		TEST_COMPARE(x, 1);
+
+		Test_JoinThread(Thread);
+	}
+
 
 	// Named, automatic event.
 	x = TestEvent.Create("test_suite");
@@ -284,6 +358,22 @@ int Test_Sync_Event(FILE *Testfp)
 	TEST_RETURN();
 }
 
+volatile std::uint32_t Test_Sync_Mutex_Counter;
+
+TEST_THREAD_FUNC(Test_Sync_Mutex_Thread)
+{
+	CubicleSoft::Sync::Mutex *TestMutex = (CubicleSoft::Sync::Mutex *)Data;
+
+	for (size_t x = 0; x < 100000; x++)
+	{
+		TestMutex->Lock();
+		Test_Sync_Mutex_Counter = Test_Sync_Mutex_Counter + 1;
+		TestMutex->Unlock();
+	}
+
+	TEST_THREAD_RETURN();
+}
+
 int Test_Sync_Mutex(FILE *Testfp)
 {
 	TEST_START(Test_Sync_Mutex);
@@ -320,6 +410,18 @@ int Test_Sync_Mutex(FILE *Testfp)
 	x = TestMutex.Unlock();
 	TEST_COMPARE(x, 0);
 
+	// Contention.
+	TestThreadType Thread;
+	Test_Sync_Mutex_Counter = 0;
+	x = Test_StartThread(Thread, Test_Sync_Mutex_Thread, &TestMutex);
+	TEST_COMPARE(x, 1);
+
+	Test_Sync_Mutex_Thread(&TestMutex);
+	if (x)  Test_JoinThread(Thread);
+
+	x = (Test_Sync_Mutex_Counter == 200000);
+	TEST_COMPARE(x, 1);
+
 
 	// Named mutex.
 	x = TestMutex.Create("test_suite");
@@ -377,6 +479,9 @@ int Test_Sync_Semaphore(FILE *Testfp)
 	x = TestSemaphore.Lock(0);
 	TEST_COMPARE(x, 0);
 
+	x = TestSemaphore.LockNS(250000);
+	TEST_COMPARE(x, 0);
+
 	{
 		CubicleSoft::Sync::Semaphore::AutoUnlock TempLock(&TestSemaphore);
 	}
@@ -417,6 +522,88 @@ int Test_Sync_Semaphore(FILE *Testfp)
 	TEST_RETURN();
 }
 
+class Test_Sync_ReadWriteLock_BenchInfo
+{
+public:
+	CubicleSoft::Sync::ReadWriteLock *MxLock;
+	time_t MxEndTime;
+	std::uint64_t MxCount;
+};
+
+TEST_THREAD_FUNC(Test_Sync_ReadWriteLock_BenchThread)
+{
+	Test_Sync_ReadWriteLock_BenchInfo *Info = (Test_Sync_ReadWriteLock_BenchInfo *)Data;
+
+	do
+	{
+		for (size_t x = 0; x < 1024; x++)
+		{
+			Info->MxLock->ReadLock();
+			Info->MxLock->ReadUnlock();
+		}
+
+		Info->MxCount += 1024;
+	} while (time(NULL) < Info->MxEndTime);
+
+	TEST_THREAD_RETURN();
+}
+
+volatile std::uint32_t Test_Sync_ReadWriteLock_Value;
+
+TEST_THREAD_FUNC(Test_Sync_ReadWriteLock_WriterThread)
+{
+	CubicleSoft::Sync::ReadWriteLock *TestReadWrite = (CubicleSoft::Sync::ReadWriteLock *)Data;
+
+	for (size_t x = 0; x < 10000; x++)
+	{
+		TestReadWrite->WriteLock();
+		Test_Sync_ReadWriteLock_Value = Test_Sync_ReadWriteLock_Value + 1;
+		Test_Sync_ReadWriteLock_Value = Test_Sync_ReadWriteLock_Value + 1;
+		TestReadWrite->WriteUnlock();
+	}
+
+	TEST_THREAD_RETURN();
+}
+
+// Counts threads inside the lock.  MxViolations counts writers that overlapped with another writer or a reader.
+class Test_Sync_ReadWriteLock_StressInfo
+{
+public:
+	CubicleSoft::Sync::ReadWriteLock *MxLock;
+	volatile std::uint32_t MxReaders, MxWriters, MxViolations;
+};
+
+TEST_THREAD_FUNC(Test_Sync_ReadWriteLock_StressWriterThread)
+{
+	Test_Sync_ReadWriteLock_StressInfo *Info = (Test_Sync_ReadWriteLock_StressInfo *)Data;
+
+	for (size_t x = 0; x < 2000; x++)
+	{
+		Info->MxLock->WriteLock();
+		if (CubicleSoft::Sync::Util::AtomicAdd32(&Info->MxWriters, 1) != 1 || Info->MxReaders)  CubicleSoft::Sync::Util::AtomicAdd32(&Info->MxViolations, 1);
+		CubicleSoft::Sync::Util::AtomicAdd32(&Info->MxWriters, (std::uint32_t)-1);
+		Info->MxLock->WriteUnlock();
+	}
+
+	TEST_THREAD_RETURN();
+}
+
+TEST_THREAD_FUNC(Test_Sync_ReadWriteLock_StressReaderThread)
+{
+	Test_Sync_ReadWriteLock_StressInfo *Info = (Test_Sync_ReadWriteLock_StressInfo *)Data;
+
+	for (size_t x = 0; x < 10000; x++)
+	{
+		Info->MxLock->ReadLock();
+		CubicleSoft::Sync::Util::AtomicAdd32(&Info->MxReaders, 1);
+		if (Info->MxWriters)  CubicleSoft::Sync::Util::AtomicAdd32(&Info->MxViolations, 1);
+		CubicleSoft::Sync::Util::AtomicAdd32(&Info->MxReaders, (std::uint32_t)-1);
+		Info->MxLock->ReadUnlock();
+	}
+
+	TEST_THREAD_RETURN();
+}
+
 int Test_Sync_ReadWriteLock(FILE *Testfp)
 {
 	TEST_START(Test_Sync_ReadWriteLock);
@@ -462,6 +649,49 @@ int Test_Sync_ReadWriteLock(FILE *Testfp)
 		CubicleSoft::Sync::ReadWriteLock::AutoWriteUnlock TempLock(&TestReadWrite);
 	}
 
+	// Readers never see a partial write.
+	TestThreadType Thread;
+	Test_Sync_ReadWriteLock_Value = 0;
+	x = Test_StartThread(Thread, Test_Sync_ReadWriteLock_WriterThread, &TestReadWrite);
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		size_t y, NumOdd = 0;
+		for (y = 0; y < 10000; y++)
+		{
+			TestReadWrite.ReadLock();
+			if (Test_Sync_ReadWriteLock_Value & 1)  NumOdd++;
+			TestReadWrite.ReadUnlock();
+		}
+
+		Test_JoinThread(Thread);
+
+		x = (NumOdd == 0 && Test_Sync_ReadWriteLock_Value == 20000);
+		TEST_COMPARE(x, 1);
+	}
+
+	// Writers exclude readers and each other with several of each.
+	{
+		Test_Sync_ReadWriteLock_StressInfo Info;
+		TestThreadType Threads[5];
+		size_t y;
+
+		Info.MxLock = &TestReadWrite;
+		Info.MxReaders = 0;
+		Info.MxWriters = 0;
+		Info.MxViolations = 0;
+
+		x = true;
+		for (y = 0; y < 5 && x; y++)  x = Test_StartThread(Threads[y], (y < 2 ? Test_Sync_ReadWriteLock_StressWriterThread : Test_Sync_ReadWriteLock_StressReaderThread), &Info);
+		TEST_COMPARE(x, 1);
+
+		while (y)  Test_JoinThread(Threads[--y]);
+
+		x = (Info.MxViolations == 0 && Info.MxReaders == 0 && Info.MxWriters == 0 && TestReadWrite.WriteLock(0) && TestReadWrite.WriteUnlock());
+		TEST_COMPARE(x, 1);
+	}
+
 
 	// Named reader-writer lock.
 	x = TestReadWrite.Create("test_suite");
@@ -506,6 +736,104 @@ int Test_Sync_ReadWriteLock(FILE *Testfp)
 	TEST_RETURN();
 }
 
+TEST_THREAD_FUNC(Test_Sync_SeqLock_WriterThread)
+{
+	CubicleSoft::Sync::SeqLock *TestSeqLock = (CubicleSoft::Sync::SeqLock *)Data;
+	std::uint64_t TempData[2];
+
+	for (std::uint64_t x = 1; x <= 100000; x++)
+	{
+		TempData[0] = x;
+		TempData[1] = x;
+
+		TestSeqLock->Write(TempData);
+	}
+
+	TEST_THREAD_RETURN();
+}
+
+int Test_Sync_SeqLock(FILE *Testfp)
+{
+	TEST_START(Test_Sync_SeqLock);
+
+	CubicleSoft::Sync::SeqLock TestSeqLock;
+	std::uint64_t TempData[2] = { 1, 2 }, TempData2[2];
+	std::uint32_t Seq;
+	bool x;
+
+	// Unnamed sequence lock.
+	x = TestSeqLock.Create(NULL, sizeof(TempData));
+	TEST_COMPARE(x, 1);
+
+	x = TestSeqLock.Write(TempData);
+	TEST_COMPARE(x, 1);
+
+	x = (TestSeqLock.Read(TempData2) && TempData2[0] == 1 && TempData2[1] == 2);
+	TEST_COMPARE(x, 1);
+
+	x = TestSeqLock.WriteLock(0);
+	TEST_COMPARE(x, 1);
+
+	x = TestSeqLock.WriteLock(0);
+	TEST_COMPARE(x, 0);
+
+	x = TestSeqLock.WriteUnlock();
+	TEST_COMPARE(x, 1);
+
+	x = TestSeqLock.WriteUnlock();
+	TEST_COMPARE(x, 0);
+
+	Seq = TestSeqLock.ReadBegin();
+	x = TestSeqLock.ReadRetry(Seq);
+	TEST_COMPARE(x, 0);
+
+	// Readers always see a consistent snapshot.
+	TempData2[0] = 0;
+	TempData2[1] = 0;
+	TestSeqLock.Write(TempData2);
+
+	TestThreadType Thread;
+	x = Test_StartThread(Thread, Test_Sync_SeqLock_WriterThread, &TestSeqLock);
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		size_t y, NumTorn = 0;
+		for (y = 0; y < 100000; y++)
+		{
+			TestSeqLock.Read(TempData2);
+			if (TempData2[0] != TempData2[1])  NumTorn++;
+		}
+
+		Test_JoinThread(Thread);
+
+		x = (NumTorn == 0 && TestSeqLock.Read(TempData2) && TempData2[0] == 100000);
+		TEST_COMPARE(x, 1);
+	}
+
+
+	// Named sequence lock.
+	x = TestSeqLock.Create("test_suite", sizeof(TempData));
+	TEST_COMPARE(x, 1);
+
+	x = TestSeqLock.Write(TempData);
+	TEST_COMPARE(x, 1);
+
+	{
+		CubicleSoft::Sync::SeqLock TestSeqLock2;
+
+		x = TestSeqLock2.Create("test_suite", sizeof(TempData));
+		TEST_COMPARE(x, 1);
+
+		x = (TestSeqLock2.Read(TempData2) && TempData2[0] == 1 && TempData2[1] == 2);
+		TEST_COMPARE(x, 1);
+	}
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
 int Test_Sync_SharedMem(FILE *Testfp)
 {
 	TEST_START(Test_Sync_SharedMem);
@@ -553,232 +881,1695 @@ int Test_Sync_SharedMem(FILE *Testfp)
 	x = (memcmp(TestSharedMem.RawData(), "test", 5) != 0);
 	TEST_COMPARE(x, 1);
 
+	// Options are best effort but only requested options are ever reported.
+	std::uint32_t Options = CubicleSoft::Sync::SharedMem::OptionHugePages | CubicleSoft::Sync::SharedMem::OptionPrefault | CubicleSoft::Sync::SharedMem::OptionLock;
+	x = TestSharedMem.Create("test_suite", 65536, Options);
+	TEST_COMPARE(x, 1);
+
+	x = ((TestSharedMem.GetActiveOptions() & CubicleSoft::Sync::SharedMem::OptionPrefault) && !(TestSharedMem.GetActiveOptions() & ~Options));
+	TEST_COMPARE(x, 1);
+
+	memset(TestSharedMem.RawData(), 0xAA, 65536);
+	x = ((unsigned char)TestSharedMem.RawData()[65535] == 0xAA);
+	TEST_COMPARE(x, 1);
+
 	TEST_SUMMARY();
 
 	TEST_RETURN();
 }
 
-int Test_Templates_Cache(FILE *Testfp)
+TEST_THREAD_FUNC(Test_Sync_RingBuffer_ProducerThread)
 {
-	TEST_START(Test_Templates_Cache);
-
-	CubicleSoft::Cache<size_t, int> TestCache(11);
-	bool x;
-	size_t x2;
-	int y;
+	CubicleSoft::Sync::RingBuffer *TestRingBuffer = (CubicleSoft::Sync::RingBuffer *)Data;
+	std::uint32_t *TempData;
 
-	for (x2 = 0; x2 < 100; x2++)
+	for (std::uint32_t x = 1; x <= 50000; x++)
 	{
-		TestCache.Insert(x2, x2, (int)(x2 + 1));
-	}
-
-	x = TestCache.Exists(99, 99);
-	TEST_COMPARE(x, 1);
-
-	x = TestCache.Remove(99, 99);
-	TEST_COMPARE(x, 1);
+		// Variable length records:  [Value][Value]...
+		while ((TempData = (std::uint32_t *)TestRingBuffer->Reserve((x % 7 + 1) * sizeof(std::uint32_t))) == NULL)  CubicleSoft::Sync::Util::CPUPause();
 
-	x = TestCache.Exists(99, 99);
-	TEST_COMPARE(x, 0);
-
-	x = TestCache.Find(y, 0, 0);
-	TEST_COMPARE(x, 0);
+		for (std::uint32_t y = 0; y <= x % 7; y++)  TempData[y] = x;
 
-	TEST_SUMMARY();
+		TestRingBuffer->Commit(TempData);
+	}
 
-	TEST_RETURN();
+	TEST_THREAD_RETURN();
 }
 
-int Test_Templates_List(FILE *Testfp)
+int Test_Sync_RingBuffer(FILE *Testfp)
 {
-	TEST_START(Test_Templates_List);
+	TEST_START(Test_Sync_RingBuffer);
 
-	CubicleSoft::List<int> TestList, TestList2;
-	CubicleSoft::ListNode<int> *Node;
+	CubicleSoft::Sync::RingBuffer TestRingBuffer;
+	char TempData[64];
+	void *Data;
+	size_t y, Size;
 	bool x;
-	int x2;
 
-	for (x2 = 0; x2 < 100; x2++)  TestList += x2;
+	// Unnamed ring buffer.
+	x = TestRingBuffer.Create(NULL, 1000);
+	TEST_COMPARE(x, 1);
 
-	x = (TestList.GetSize() == 100);
+	x = (TestRingBuffer.GetCapacity() == 1024 && TestRingBuffer.GetMaxRecordSize() == 496);
 	TEST_COMPARE(x, 1);
 
-	while ((Node = TestList.Shift()) != NULL)  TestList2 += Node;
+	x = (TestRingBuffer.Peek(Size) == NULL && Size == 0);
+	TEST_COMPARE(x, 1);
 
-	x = (TestList.GetSize() == 0);
+	x = TestRingBuffer.Wait(0);
+	TEST_COMPARE(x, 0);
+
+	x = (TestRingBuffer.Reserve(497) == NULL);
 	TEST_COMPARE(x, 1);
 
-	x = (TestList2.GetSize() == 100);
+	Data = TestRingBuffer.Reserve(5);
+	x = (Data != NULL && ((size_t)Data % 16) == 0);
 	TEST_COMPARE(x, 1);
 
-	TestList.DetachAllAndAppend(TestList2);
+	// Uncommitted records are not visible.
+	x = (TestRingBuffer.Peek(Size) == NULL);
+	TEST_COMPARE(x, 1);
 
-	x = (TestList.GetSize() == 100);
+	memcpy(Data, "test", 5);
+	x = TestRingBuffer.Commit(Data);
 	TEST_COMPARE(x, 1);
 
-	x = (TestList2.GetSize() == 0);
+	x = TestRingBuffer.Wait(0);
 	TEST_COMPARE(x, 1);
 
-	TEST_SUMMARY();
+	Data = TestRingBuffer.Peek(Size);
+	x = (Data != NULL && Size == 5 && memcmp(Data, "test", 5) == 0);
+	TEST_COMPARE(x, 1);
 
-	TEST_RETURN();
-}
+	x = TestRingBuffer.Release(Data);
+	TEST_COMPARE(x, 1);
 
-int Test_Templates_OrderedHash(FILE *Testfp)
-{
-	TEST_START(Test_Templates_OrderedHash);
+	// Fill the ring.  Each 40 byte record takes 64 bytes and the last one does not fit before the end of the ring.
+	for (y = 0; ; y++)
+	{
+		memset(TempData, (int)y + 1, 40);
+		if (!TestRingBuffer.Write(TempData, 40))  break;
+	}
+	x = (y == 15);
+	TEST_COMPARE(x, 1);
 
-	CubicleSoft::OrderedHash<int> TestHash(47);
-	CubicleSoft::OrderedHashNode<int> *Node, *Nodes = NULL;
-	bool x;
-	int x2;
+	Size = 10;
+	x = (!TestRingBuffer.Read(TempData, Size) && Size == 40);
+	TEST_COMPARE(x, 1);
 
-	for (x2 = 0; x2 < 100; x2++)  TestHash.Push(x2, x2);
-	TestHash.Push("", 1, x2++);
-	TestHash.Push("test", 5, x2++);
+	// Records wrap around the end of the ring.
+	Size = sizeof(TempData);
+	x = (TestRingBuffer.Read(TempData, Size) && Size == 40 && TempData[0] == 1);
+	TEST_COMPARE(x, 1);
 
-	x = (TestHash.GetListSize() == 102);
+	x = TestRingBuffer.Write("wrapped", 8);
 	TEST_COMPARE(x, 1);
 
-	// Test existence.
-	x = true;
-	for (x2 = 0; x2 < 100 && x; x2++)
+	for (y = 2; y < 16; y++)
 	{
-		if (x)  x = (TestHash.Find(x2) != NULL);
+		Size = sizeof(TempData);
+		if (!TestRingBuffer.Read(TempData, Size) || Size != 40 || TempData[0] != (char)y)  break;
 	}
-	if (x)  x = (TestHash.Find("", 1) != NULL);
-	if (x)  x = (TestHash.Find("test", 5) != NULL);
+	x = (y == 16);
 	TEST_COMPARE(x, 1);
 
-	// Test order.
-	x = true;
-	Node = TestHash.FirstList();
-	for (x2 = 0; x2 < 100 && x; x2++)  x = ((Node = Node->NextList()) != NULL);
-	if (x)
-	{
-		x = (Node->GetStrKey() != NULL && Node->GetIntKey() == 1 && Node->Value == x2);
-		Node = Node->NextList();
-		x2++;
-	}
-	if (x)
-	{
-		x = (Node->GetStrKey() != NULL && Node->GetIntKey() == 5 && Node->Value == x2);
-		Node = Node->NextList();
-		x2++;
-	}
+	Size = sizeof(TempData);
+	x = (TestRingBuffer.Read(TempData, Size) && Size == 8 && !strcmp(TempData, "wrapped"));
 	TEST_COMPARE(x, 1);
 
-	while ((Node = TestHash.Shift(false)) != NULL)
+	Size = sizeof(TempData);
+	x = (!TestRingBuffer.Read(TempData, Size) && Size == 0);
+	TEST_COMPARE(x, 1);
+
+	// Records after a pad are size checked too and never truncated.  The 50 byte record takes 80 bytes and doesn't fit in the last 64 bytes of the ring.
+	for (y = 0; y < 2; y++)
 	{
-		Node->NextListNode = Nodes;
-		Nodes = Node;
+		CubicleSoft::Sync::RingBuffer TestRingBuffer2;
+		size_t y2;
+
+		x = TestRingBuffer2.Create(NULL, 1000, (y == 1));
+		for (y2 = 0; x && y2 < 15; y2++)  x = TestRingBuffer2.Write(TempData, 40);
+		for (y2 = 0; x && y2 < 15; y2++)
+		{
+			Size = sizeof(TempData);
+			x = TestRingBuffer2.Read(TempData, Size);
+		}
+		TEST_COMPARE(x, 1);
+
+		memset(TempData, 'x', 50);
+		x = TestRingBuffer2.Write(TempData, 50);
+		TEST_COMPARE(x, 1);
+
+		memset(TempData, 0, sizeof(TempData));
+		Size = 40;
+		x = (!TestRingBuffer2.Read(TempData, Size) && Size == 50 && TempData[0] == 0);
+		TEST_COMPARE(x, 1);
+
+		Size = sizeof(TempData);
+		x = (TestRingBuffer2.Read(TempData, Size) && Size == 50 && TempData[0] == 'x' && TempData[49] == 'x');
+		TEST_COMPARE(x, 1);
 	}
 
-	x = (TestHash.GetListSize() == 0);
+	// Single producer, single consumer across threads.
+	TestThreadType Thread;
+	std::uint32_t *TempData2, NextVal = 1;
+	size_t NumBad = 0;
+
+	x = Test_StartThread(Thread, Test_Sync_RingBuffer_ProducerThread, &TestRingBuffer);
 	TEST_COMPARE(x, 1);
 
-	while (Nodes != NULL)
+	if (x)
 	{
-		Node = Nodes->NextListNode;
-		TestHash.Unshift(Nodes);
-		Nodes = Node;
+		while (NextVal <= 50000 && TestRingBuffer.Wait(10000))
+		{
+			while ((TempData2 = (std::uint32_t *)TestRingBuffer.Peek(Size)) != NULL)
+			{
+				if (Size != (NextVal % 7 + 1) * sizeof(std::uint32_t) || TempData2[0] != NextVal || TempData2[NextVal % 7] != NextVal)  NumBad++;
+
+				TestRingBuffer.Release(TempData2);
+				NextVal++;
+			}
+		}
+
+		Test_JoinThread(Thread);
+
+		x = (NextVal == 50001 && NumBad == 0);
+		TEST_COMPARE(x, 1);
 	}
 
-	x = (TestHash.GetListSize() == 102);
+	// Multiple producers, multiple consumers.
+	x = TestRingBuffer.Create(NULL, 4096, true);
+	TEST_COMPARE(x, 1);
+
+	TestThreadType Thread2;
+	std::uint64_t Total = 0;
+
+	x = Test_StartThread(Thread, Test_Sync_RingBuffer_ProducerThread, &TestRingBuffer);
+	TEST_COMPARE(x, 1);
+
+	x = Test_StartThread(Thread2, Test_Sync_RingBuffer_ProducerThread, &TestRingBuffer);
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		NumBad = 0;
+		for (y = 0; y < 100000 && TestRingBuffer.Wait(10000); )
+		{
+			while ((TempData2 = (std::uint32_t *)TestRingBuffer.Peek(Size)) != NULL)
+			{
+				if (Size != (TempData2[0] % 7 + 1) * sizeof(std::uint32_t) || TempData2[TempData2[0] % 7] != TempData2[0])  NumBad++;
+				Total += TempData2[0];
+
+				TestRingBuffer.Release(TempData2);
+				y++;
+			}
+		}
+
+		Test_JoinThread(Thread);
+		Test_JoinThread(Thread2);
+
+		x = (y == 100000 && NumBad == 0 && Total == (std::uint64_t)50000 * 50001);
+		TEST_COMPARE(x, 1);
+	}
+
+	// Named ring buffer.
+	x = TestRingBuffer.Create("test_suite", 1024);
+	TEST_COMPARE(x, 1);
+
+	x = TestRingBuffer.Write("test", 5);
 	TEST_COMPARE(x, 1);
 
+	{
+		CubicleSoft::Sync::RingBuffer TestRingBuffer2;
+
+		// The mode must match.
+		x = TestRingBuffer2.Create("test_suite", 1024, true);
+		TEST_COMPARE(x, 0);
+
+		x = TestRingBuffer2.Create("test_suite", 1024);
+		TEST_COMPARE(x, 1);
+
+		Size = sizeof(TempData);
+		x = (TestRingBuffer2.Read(TempData, Size) && Size == 5 && !strcmp(TempData, "test"));
+		TEST_COMPARE(x, 1);
+	}
+
 	TEST_SUMMARY();
 
 	TEST_RETURN();
 }
 
-int Test_Templates_PackedOrderedHash(FILE *Testfp)
+int Test_Sync_WaitMultiple(FILE *Testfp)
 {
-	TEST_START(Test_Templates_PackedOrderedHash);
+	TEST_START(Test_Sync_WaitMultiple);
 
-	CubicleSoft::PackedOrderedHash<int> TestHash(32);
-	CubicleSoft::PackedOrderedHashNode<int> *Node;
+	CubicleSoft::Sync::WaitMultiple TestWaitMultiple;
+	CubicleSoft::Sync::Event TestEvent;
+	CubicleSoft::Sync::Semaphore TestSemaphore;
+	CubicleSoft::Sync::Mutex TestMutex;
+	size_t Index;
 	bool x;
-	int x2;
 
-	for (x2 = 0; x2 < 100; x2++)  TestHash.Set(x2, x2);
-	TestHash.Set("", 1, x2++);
-	TestHash.Set("test", 5, x2++);
+	x = (TestEvent.Create() && TestSemaphore.Create(NULL, 1) && TestSemaphore.Lock(0) && TestMutex.Create());
+	TEST_COMPARE(x, 1);
 
-	x = (TestHash.GetSize() == 102);
+	x = (TestWaitMultiple.Add(&TestEvent) && TestWaitMultiple.Add(&TestSemaphore) && TestWaitMultiple.GetSize() == 2);
 	TEST_COMPARE(x, 1);
 
-	// Test existence.
-	x = true;
-	for (x2 = 0; x2 < 100 && x; x2++)  x = (TestHash.Find(x2) != NULL);
-	if (x)  x = (TestHash.Find("", 1) != NULL);
-	if (x)  x = (TestHash.Find("test", 5) != NULL);
+	// Wait any.
+	x = TestWaitMultiple.Wait(false, 0);
+	TEST_COMPARE(x, 0);
+
+	x = TestWaitMultiple.Wait(false, 10);
+	TEST_COMPARE(x, 0);
+
+	TestEvent.Fire();
+	x = (TestWaitMultiple.Wait(false, 0, &Index) && Index == 0 && !TestEvent.Wait(0));
 	TEST_COMPARE(x, 1);
 
-	// Test order.
-	x = true;
-	size_t Pos = TestHash.GetNextPos();
-	for (x2 = 0; x2 < 100 && x; x2++)
+	TestSemaphore.Unlock();
+	x = (TestWaitMultiple.Wait(false, 0, &Index) && Index == 1 && !TestSemaphore.Lock(0));
+	TEST_COMPARE(x, 1);
+
+	// Wait all.
+	x = TestWaitMultiple.Add(&TestMutex);
+	TEST_COMPARE(x, 1);
+
+	TestSemaphore.Unlock();
+	x = TestWaitMultiple.Wait(true, 10);
+	TEST_COMPARE(x, 0);
+
+	// Nothing is held after a failed wait.
+	x = (TestSemaphore.Lock(0) && TestSemaphore.Unlock());
+	TEST_COMPARE(x, 1);
+
+	TestEvent.Fire();
+	x = (TestWaitMultiple.Wait(true, 0) && !TestEvent.Wait(0) && !TestSemaphore.Lock(0) && TestMutex.Unlock() && !TestMutex.Unlock());
+	TEST_COMPARE(x, 1);
+
+	// Woken from another thread.
+	TestThreadType Thread;
+	x = Test_StartThread(Thread, Test_Sync_Event_FireThread, &TestEvent);
+	TEST_COMPARE(x, 1);
+
+	if (x)
 	{
-		Node = TestHash.Next(Pos);
-		x = (Node != NULL && Node->GetStrKey() == NULL && Node->GetIntKey() == x2 && Node->Value == x2);
+		TestWaitMultiple.Clear();
+		TestWaitMultiple.Add(&TestSemaphore);
+		TestWaitMultiple.Add(&TestEvent);
+
+		x = (TestWaitMultiple.Wait(false, 5000, &Index) && Index == 1);
+		TEST_COMPARE(x, 1);
+
+		Test_JoinThread(Thread);
 	}
-	if (x)
+
+	// Named objects.
 	{
-		Node = TestHash.Next(Pos);
-		x = (Node != NULL && Node->GetStrKey() != NULL && Node->GetStrLen() == 1 && Node->Value == x2);
-		x2++;
+		CubicleSoft::Sync::Event TestEvent2, TestEvent3;
+
+		x = (TestEvent2.Create("test_suite_waitmultiple") && TestEvent3.Create("test_suite_waitmultiple"));
+		TEST_COMPARE(x, 1);
+
+		TestWaitMultiple.Clear();
+		TestWaitMultiple.Add(&TestSemaphore);
+		TestWaitMultiple.Add(&TestEvent2);
+
+		TestEvent3.Fire();
+		x = (TestWaitMultiple.Wait(false, 5000, &Index) && Index == 1);
+		TEST_COMPARE(x, 1);
 	}
-	if (x)
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
+volatile std::uint32_t Test_Sync_ThreadPool_Count;
+
+void Test_Sync_ThreadPool_Task(void *)
+{
+	CubicleSoft::Sync::Util::AtomicAdd32(&Test_Sync_ThreadPool_Count, 1);
+}
+
+// Submits ten more tasks from inside a worker.
+void Test_Sync_ThreadPool_SpawnTask(void *Data)
+{
+	CubicleSoft::Sync::ThreadPool *TestPool = (CubicleSoft::Sync::ThreadPool *)Data;
+
+	for (size_t x = 0; x < 10; x++)  TestPool->Submit(Test_Sync_ThreadPool_Task, NULL);
+
+	CubicleSoft::Sync::Util::AtomicAdd32(&Test_Sync_ThreadPool_Count, 1);
+}
+
+void Test_Sync_ThreadPool_TLSTask(void *Data)
+{
+	CubicleSoft::Sync::TLS *TestTLS = ((CubicleSoft::Sync::ThreadPool *)Data)->GetTLS();
+
+	char *Str = (char *)TestTLS->malloc(100);
+	if (Str != NULL)
 	{
-		Node = TestHash.Next(Pos);
-		x = (Node != NULL && Node->GetStrKey() != NULL && Node->GetStrLen() == 5 && Node->Value == x2);
-		x2++;
+		TestTLS->free(Str);
+
+		CubicleSoft::Sync::Util::AtomicAdd32(&Test_Sync_ThreadPool_Count, 1);
 	}
+}
+
+void Test_Sync_ThreadPool_Range(size_t Start, size_t End, void *Data)
+{
+	std::uint32_t *Values = (std::uint32_t *)Data;
+
+	for (; Start < End; Start++)  Values[Start]++;
+}
+
+// Runs a ParallelFor() from inside a worker.
+void Test_Sync_ThreadPool_NestedTask(void *Data)
+{
+	CubicleSoft::Sync::ThreadPool *TestPool = (CubicleSoft::Sync::ThreadPool *)Data;
+	std::uint32_t Values[1000];
+
+	memset(Values, 0, sizeof(Values));
+	TestPool->ParallelFor(1000, 10, Test_Sync_ThreadPool_Range, Values);
+
+	size_t x;
+	for (x = 0; x < 1000 && Values[x] == 1; x++);
+	if (x == 1000)  CubicleSoft::Sync::Util::AtomicAdd32(&Test_Sync_ThreadPool_Count, 1);
+}
+
+int Test_Sync_ThreadPool(FILE *Testfp)
+{
+	TEST_START(Test_Sync_ThreadPool);
+
+	CubicleSoft::Sync::ThreadPool TestPool;
+	CubicleSoft::Sync::ThreadPool::Stats TestStats;
+	void *DataArray[100];
+	size_t x2;
+	bool x;
+
+	x = TestPool.Submit(Test_Sync_ThreadPool_Task, NULL);
+	TEST_COMPARE(x, 0);
+
+	x = TestPool.Start(4);
 	TEST_COMPARE(x, 1);
 
-	// Test unset.
-	x = true;
-	for (x2 = 0; x2 < 100 && x; x2++)  x = TestHash.Unset(x2);
+	x = (TestPool.GetNumThreads() == 4 && TestPool.GetCurrentWorker() == -1);
 	TEST_COMPARE(x, 1);
 
-	x = (TestHash.GetSize() == 2);
+	// Tasks from outside of the pool.
+	Test_Sync_ThreadPool_Count = 0;
+	for (x2 = 0; x2 < 1000; x2++)  TestPool.Submit(Test_Sync_ThreadPool_Task, NULL);
+
+	x = TestPool.WaitIdle(10000);
+	TEST_COMPARE(x, 1);
+
+	x = (Test_Sync_ThreadPool_Count == 1000);
+	TEST_COMPARE(x, 1);
+
+	for (x2 = 0; x2 < 100; x2++)  DataArray[x2] = NULL;
+
+	x = TestPool.SubmitBatch(Test_Sync_ThreadPool_Task, DataArray, 100);
+	TEST_COMPARE(x, 1);
+
+	x = (TestPool.WaitIdle(10000) && Test_Sync_ThreadPool_Count == 1100);
+	TEST_COMPARE(x, 1);
+
+	// Tasks submitted by workers go to their own deques.
+	Test_Sync_ThreadPool_Count = 0;
+	for (x2 = 0; x2 < 100; x2++)  TestPool.Submit(Test_Sync_ThreadPool_SpawnTask, &TestPool);
+
+	x = (TestPool.WaitIdle(10000) && Test_Sync_ThreadPool_Count == 1100);
+	TEST_COMPARE(x, 1);
+
+	// Parallel for.
+	std::uint32_t *Values = new std::uint32_t[100000];
+	memset(Values, 0, sizeof(std::uint32_t) * 100000);
+
+	x = TestPool.ParallelFor(100000, 1000, Test_Sync_ThreadPool_Range, Values);
+	TEST_COMPARE(x, 1);
+
+	for (x2 = 0; x2 < 100000 && Values[x2] == 1; x2++);
+	x = (x2 == 100000);
+	TEST_COMPARE(x, 1);
+
+	delete[] Values;
+
+	// Nested parallel for.
+	Test_Sync_ThreadPool_Count = 0;
+	for (x2 = 0; x2 < 8; x2++)  TestPool.Submit(Test_Sync_ThreadPool_NestedTask, &TestPool);
+
+	x = (TestPool.WaitIdle(10000) && Test_Sync_ThreadPool_Count == 8);
 	TEST_COMPARE(x, 1);
 
+	TestPool.GetStats(TestStats);
+	x = (TestStats.NumThreads == 4 && TestStats.Executed >= 2208);
+	TEST_COMPARE(x, 1);
+
+	x = TestPool.Stop();
+	TEST_COMPARE(x, 1);
+
+	x = TestPool.Stop();
+	TEST_COMPARE(x, 0);
+
+	// Workers with thread local storage.
+	{
+		CubicleSoft::Sync::TLS TestTLS;
+
+		x = TestPool.Start(2, &TestTLS);
+		TEST_COMPARE(x, 1);
+
+		Test_Sync_ThreadPool_Count = 0;
+		for (x2 = 0; x2 < 100; x2++)  TestPool.Submit(Test_Sync_ThreadPool_TLSTask, &TestPool);
+
+		x = (TestPool.WaitIdle(10000) && Test_Sync_ThreadPool_Count == 100);
+		TEST_COMPARE(x, 1);
+
+		x = TestPool.Stop();
+		TEST_COMPARE(x, 1);
+	}
+
 	TEST_SUMMARY();
 
 	TEST_RETURN();
 }
 
-int Test_Templates_Queue(FILE *Testfp)
+void Test_Sync_ThreadPool_EmptyTask(void *)
 {
-	TEST_START(Test_Templates_Queue);
+}
 
-	CubicleSoft::Queue<int> TestQueue, TestQueue2;
-	CubicleSoft::QueueNode<int> *Node;
+// Submits 1,000 empty tasks from inside a worker.
+void Test_Sync_ThreadPool_BenchSpawnTask(void *Data)
+{
+	CubicleSoft::Sync::ThreadPool *TestPool = (CubicleSoft::Sync::ThreadPool *)Data;
+
+	for (size_t x = 0; x < 1000; x++)  TestPool->Submit(Test_Sync_ThreadPool_EmptyTask, NULL);
+}
+
+void Test_Sync_ThreadPool_BenchRange(size_t Start, size_t End, void *Data)
+{
+	std::uint32_t *Values = (std::uint32_t *)Data;
+
+	for (; Start < End; Start++)  Values[Start] = (std::uint32_t)Start;
+}
+
+void Test_Sync_ThreadPool_PrintRate(const char *Name, std::uint64_t Num, std::uint64_t DiffNS)
+{
+	char Rate[100], Overhead[100];
+
+	if (!DiffNS)  DiffNS = 1;
+
+	CubicleSoft::Convert::Int::ToString(Rate, 100, (std::uint64_t)(Num * 1000000000ULL / DiffNS), ',');
+	CubicleSoft::Convert::Int::ToString(Overhead, 100, (std::uint64_t)(DiffNS / Num), ',');
+	printf("done.\n\tRate:  %s %s/sec (%s ns each)\n", Rate, Name, Overhead);
+}
+
+class Test_Sync_ConcurrentOrderedHash_Info
+{
+public:
+	CubicleSoft::Sync::ConcurrentOrderedHash<std::uint32_t> *MxHash;
+	std::uint32_t MxStart, MxNum;
+	time_t MxEndTime;
+	std::uint64_t MxCount;
+	bool MxResult;
+};
+
+// Inserts, finds, updates, and removes its own range of keys while other threads do the same.
+TEST_THREAD_FUNC(Test_Sync_ConcurrentOrderedHash_Thread)
+{
+	Test_Sync_ConcurrentOrderedHash_Info *Info = (Test_Sync_ConcurrentOrderedHash_Info *)Data;
+	std::uint32_t x, Value;
+	char Str[20];
+
+	Info->MxResult = true;
+	for (x = Info->MxStart; x < Info->MxStart + Info->MxNum; x++)
+	{
+		if (!Info->MxHash->Push((std::int64_t)x, x))  Info->MxResult = false;
+
+		sprintf(Str, "key_%u", (unsigned int)x);
+		if (!Info->MxHash->Push(Str, strlen(Str), x))  Info->MxResult = false;
+	}
+
+	for (x = Info->MxStart; x < Info->MxStart + Info->MxNum; x++)
+	{
+		if (!Info->MxHash->Find((std::int64_t)x, Value) || Value != x)  Info->MxResult = false;
+		if (!Info->MxHash->Set((std::int64_t)x, x + 1) || !Info->MxHash->Find((std::int64_t)x, Value) || Value != x + 1)  Info->MxResult = false;
+
+		sprintf(Str, "key_%u", (unsigned int)x);
+		if (!Info->MxHash->Find(Str, strlen(Str), Value) || Value != x)  Info->MxResult = false;
+		if ((x & 1) && !Info->MxHash->Remove(Str, strlen(Str)))  Info->MxResult = false;
+	}
+
+	TEST_THREAD_RETURN();
+}
+
+int Test_Sync_ConcurrentOrderedHash(FILE *Testfp)
+{
+	TEST_START(Test_Sync_ConcurrentOrderedHash);
+
+	CubicleSoft::Sync::ConcurrentOrderedHash<std::uint32_t> TestHash(8);
+	CubicleSoft::OrderedHashNode<std::uint32_t> *Node;
+	Test_Sync_ConcurrentOrderedHash_Info Info[4];
+	TestThreadType Threads[4];
+	std::uint32_t Value;
+	size_t x2, y;
 	bool x;
-	int x2;
 
-	for (x2 = 0; x2 < 100; x2++)  TestQueue += x2;
+	x = (TestHash.GetNumShards() == 8 && TestHash.GetSize() == 0);
+	TEST_COMPARE(x, 1);
+
+	x = (TestHash.Push(5, 10) && !TestHash.Push(5, 11) && TestHash.Push("5", 1, 12));
+	TEST_COMPARE(x, 1);
+
+	x = (TestHash.Find(5, Value) && Value == 10 && TestHash.Find("5", 1, Value) && Value == 12 && !TestHash.Find(6, Value));
+	TEST_COMPARE(x, 1);
+
+	x = (TestHash.Set(5, 13) && TestHash.Set("6", 1, 14) && TestHash.Find(5, Value) && Value == 13 && TestHash.GetSize() == 3);
+	TEST_COMPARE(x, 1);
+
+	// Detached nodes can be moved between hashes.
+	Node = TestHash.Detach(5, false);
+	x = (Node != NULL && Node->Value == 13 && !TestHash.Find(5, Value) && TestHash.Detach(5, false) == NULL);
+	TEST_COMPARE(x, 1);
+
+	x = (TestHash.Push(Node) && TestHash.Find(5, Value) && Value == 13 && !TestHash.Push(Node));
+	TEST_COMPARE(x, 1);
+
+	x = (TestHash.Remove("6", 1) && !TestHash.Remove("6", 1) && TestHash.GetSize() == 2);
+	TEST_COMPARE(x, 1);
+
+	// Every node is in exactly one shard.
+	y = 0;
+	for (x2 = 0; x2 < TestHash.GetNumShards(); x2++)  y += TestHash.GetShardHash(x2)->GetListSize();
+	x = (y == 2);
+	TEST_COMPARE(x, 1);
+
+	TestHash.Empty();
+	x = (TestHash.GetSize() == 0);
+	TEST_COMPARE(x, 1);
+
+	// Multiple threads.
+	for (x2 = 0; x2 < 4; x2++)
+	{
+		Info[x2].MxHash = &TestHash;
+		Info[x2].MxStart = (std::uint32_t)(x2 * 5000);
+		Info[x2].MxNum = 5000;
+
+		if (!Test_StartThread(Threads[x2], Test_Sync_ConcurrentOrderedHash_Thread, &Info[x2]))  break;
+	}
+
+	x = (x2 == 4);
+	TEST_COMPARE(x, 1);
+
+	while (x2)
+	{
+		x2--;
+		Test_JoinThread(Threads[x2]);
+	}
+
+	x = (Info[0].MxResult && Info[1].MxResult && Info[2].MxResult && Info[3].MxResult && TestHash.GetSize() == 30000);
+	TEST_COMPARE(x, 1);
+
+	// A single shard is fully ordered.
+	{
+		CubicleSoft::Sync::ConcurrentOrderedHash<std::uint32_t> TestHash2(1, 23, 0, 0);
+
+		for (x2 = 0; x2 < 100; x2++)  TestHash2.Push((std::int64_t)(100 - x2), (std::uint32_t)x2);
+
+		Node = TestHash2.GetShardHash(0)->FirstList();
+		for (x2 = 0; Node != NULL && Node->Value == x2; x2++)  Node = Node->NextList();
+		x = (TestHash2.GetNumShards() == 1 && x2 == 100);
+		TEST_COMPARE(x, 1);
+	}
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
+// Pushes MxNum keys starting at MxStart.
+TEST_THREAD_FUNC(Test_Sync_ConcurrentOrderedHash_BenchInsertThread)
+{
+	Test_Sync_ConcurrentOrderedHash_Info *Info = (Test_Sync_ConcurrentOrderedHash_Info *)Data;
+
+	for (std::uint32_t x = Info->MxStart; x < Info->MxStart + Info->MxNum; x++)  Info->MxHash->Push((std::int64_t)x, x);
+
+	TEST_THREAD_RETURN();
+}
+
+// Finds keys scattered across [0, MxNum) until the end time.
+TEST_THREAD_FUNC(Test_Sync_ConcurrentOrderedHash_BenchFindThread)
+{
+	Test_Sync_ConcurrentOrderedHash_Info *Info = (Test_Sync_ConcurrentOrderedHash_Info *)Data;
+	std::uint32_t x = Info->MxStart, Value;
+
+	do
+	{
+		for (size_t y = 0; y < 1024; y++)
+		{
+			x = (x + 2654435761U) % Info->MxNum;
+			if (!Info->MxHash->Find((std::int64_t)x, Value))  printf("Unable to find node!\n");
+		}
+
+		Info->MxCount += 1024;
+	} while (time(NULL) < Info->MxEndTime);
+
+	TEST_THREAD_RETURN();
+}
+
+int Test_Templates_Cache(FILE *Testfp)
+{
+	TEST_START(Test_Templates_Cache);
+
+	CubicleSoft::Cache<size_t, int> TestCache(11);
+	bool x;
+	size_t x2;
+	int y;
+
+	for (x2 = 0; x2 < 100; x2++)
+	{
+		TestCache.Insert(x2, x2, (int)(x2 + 1));
+	}
+
+	x = TestCache.Exists(99, 99);
+	TEST_COMPARE(x, 1);
+
+	x = TestCache.Remove(99, 99);
+	TEST_COMPARE(x, 1);
+
+	x = TestCache.Exists(99, 99);
+	TEST_COMPARE(x, 0);
+
+	x = TestCache.Find(y, 0, 0);
+	TEST_COMPARE(x, 0);
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
+int Test_Templates_ChunkArena(FILE *Testfp)
+{
+	TEST_START(Test_Templates_ChunkArena);
+
+	CubicleSoft::ChunkArena TestArena(1024);
+	char *Str, *Str2, *Str3;
+	bool x;
+	size_t x2;
+
+	Str = (char *)TestArena.Alloc(10);
+	Str2 = (char *)TestArena.Alloc(8, 8);
+	x = (Str != NULL && Str2 == Str + 16 && TestArena.GetNumChunks() == 1);
+	TEST_COMPARE(x, 1);
+
+	// Large allocations get their own chunk without disturbing the current one.
+	Str3 = (char *)TestArena.Alloc(2000);
+	Str = (char *)TestArena.Alloc(8);
+	x = (Str3 != NULL && Str == Str2 + 8 && TestArena.GetNumChunks() == 2);
+	TEST_COMPARE(x, 1);
+
+	x = true;
+	for (x2 = 0; x2 < 1000 && x; x2++)
+	{
+		Str = (char *)TestArena.Alloc(20);
+		x = (Str != NULL);
+		if (x)  memset(Str, 'a', 20);
+	}
+	TEST_COMPARE(x, 1);
+
+	x = (TestArena.GetNumChunks() > 2 && TestArena.GetTotalSize() >= 20000);
+	TEST_COMPARE(x, 1);
+
+	TestArena.Empty();
+	x = (TestArena.GetNumChunks() == 0 && TestArena.GetTotalSize() == 0 && TestArena.Alloc(5) != NULL);
+	TEST_COMPARE(x, 1);
+
+	// Chunks from Sync::TLS.
+	CubicleSoft::Sync::TLS TempTLS;
+
+	x = TempTLS.ThreadInit();
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		CubicleSoft::ChunkArena TestArena2(4096, &CubicleSoft::Sync::TLS::malloc, &CubicleSoft::Sync::TLS::free, &TempTLS);
+
+		x = (TestArena2.GetMallocFunc() != NULL);
+		for (x2 = 0; x2 < 1000 && x; x2++)
+		{
+			Str = (char *)TestArena2.Alloc(15);
+			x = (Str != NULL);
+			if (x)  memset(Str, 'b', 15);
+		}
+		TEST_COMPARE(x, 1);
+
+		TestArena2.Empty();
+
+		x = TempTLS.ThreadEnd();
+		TEST_COMPARE(x, 1);
+	}
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
+int Test_Templates_List(FILE *Testfp)
+{
+	TEST_START(Test_Templates_List);
+
+	CubicleSoft::List<int> TestList, TestList2;
+	CubicleSoft::ListNode<int> *Node;
+	bool x;
+	int x2;
+
+	for (x2 = 0; x2 < 100; x2++)  TestList += x2;
+
+	x = (TestList.GetSize() == 100);
+	TEST_COMPARE(x, 1);
+
+	while ((Node = TestList.Shift()) != NULL)  TestList2 += Node;
+
+	x = (TestList.GetSize() == 0);
+	TEST_COMPARE(x, 1);
+
+	x = (TestList2.GetSize() == 100);
+	TEST_COMPARE(x, 1);
+
+	TestList.DetachAllAndAppend(TestList2);
+
+	x = (TestList.GetSize() == 100);
+	TEST_COMPARE(x, 1);
+
+	x = (TestList2.GetSize() == 0);
+	TEST_COMPARE(x, 1);
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
+// Inserts, finds, and removes integer and string keys in an OrderedHash with any hash policy.
+template <class HashType>
+bool Test_Templates_HashPolicy(HashType &TestHash)
+{
+	char Str[40];
+	int x2;
+	bool x = true;
+
+	for (x2 = 0; x2 < 5000 && x; x2++)
+	{
+		sprintf(Str, "policy_key_%d", x2);
+		x = (TestHash.Push(x2 * 64, x2) != NULL && TestHash.Push(Str, strlen(Str), x2) != NULL);
+	}
+	if (x)  x = (TestHash.Push(64, 0) == NULL && TestHash.Push("policy_key_1", 12, 0) == NULL);
+
+	for (x2 = 0; x2 < 5000 && x; x2++)
+	{
+		sprintf(Str, "policy_key_%d", x2);
+		x = (TestHash.Find(x2 * 64) != NULL && TestHash.Find(x2 * 64)->Value == x2 && TestHash.Find(x2 * 64 + 1) == NULL && TestHash.Find(Str, strlen(Str)) != NULL && TestHash.Find(Str + 1, strlen(Str) - 1) == NULL);
+	}
+
+	for (x2 = 0; x2 < 5000 && x; x2 += 2)  x = TestHash.Remove(TestHash.Find(x2 * 64));
+	if (x)  x = (TestHash.GetListSize() == 7500 && TestHash.Find((std::int64_t)0) == NULL && TestHash.Find(64) != NULL);
+
+	return x;
+}
+
+int Test_Templates_OrderedHash(FILE *Testfp)
+{
+	TEST_START(Test_Templates_OrderedHash);
+
+	CubicleSoft::OrderedHash<int> TestHash(47);
+	CubicleSoft::OrderedHashNode<int> *Node, *Nodes = NULL;
+	bool x;
+	int x2;
+
+	for (x2 = 0; x2 < 100; x2++)  TestHash.Push(x2, x2);
+	TestHash.Push("", 1, x2++);
+	TestHash.Push("test", 5, x2++);
+
+	x = (TestHash.GetListSize() == 102);
+	TEST_COMPARE(x, 1);
+
+	// Test existence.
+	x = true;
+	for (x2 = 0; x2 < 100 && x; x2++)
+	{
+		if (x)  x = (TestHash.Find(x2) != NULL);
+	}
+	if (x)  x = (TestHash.Find("", 1) != NULL);
+	if (x)  x = (TestHash.Find("test", 5) != NULL);
+	TEST_COMPARE(x, 1);
+
+	// Test order.
+	x = true;
+	Node = TestHash.FirstList();
+	for (x2 = 0; x2 < 100 && x; x2++)  x = ((Node = Node->NextList()) != NULL);
+	if (x)
+	{
+		x = (Node->GetStrKey() != NULL && Node->GetIntKey() == 1 && Node->Value == x2);
+		Node = Node->NextList();
+		x2++;
+	}
+	if (x)
+	{
+		x = (Node->GetStrKey() != NULL && Node->GetIntKey() == 5 && Node->Value == x2);
+		Node = Node->NextList();
+		x2++;
+	}
+	TEST_COMPARE(x, 1);
+
+	while ((Node = TestHash.Shift(false)) != NULL)
+	{
+		Node->NextListNode = Nodes;
+		Nodes = Node;
+	}
+
+	x = (TestHash.GetListSize() == 0);
+	TEST_COMPARE(x, 1);
+
+	while (Nodes != NULL)
+	{
+		Node = Nodes->NextListNode;
+		TestHash.Unshift(Nodes);
+		Nodes = Node;
+	}
+
+	x = (TestHash.GetListSize() == 102);
+	TEST_COMPARE(x, 1);
+
+	// Keys in a ChunkArena.
+	{
+		CubicleSoft::OrderedHash<int> TestHash2;
+		char Str[40];
+
+		TestHash2.Push("existing_key", 12, -1);
+
+		x = (TestHash2.UseKeyArena(4096) && !TestHash2.UseKeyArena() && TestHash2.GetKeyArena() != NULL);
+		TEST_COMPARE(x, 1);
+
+		x = true;
+		for (x2 = 0; x2 < 1000 && x; x2++)
+		{
+			sprintf(Str, "arena_key_%d", x2);
+			x = (TestHash2.Push(Str, strlen(Str), x2) != NULL);
+		}
+		if (x)  x = (TestHash2.Push("arena_key_5", 11, 5) == NULL);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.Find("existing_key", 12) != NULL && TestHash2.Find("arena_key_999", 13) != NULL && TestHash2.GetKeyArena()->GetNumChunks() > 1);
+		TEST_COMPARE(x, 1);
+
+		// Detached nodes keep their keys after the hash is gone.
+		Node = TestHash2.Find("arena_key_10", 12);
+		x = (Node != NULL && TestHash2.Detach(Node, false) && TestHash2.Remove(TestHash2.Find("arena_key_11", 12)));
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::OrderedHash<int> TestHash3(TestHash2);
+
+		x = (TestHash3.GetListSize() == 999 && TestHash3.GetKeyArena() != TestHash2.GetKeyArena() && TestHash3.Find("arena_key_999", 13) != NULL && TestHash3.Find("arena_key_11", 12) == NULL);
+		TEST_COMPARE(x, 1);
+
+		TestHash2.Empty();
+		x = (TestHash2.GetKeyArena()->GetNumChunks() == 0 && TestHash2.Push(Node) == Node && TestHash2.Find("arena_key_10", 12) == Node);
+		TEST_COMPARE(x, 1);
+
+		TestHash3 = TestHash2;
+		x = (TestHash3.GetListSize() == 1 && TestHash3.Find("arena_key_10", 12) != NULL && TestHash3.Find("arena_key_999", 13) == NULL);
+		TEST_COMPARE(x, 1);
+
+		// Keys managed by the caller are never moved into or out of the arena.
+		CubicleSoft::OrderedHash<int> TestHash4;
+		CubicleSoft::OrderedHashNode<int> *Node2 = CubicleSoft::OrderedHash<int>::CreateNode(0, 1);
+		Node = CubicleSoft::OrderedHash<int>::CreateNode(0, 2);
+		strcpy(Str, "caller_key_1caller_key_2");
+		Node2->SetStrKey(Str, 12, false);
+		Node->SetStrKey(Str + 12, 12, false);
+
+		x = (TestHash4.Push(Node2) == Node2 && TestHash4.UseKeyArena() && TestHash4.Push(Node) == Node && Node2->GetStrKey() == Str && Node->GetStrKey() == Str + 12 && TestHash4.Find("caller_key_2", 12) == Node);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash4.Detach(Node2, false) && TestHash4.Detach(Node, false) && Node2->GetStrKey() == Str && Node->GetStrKey() == Str + 12);
+		TEST_COMPARE(x, 1);
+
+		Node2->SetStrKey(NULL, 0, false);
+		Node->SetStrKey(NULL, 0, false);
+		delete Node2;
+		delete Node;
+	}
+
+	// Hash policies.
+	{
+		const char *Str = "The quick brown fox jumps over the lazy dog";
+
+		x = true;
+		for (x2 = 0; x2 < 44 && x; x2++)
+		{
+			x = ((std::uint64_t)CubicleSoft::OrderedHashUtil::GetDJBX33XHashKey((const std::uint8_t *)Str, x2, 5381) == CubicleSoft::HashPolicyUtil::GetDJBX33XHashKey((const std::uint8_t *)Str, x2, 5381) &&
+				CubicleSoft::OrderedHashUtil::GetSipHashKey((const std::uint8_t *)Str, x2, 1, 2, 2, 4) == CubicleSoft::HashPolicyUtil::GetSipHashKey((const std::uint8_t *)Str, x2, 1, 2, 2, 4) &&
+				CubicleSoft::HashPolicyUtil::GetWyHashKey((const std::uint8_t *)Str, x2, 0) != CubicleSoft::HashPolicyUtil::GetWyHashKey((const std::uint8_t *)Str, x2 + 1, 0));
+		}
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::OrderedHash<int, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncWyHash, CubicleSoft::OrderedHashBucketMask> > TestHash2(10);
+		x = (TestHash2.GetHashSize() == 16 && Test_Templates_HashPolicy(TestHash2) && TestHash2.GetHashSize() == 8192);
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::OrderedHash<int, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncSipHash13, CubicleSoft::OrderedHashBucketFastRange> > TestHash3(10, 1, 2);
+		x = (TestHash3.GetHashSize() == 10 && Test_Templates_HashPolicy(TestHash3));
+		TEST_COMPARE(x, 1);
+
+		// Sequential integer keys don't collide with identity hashing.
+		CubicleSoft::OrderedHash<int, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncIdentity, CubicleSoft::OrderedHashBucketMask> > TestHash4(128);
+		for (x2 = 0; x2 < 100; x2++)  TestHash4.Push(x2, x2);
+		x = true;
+		for (x2 = 0; x2 < 100 && x; x2++)  x = (TestHash4.Find(x2) != NULL && TestHash4.Find(x2)->PrevHash() == NULL && TestHash4.Find(x2)->NextHash() == NULL);
+		TEST_COMPARE(x, 1);
+
+		TestHash4.Empty();
+		x = Test_Templates_HashPolicy(TestHash4);
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::OrderedHash<int, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncDJB2, CubicleSoft::OrderedHashBucketPrime> > TestHash5;
+		x = Test_Templates_HashPolicy(TestHash5);
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::OrderedHash<int, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncSipHash24, CubicleSoft::OrderedHashBucketMask> > TestHash6(TestHash5.GetListSize(), 1, 2);
+		x = Test_Templates_HashPolicy(TestHash6);
+		if (x)
+		{
+			CubicleSoft::OrderedHash<int, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncSipHash24, CubicleSoft::OrderedHashBucketMask> > TestHash7(TestHash6);
+			x = (TestHash7.GetListSize() == 7500 && TestHash7.Find("policy_key_4999", 15) != NULL && TestHash7.Find(64) != NULL);
+		}
+		TEST_COMPARE(x, 1);
+	}
+
+	// Incremental resizing.
+	{
+		CubicleSoft::OrderedHash<int> TestHash2(10);
+		bool x3 = false;
+
+		TestHash2.SetIncrementalResize(1);
+		x = (TestHash2.GetIncrementalResize() == 1 && !TestHash2.IsResizing());
+		TEST_COMPARE(x, 1);
+
+		// Every key has to stay findable while buckets are moved one at a time.
+		x = true;
+		for (x2 = 0; x2 < 20000 && x; x2++)
+		{
+			x = (TestHash2.Push(x2, x2) != NULL && TestHash2.Find(x2) != NULL && TestHash2.Find(x2 / 2) != NULL && TestHash2.Push(x2 / 2, 0) == NULL);
+			if (TestHash2.IsResizing())  x3 = true;
+		}
+		TEST_COMPARE(x, 1);
+		TEST_COMPARE(x3, 1);
+
+		x = true;
+		for (x2 = 0; x2 < 20000 && x; x2 += 3)  x = TestHash2.Remove(TestHash2.Find(x2));
+		for (x2 = 0; x2 < 20000 && x; x2++)  x = ((TestHash2.Find(x2) == NULL) == (x2 % 3 == 0));
+		TEST_COMPARE(x, 1);
+
+		// Copies start out fully resized.
+		CubicleSoft::OrderedHash<int> TestHash3(TestHash2);
+		x = (!TestHash3.IsResizing() && TestHash3.GetListSize() == TestHash2.GetListSize() && TestHash3.Find(19999) != NULL && TestHash3.Find(19998) == NULL && TestHash3.Remove(TestHash3.Find(1)) && TestHash3.Find(1) == NULL);
+		TEST_COMPARE(x, 1);
+
+		// Policies work too.
+		CubicleSoft::OrderedHash<int, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncWyHash, CubicleSoft::OrderedHashBucketMask> > TestHash4(10);
+		TestHash4.SetIncrementalResize(2);
+		x = Test_Templates_HashPolicy(TestHash4);
+		TEST_COMPARE(x, 1);
+
+		while (TestHash2.ResizeStep(16))  {}
+		x = (!TestHash2.IsResizing() && TestHash2.Find(19999) != NULL && TestHash2.Find(19998) == NULL);
+		TEST_COMPARE(x, 1);
+
+		// Empty() abandons a resize in progress.
+		for (x2 = 0; x2 < 50000 && !TestHash2.IsResizing(); x2++)  TestHash2.Push(x2 + 100000, x2);
+		TestHash2.Empty();
+		x = (!TestHash2.IsResizing() && TestHash2.GetListSize() == 0 && TestHash2.Push(5, 5) != NULL && TestHash2.Find(5) != NULL);
+		TEST_COMPARE(x, 1);
+
+		TestHash2.SetIncrementalResize(0);
+		x = (TestHash2.GetIncrementalResize() == 0 && !TestHash2.IsResizing());
+		TEST_COMPARE(x, 1);
+	}
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
+int Test_Templates_PackedOrderedHash(FILE *Testfp)
+{
+	TEST_START(Test_Templates_PackedOrderedHash);
+
+	CubicleSoft::PackedOrderedHash<int> TestHash(32);
+	CubicleSoft::PackedOrderedHashNode<int> *Node;
+	bool x;
+	int x2, x3;
+
+	for (x2 = 0; x2 < 100; x2++)  TestHash.Set(x2, x2);
+	TestHash.Set("", 1, x2++);
+	TestHash.Set("test", 5, x2++);
+
+	x = (TestHash.GetSize() == 102);
+	TEST_COMPARE(x, 1);
+
+	// Test existence.
+	x = true;
+	for (x2 = 0; x2 < 100 && x; x2++)  x = (TestHash.Find(x2) != NULL);
+	if (x)  x = (TestHash.Find("", 1) != NULL);
+	if (x)  x = (TestHash.Find("test", 5) != NULL);
+	TEST_COMPARE(x, 1);
+
+	// Test order.
+	x = true;
+	size_t Pos = TestHash.GetNextPos();
+	for (x2 = 0; x2 < 100 && x; x2++)
+	{
+		Node = TestHash.Next(Pos);
+		x = (Node != NULL && Node->GetStrKey() == NULL && Node->GetIntKey() == x2 && Node->Value == x2);
+	}
+	if (x)
+	{
+		Node = TestHash.Next(Pos);
+		x = (Node != NULL && Node->GetStrKey() != NULL && Node->GetStrLen() == 1 && Node->Value == x2);
+		x2++;
+	}
+	if (x)
+	{
+		Node = TestHash.Next(Pos);
+		x = (Node != NULL && Node->GetStrKey() != NULL && Node->GetStrLen() == 5 && Node->Value == x2);
+		x2++;
+	}
+	TEST_COMPARE(x, 1);
+
+	// Test unset.
+	x = true;
+	for (x2 = 0; x2 < 100 && x; x2++)  x = TestHash.Unset(x2);
+	TEST_COMPARE(x, 1);
+
+	x = (TestHash.GetSize() == 2);
+	TEST_COMPARE(x, 1);
+
+	// With InlineKeys, short string keys are stored in the node.  Longer ones are allocated.  Without it, nodes are 8 bytes smaller.
+	{
+		CubicleSoft::PackedOrderedHash<int, CubicleSoft::HashFuncRuntime, true> TestHash2;
+		CubicleSoft::PackedOrderedHashNode<int, true> *Node2;
+
+		x = (sizeof(CubicleSoft::PackedOrderedHashNode<std::int64_t, true>) == sizeof(CubicleSoft::PackedOrderedHashNode<std::int64_t>) + 8);
+		TEST_COMPARE(x, 1);
+
+		TestHash2.Set("", 0, 1);
+		TestHash2.Set("123456789012345", 15, 2);
+		TestHash2.Set("1234567890123456", 16, 3);
+		TestHash2.Set(15, 4);
+
+		Node2 = TestHash2.Find("123456789012345", 15);
+		x = (Node2 != NULL && Node2->Value == 2 && Node2->GetStrLen() == 15 && !memcmp(Node2->GetStrKey(), "123456789012345", 15));
+		TEST_COMPARE(x, 1);
+
+		Node2 = TestHash2.Find("1234567890123456", 16);
+		x = (Node2 != NULL && Node2->Value == 3 && Node2->GetStrLen() == 16 && !memcmp(Node2->GetStrKey(), "1234567890123456", 16));
+		TEST_COMPARE(x, 1);
+
+		Node2 = TestHash2.Find("", 0);
+		x = (Node2 != NULL && Node2->Value == 1 && Node2->GetStrKey() != NULL && Node2->GetStrLen() == 0 && TestHash2.Find(15)->GetStrKey() == NULL);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.Find("12345678901234", 14) == NULL && TestHash2.Find("123456789012345 ", 16) == NULL && TestHash2.Find("12345678901234567", 17) == NULL);
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::PackedOrderedHash<int, CubicleSoft::HashFuncRuntime, true> TestHash3(TestHash2);
+		TestHash2.Unset("1234567890123456", 16);
+
+		Node2 = TestHash3.Find("1234567890123456", 16);
+		x = (TestHash2.GetSize() == 3 && TestHash3.GetSize() == 4 && Node2 != NULL && Node2->Value == 3 && TestHash3.Find("123456789012345", 15) != NULL);
+		TEST_COMPARE(x, 1);
+	}
+
+	// Without InlineKeys, every string key is allocated.
+	for (x3 = 0; x3 < 2; x3++)
+	{
+		CubicleSoft::PackedOrderedHash<int> TestHash2;
+
+		if (x3 == 1)  TestHash2.UseKeyArena();
+		TestHash2.Set("", 0, 1);
+		TestHash2.Set("123456789012345", 15, 2);
+		TestHash2.Set(15, 4);
+
+		x = (TestHash2.Find("", 0) != NULL && TestHash2.Find("", 0)->GetStrKey() != NULL && TestHash2.Find("", 0)->GetStrLen() == 0 && TestHash2.Find(15)->GetStrKey() == NULL && TestHash2.Find(15)->GetStrLen() == 0);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.Find("123456789012345", 15) != NULL && TestHash2.Find("123456789012345", 15)->Value == 2 && !memcmp(TestHash2.Find("123456789012345", 15)->GetStrKey(), "123456789012345", 15) && TestHash2.Find("12345678901234", 14) == NULL);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.Unset("123456789012345", 15) && TestHash2.Find("123456789012345", 15) == NULL && TestHash2.GetSize() == 2);
+		TEST_COMPARE(x, 1);
+	}
+
+	// Open addressing probe index.
+	{
+		CubicleSoft::PackedOrderedHash<int> TestHash2;
+		char Str[20];
+		size_t y;
+
+		x = (TestHash2.SetProbeIndex(true) && TestHash2.IsProbeIndex());
+		TEST_COMPARE(x, 1);
+
+		for (x2 = 0; x2 < 10000; x2++)
+		{
+			TestHash2.Set(x2, x2);
+
+			sprintf(Str, "key_%d", x2);
+			TestHash2.Set(Str, strlen(Str), x2 + 10000);
+		}
+
+		x = (TestHash2.GetSize() == 20000);
+		TEST_COMPARE(x, 1);
+
+		x = true;
+		for (x2 = 0; x2 < 10000 && x; x2++)
+		{
+			Node = TestHash2.Find(x2);
+			x = (Node != NULL && Node->Value == x2);
+
+			sprintf(Str, "key_%d", x2);
+			Node = TestHash2.Find(Str, strlen(Str));
+			if (x)  x = (Node != NULL && Node->Value == x2 + 10000);
+		}
+		if (x)  x = (TestHash2.Find(10000) == NULL && TestHash2.Find("key_10000", 9) == NULL);
+		TEST_COMPARE(x, 1);
+
+		// Unset most nodes, then add new ones so deleted slots get reused.
+		x = true;
+		for (x2 = 0; x2 < 10000 && x; x2++)
+		{
+			if (x2 % 10)
+			{
+				x = TestHash2.Unset(x2);
+
+				sprintf(Str, "key_%d", x2);
+				if (x)  x = TestHash2.Unset(Str, strlen(Str));
+			}
+		}
+		for (x2 = 20000; x2 < 21000; x2++)  TestHash2.Set(x2, x2);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.GetSize() == 3000 && TestHash2.Find(1) == NULL && TestHash2.Find("key_1", 5) == NULL && TestHash2.Find(20999) != NULL);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.Optimize() && TestHash2.GetNextPos() == 3000);
+		TEST_COMPARE(x, 1);
+
+		// Order is preserved.
+		x = true;
+		y = TestHash2.GetNextPos();
+		for (x2 = 0; x2 < 10000 && x; x2 += 10)
+		{
+			Node = TestHash2.Next(y);
+			x = (Node != NULL && Node->GetStrKey() == NULL && Node->Value == x2);
+
+			Node = TestHash2.Next(y);
+			if (x)  x = (Node != NULL && Node->GetStrKey() != NULL && Node->Value == x2 + 10000);
+		}
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::PackedOrderedHash<int> TestHash3(TestHash2);
+
+		x = (TestHash3.IsProbeIndex() && TestHash3.GetSize() == 3000 && TestHash3.Find(9990) != NULL && TestHash3.Find("key_9990", 8) != NULL && TestHash3.Find(9991) == NULL);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash3.SetProbeIndex(false) && !TestHash3.IsProbeIndex() && TestHash3.Find(20500) != NULL && TestHash3.Find("key_9990", 8) != NULL && TestHash3.Find(9991) == NULL);
+		TEST_COMPARE(x, 1);
+
+		x = (CubicleSoft::PackedOrderedHash<int>::GetMaxHashSize(true) == ((size_t)1 << 30) && CubicleSoft::PackedOrderedHash<int>::GetMaxHashSize(false) == ((size_t)1 << 31));
+		TEST_COMPARE(x, 1);
+	}
+
+	// Hash keys are mixed before picking a probe index group, so keys that only differ in their upper bits still spread out.
+	{
+		CubicleSoft::PackedOrderedHash<int, CubicleSoft::HashFuncIdentity> TestHash2;
+
+		TestHash2.SetProbeIndex(true);
+		for (x2 = 0; x2 < 5000; x2++)  TestHash2.Set((std::int64_t)x2 << 40, x2);
+
+		x = true;
+		for (x2 = 0; x2 < 5000 && x; x2++)  x = (TestHash2.Find((std::int64_t)x2 << 40) != NULL && TestHash2.Find((std::int64_t)x2 << 40)->Value == x2);
+		if (x)  x = (TestHash2.GetSize() == 5000 && TestHash2.Find((std::int64_t)5000 << 40) == NULL);
+		TEST_COMPARE(x, 1);
+	}
+
+	// Batched lookups and insertions in both index modes.
+	for (x3 = 0; x3 < 2; x3++)
+	{
+		CubicleSoft::PackedOrderedHash<int> TestHash2;
+		CubicleSoft::PackedOrderedHashNode<int> *Results[1000];
+		std::int64_t IntKeys[1000];
+		int Values[1000];
+		char StrData[1000][20];
+		const char *StrKeys[1000];
+		size_t StrLens[1000];
+
+		TestHash2.SetProbeIndex(x3 == 1);
+
+		for (x2 = 0; x2 < 1000; x2++)
+		{
+			IntKeys[x2] = x2 * 3;
+			Values[x2] = x2;
+			sprintf(StrData[x2], "%s_%d", (x2 & 1 ? "batch_key_long" : "bk"), x2 * 3);
+			StrKeys[x2] = StrData[x2];
+			StrLens[x2] = strlen(StrData[x2]);
+		}
+
+		x = (TestHash2.SetBatch(IntKeys, 1000, Values) == 1000 && TestHash2.SetBatch(StrKeys, StrLens, 1000, Values) == 1000 && TestHash2.SetBatch(IntKeys, 10, Values + 500) == 0);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.GetSize() == 2000 && TestHash2.Find(27)->Value == 509 && TestHash2.Find(30)->Value == 10 && TestHash2.Find("batch_key_long_2997", 19)->Value == 999);
+		TEST_COMPARE(x, 1);
+
+		// Every third key is present.
+		for (x2 = 0; x2 < 1000; x2++)  IntKeys[x2] = x2;
+		x = (TestHash2.FindBatch(IntKeys, 1000, Results) == 334);
+		for (x2 = 0; x2 < 1000 && x; x2++)  x = (Results[x2] == TestHash2.Find(x2));
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.FindBatch(StrKeys, StrLens, 1000, Results) == 1000);
+		for (x2 = 0; x2 < 1000 && x; x2++)  x = (Results[x2] != NULL && Results[x2]->Value == x2);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.FindBatch(StrKeys, StrLens, 3, Results) == 3 && TestHash2.FindBatch(IntKeys, 0, Results) == 0);
+		TEST_COMPARE(x, 1);
+	}
+
+	// Hash policies in both index modes.
+	for (x3 = 0; x3 < 2; x3++)
+	{
+		CubicleSoft::PackedOrderedHash<int, CubicleSoft::HashFuncWyHash> TestHash2;
+		CubicleSoft::PackedOrderedHash<int, CubicleSoft::HashFuncIdentity> TestHash3;
+		char Str[40];
+
+		TestHash2.SetProbeIndex(x3 == 1);
+		TestHash3.SetProbeIndex(x3 == 1);
+
+		for (x2 = 0; x2 < 5000; x2++)
+		{
+			sprintf(Str, "policy_key_%d", x2);
+			TestHash2.Set(x2 * 64, x2);
+			TestHash2.Set(Str, strlen(Str), x2);
+			TestHash3.Set(x2, x2);
+			TestHash3.Set(Str, strlen(Str), x2);
+		}
+
+		for (x2 = 0; x2 < 5000; x2 += 2)  TestHash2.Unset(x2 * 64);
+		TestHash2.Optimize();
+
+		x = (TestHash2.GetSize() == 7500 && TestHash3.GetSize() == 10000);
+		for (x2 = 0; x2 < 5000 && x; x2++)
+		{
+			sprintf(Str, "policy_key_%d", x2);
+			x = ((TestHash2.Find(x2 * 64) != NULL) == (x2 % 2 == 1) && TestHash2.Find(Str, strlen(Str))->Value == x2 && TestHash3.Find(x2)->Value == x2 && TestHash3.Find(Str, strlen(Str))->Value == x2 && TestHash3.Find(x2 + 5000) == NULL);
+		}
+		TEST_COMPARE(x, 1);
+	}
+
+	// Long keys in a ChunkArena.
+	{
+		CubicleSoft::PackedOrderedHash<int> TestHash2;
+		char Str[40];
+
+		TestHash2.Set("an_existing_long_key", 20, -1);
+
+		x = (TestHash2.UseKeyArena(4096) && !TestHash2.UseKeyArena() && TestHash2.GetKeyArena() != NULL);
+		TEST_COMPARE(x, 1);
+
+		x = true;
+		for (x2 = 0; x2 < 1000 && x; x2++)
+		{
+			sprintf(Str, "a_long_arena_key_%d", x2);
+			x = (TestHash2.Set(Str, strlen(Str), x2) != NULL);
+		}
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.GetSize() == 1001 && TestHash2.Find("an_existing_long_key", 20) != NULL && TestHash2.Find("a_long_arena_key_999", 20) != NULL && TestHash2.GetKeyArena()->GetNumChunks() > 1);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.Unset("a_long_arena_key_5", 18) && TestHash2.Unset("an_existing_long_key", 20) && TestHash2.Find("a_long_arena_key_5", 18) == NULL);
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::PackedOrderedHash<int> TestHash3(TestHash2);
+
+		x = (TestHash3.GetSize() == 999 && TestHash3.GetKeyArena() != TestHash2.GetKeyArena() && TestHash3.Find("a_long_arena_key_999", 20) != NULL);
+		TEST_COMPARE(x, 1);
+
+		TestHash2.Empty();
+		x = (TestHash2.GetSize() == 0 && TestHash2.GetNextPos() == 0 && TestHash2.GetKeyArena()->GetNumChunks() == 0 && TestHash2.Find("a_long_arena_key_999", 20) == NULL);
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash2.Set("a_long_arena_key_1", 18, 1) != NULL && TestHash2.Find("a_long_arena_key_1", 18) != NULL);
+		TEST_COMPARE(x, 1);
+
+		TestHash3 = TestHash2;
+		x = (TestHash3.GetSize() == 1 && TestHash3.Find("a_long_arena_key_1", 18) != NULL && TestHash3.Find("a_long_arena_key_999", 20) == NULL);
+		TEST_COMPARE(x, 1);
+	}
+
+	// Incremental compaction in both index modes.
+	for (x3 = 0; x3 < 2; x3++)
+	{
+		CubicleSoft::PackedOrderedHash<int> TestHash2;
+		char Str[40];
+
+		TestHash2.SetProbeIndex(x3 == 1);
+
+		for (x2 = 0; x2 < 3000; x2++)
+		{
+			sprintf(Str, "a_long_compaction_key_%d", x2);
+			TestHash2.Set(x2, x2);
+			TestHash2.Set(Str, strlen(Str), x2);
+		}
+
+		for (x2 = 0; x2 < 3000; x2 += 2)
+		{
+			sprintf(Str, "a_long_compaction_key_%d", x2);
+			TestHash2.Unset(x2);
+			TestHash2.Unset(Str, strlen(Str));
+		}
+
+		x = (TestHash2.CompactStep(100) && TestHash2.IsCompacting() && TestHash2.GetNextPos() == 6000);
+		TEST_COMPARE(x, 1);
+
+		// Everything stays findable between steps.
+		CubicleSoft::PackedOrderedHash<int> TestHash3(TestHash2);
+		x = true;
+		while (x && TestHash2.CompactStep(500))
+		{
+			for (x2 = 1; x2 < 3000 && x; x2 += 2)  x = (TestHash2.Find(x2) != NULL && TestHash2.Find(x2)->Value == x2 && TestHash2.Find(x2 - 1) == NULL);
+		}
+		if (x)  x = (!TestHash2.IsCompacting() && TestHash2.GetNextPos() == 3000 && TestHash2.GetSize() == 3000 && !TestHash2.CompactStep(100));
+		TEST_COMPARE(x, 1);
+
+		// Order is preserved.
+		x = true;
+		Pos = TestHash2.GetNextPos();
+		for (x2 = 1; x2 < 3000 && x; x2 += 2)
+		{
+			sprintf(Str, "a_long_compaction_key_%d", x2);
+			x = ((Node = TestHash2.Next(Pos)) != NULL && Node->Value == x2 && Node->GetStrKey() == NULL && (Node = TestHash2.Next(Pos)) != NULL && Node->Value == x2 && Node->GetStrLen() == strlen(Str) && !memcmp(Node->GetStrKey(), Str, strlen(Str)));
+		}
+		if (x)  x = (TestHash2.Next(Pos) == NULL);
+		TEST_COMPARE(x, 1);
+
+		// The copy continues the pass that was in progress.
+		x = (TestHash3.IsCompacting() && TestHash3.Optimize() && !TestHash3.IsCompacting() && TestHash3.GetNextPos() == 3000 && TestHash3.Find("a_long_compaction_key_2999", 26) != NULL && TestHash3.Find("a_long_compaction_key_2998", 26) == NULL);
+		TEST_COMPARE(x, 1);
+
+		// A sliding window of keys never needs a larger array or a full compaction.
+		TestHash2.SetIncrementalCompaction(8);
+		x = (TestHash2.GetIncrementalCompaction() == 8);
+		for (x2 = 3000; x2 < 100000 && x; x2++)
+		{
+			TestHash2.Set(x2, x2);
+			if (x2 >= 5000)  x = TestHash2.Unset(x2 - 2000);
+			if (x && x2 % 1000 == 0)  x = (TestHash2.Find(x2 - 1999) != NULL && TestHash2.Find(x2 - 2000) == NULL && TestHash2.Find(2999) != NULL && TestHash2.GetHashSize() == 8192);
+		}
+		TEST_COMPARE(x, 1);
+	}
+
+	// Snapshots in both index modes.
+	for (x3 = 0; x3 < 2; x3++)
+	{
+		CubicleSoft::PackedOrderedHash<int> TestHash2, TestHash3, TestHash4(8, 12345);
+		CubicleSoft::UTF8::File TestFile;
+		const std::uint8_t *MapData;
+		size_t MapSize, Pos2;
+		char Str[40];
+
+		CubicleSoft::UTF8::File::Delete("test_snapshot.dat");
+
+		TestHash2.SetProbeIndex(x3 == 1);
+		TestHash2.UseKeyArena();
+		for (x2 = 0; x2 < 2000; x2++)
+		{
+			sprintf(Str, "a_long_snapshot_key_%d", x2);
+			TestHash2.Set(x2, x2);
+			TestHash2.Set(Str, strlen(Str), x2);
+			sprintf(Str, "key_%d", x2);
+			TestHash2.Set(Str, strlen(Str), x2);
+		}
+
+		for (x2 = 0; x2 < 2000; x2 += 3)
+		{
+			sprintf(Str, "a_long_snapshot_key_%d", x2);
+			TestHash2.Unset(x2);
+			TestHash2.Unset(Str, strlen(Str));
+		}
+
+		x = (TestFile.Open("test_snapshot.dat", O_CREAT | O_WRONLY | O_TRUNC) && TestHash2.SaveSnapshot(TestFile) && TestFile.Close());
+		TEST_COMPARE(x, 1);
+
+		// Snapshots from a different hash key or node layout or that are cut short are rejected.
+		CubicleSoft::PackedOrderedHash<int, CubicleSoft::HashFuncRuntime, true> TestHash6;
+		x = (TestFile.Open("test_snapshot.dat", O_RDONLY) && TestFile.Map(MapData, MapSize) && !TestHash4.LoadSnapshot(MapData, MapSize) && !TestHash3.LoadSnapshot(MapData, MapSize - 8) && !TestHash6.LoadSnapshot(MapData, MapSize));
+		TEST_COMPARE(x, 1);
+
+		x = (TestHash3.LoadSnapshot(MapData, MapSize) && TestHash3.IsMappedSnapshot() && TestHash3.IsProbeIndex() == (x3 == 1) && TestHash3.GetSize() == TestHash2.GetSize() && TestHash3.GetNextPos() == TestHash2.GetNextPos());
+		TEST_COMPARE(x, 1);
+
+		x = true;
+		for (x2 = 0; x2 < 2000 && x; x2++)
+		{
+			sprintf(Str, "a_long_snapshot_key_%d", x2);
+			if (x2 % 3 == 0)  x = (TestHash3.Find(x2) == NULL && TestHash3.Find(Str, strlen(Str)) == NULL);
+			else  x = (TestHash3.Find(x2) != NULL && TestHash3.Find(x2)->Value == x2 && TestHash3.Find(Str, strlen(Str)) != NULL && TestHash3.Find(Str, strlen(Str))->Value == x2);
+
+			sprintf(Str, "key_%d", x2);
+			if (x)  x = (TestHash3.Find(Str, strlen(Str)) != NULL && TestHash3.Find(Str, strlen(Str))->Value == x2);
+		}
+		TEST_COMPARE(x, 1);
+
+		// Same order and keys as the original.
+		x = true;
+		Pos = TestHash2.GetNextPos();
+		Pos2 = TestHash3.GetNextPos();
+		while (x && (Node = TestHash2.Next(Pos)) != NULL)
+		{
+			CubicleSoft::PackedOrderedHashNode<int> *Node2 = TestHash3.Next(Pos2);
+
+			x = (Node2 != NULL && Pos == Pos2 && Node2->Value == Node->Value && Node2->GetIntKey() == Node->GetIntKey() && Node2->GetStrLen() == Node->GetStrLen() && (Node->GetStrKey() == NULL ? Node2->GetStrKey() == NULL : !memcmp(Node2->GetStrKey(), Node->GetStrKey(), Node->GetStrLen())));
+		}
+		if (x)  x = (TestHash3.Next(Pos2) == NULL);
+		TEST_COMPARE(x, 1);
+
+		std::int64_t IntKeys[100];
+		CubicleSoft::PackedOrderedHashNode<int> *Results[100];
+		for (x2 = 0; x2 < 100; x2++)  IntKeys[x2] = x2 * 20;
+		x = (TestHash3.FindBatch(IntKeys, 100, Results) == 66 && Results[3] == NULL && Results[2]->Value == 40);
+		TEST_COMPARE(x, 1);
+
+		// Copies own their nodes.
+		CubicleSoft::PackedOrderedHash<int> TestHash5(TestHash3);
+		x = (!TestHash5.IsMappedSnapshot() && TestHash5.GetSize() == TestHash3.GetSize() && TestHash5.Find("a_long_snapshot_key_1999", 24)->Value == 1999 && TestHash5.Set("a_long_snapshot_key_2000", 24, 2000) != NULL);
+		TEST_COMPARE(x, 1);
+
+		// The first change copies the snapshot.
+		if (x3 == 0)  x = (TestHash3.Unset("a_long_snapshot_key_1", 21) && !TestHash3.IsMappedSnapshot() && TestHash3.Find("a_long_snapshot_key_1", 21) == NULL);
+		else  x = (TestHash3.Set("a_long_snapshot_key_2000", 24, 2000) != NULL && !TestHash3.IsMappedSnapshot() && TestHash3.Find("a_long_snapshot_key_2000", 24)->Value == 2000);
+		TEST_COMPARE(x, 1);
+
+		x = (TestFile.Close() && TestHash3.Find("a_long_snapshot_key_1999", 24)->Value == 1999 && TestHash3.Find("key_0", 5)->Value == 0 && TestHash3.Optimize() && TestHash3.Find(1999)->Value == 1999);
+		TEST_COMPARE(x, 1);
+
+		x = CubicleSoft::UTF8::File::Delete("test_snapshot.dat");
+		TEST_COMPARE(x, 1);
+	}
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
+int Test_Templates_Queue(FILE *Testfp)
+{
+	TEST_START(Test_Templates_Queue);
+
+	CubicleSoft::Queue<int> TestQueue, TestQueue2;
+	CubicleSoft::QueueNode<int> *Node;
+	bool x;
+	int x2;
+
+	for (x2 = 0; x2 < 100; x2++)  TestQueue += x2;
+
+	x = (TestQueue.GetSize() == 100);
+	TEST_COMPARE(x, 1);
+
+	while ((Node = TestQueue.Shift()) != NULL)  TestQueue2 += Node;
+
+	x = (TestQueue.GetSize() == 0);
+	TEST_COMPARE(x, 1);
+
+	x = (TestQueue2.GetSize() == 100);
+	TEST_COMPARE(x, 1);
+
+	TestQueue.DetachAllAndAppend(TestQueue2);
+
+	x = (TestQueue.GetSize() == 100);
+	TEST_COMPARE(x, 1);
+
+	x = (TestQueue2.GetSize() == 0);
+	TEST_COMPARE(x, 1);
+
+	TEST_SUMMARY();
+
+	TEST_RETURN();
+}
+
+class Test_Templates_ConcurrentQueue_Info
+{
+public:
+	CubicleSoft::ConcurrentQueue<std::uint32_t> *MxQueue;
+	CubicleSoft::ConcurrentQueueMPMC<std::uint32_t> *MxQueueMPMC;
+	CubicleSoft::QueueNode<std::uint32_t> *MxNodes;
+	std::uint32_t MxID;
+	volatile std::uint32_t *MxCount;
+};
+
+// Pushes preallocated nodes tagged with the producer ID and sequence number.
+TEST_THREAD_FUNC(Test_Templates_ConcurrentQueue_ProducerThread)
+{
+	Test_Templates_ConcurrentQueue_Info *Info = (Test_Templates_ConcurrentQueue_Info *)Data;
+
+	for (std::uint32_t x = 0; x < 10000; x++)
+	{
+		Info->MxNodes[x].Value = (Info->MxID << 24) | x;
+
+		if (Info->MxQueue != NULL)  Info->MxQueue->Push(&Info->MxNodes[x]);
+		else  Info->MxQueueMPMC->Push(&Info->MxNodes[x]);
+	}
+
+	TEST_THREAD_RETURN();
+}
+
+TEST_THREAD_FUNC(Test_Templates_ConcurrentQueue_ConsumerThread)
+{
+	Test_Templates_ConcurrentQueue_Info *Info = (Test_Templates_ConcurrentQueue_Info *)Data;
+
+	while (*Info->MxCount < 40000)
+	{
+		if (Info->MxQueueMPMC->Shift() != NULL)  CubicleSoft::Sync::Util::AtomicAdd32(Info->MxCount, 1);
+	}
+
+	TEST_THREAD_RETURN();
+}
+
+int Test_Templates_ConcurrentQueue(FILE *Testfp)
+{
+	TEST_START(Test_Templates_ConcurrentQueue);
+
+	CubicleSoft::QueueNode<std::uint32_t> *Nodes = new CubicleSoft::QueueNode<std::uint32_t>[40000];
+	CubicleSoft::QueueNode<std::uint32_t> *Node;
+	Test_Templates_ConcurrentQueue_Info Info[4];
+	TestThreadType Threads[4];
+	std::uint32_t LastSeq[4];
+	volatile std::uint32_t Count;
+	size_t x2, y;
+	bool x;
+
+	// Single thread.
+	{
+		CubicleSoft::ConcurrentQueue<std::uint32_t> TestQueue;
+		CubicleSoft::Queue<std::uint32_t> TestQueue2;
+
+		x = (TestQueue.IsEmpty() && TestQueue.Shift() == NULL);
+		TEST_COMPARE(x, 1);
+
+		for (x2 = 0; x2 < 3; x2++)  TestQueue.Push((std::uint32_t)x2);
+
+		x = (!TestQueue.IsEmpty());
+		TEST_COMPARE(x, 1);
+
+		// Nodes move to and from Queue without allocations.
+		while ((Node = TestQueue.Shift()) != NULL)  TestQueue2.Push(Node);
+
+		x = (TestQueue.IsEmpty() && TestQueue2.GetSize() == 3 && TestQueue2.First()->Value == 0 && TestQueue2.Last()->Value == 2);
+		TEST_COMPARE(x, 1);
+
+		while ((Node = TestQueue2.Shift()) != NULL)  TestQueue.Push(Node);
+
+		x = (TestQueue.Push(TestQueue.Shift()) != NULL);
+		TEST_COMPARE(x, 1);
+
+		Node = TestQueue.Shift();
+		x = (Node != NULL && Node->Value == 1 && Node->Next() == NULL);
+		TEST_COMPARE(x, 1);
+
+		delete Node;
+	}
+
+	// Multiple producers, single consumer.  Order from each producer is preserved.
+	{
+		CubicleSoft::ConcurrentQueue<std::uint32_t> TestQueue;
+
+		for (y = 0; y < 4; y++)
+		{
+			Info[y].MxQueue = &TestQueue;
+			Info[y].MxQueueMPMC = NULL;
+			Info[y].MxNodes = Nodes + y * 10000;
+			Info[y].MxID = (std::uint32_t)y;
+			LastSeq[y] = 0;
+
+			Test_StartThread(Threads[y], Test_Templates_ConcurrentQueue_ProducerThread, &Info[y]);
+		}
+
+		bool Ordered = true;
+		x2 = 0;
+		while (x2 < 40000)
+		{
+			Node = TestQueue.Shift();
+			if (Node == NULL)  continue;
+
+			y = Node->Value >> 24;
+			if ((Node->Value & 0xFFFFFF) != LastSeq[y])  Ordered = false;
+			LastSeq[y]++;
+
+			x2++;
+		}
+
+		for (y = 0; y < 4; y++)  Test_JoinThread(Threads[y]);
+
+		x = (Ordered && TestQueue.IsEmpty());
+		TEST_COMPARE(x, 1);
+	}
+
+	// Multiple producers, multiple consumers.
+	{
+		CubicleSoft::ConcurrentQueueMPMC<std::uint32_t> TestQueue;
+		TestThreadType ConsumerThreads[2];
 
-	x = (TestQueue.GetSize() == 100);
-	TEST_COMPARE(x, 1);
+		Count = 0;
+		for (y = 0; y < 4; y++)
+		{
+			Info[y].MxQueue = NULL;
+			Info[y].MxQueueMPMC = &TestQueue;
+			Info[y].MxCount = &Count;
 
-	while ((Node = TestQueue.Shift()) != NULL)  TestQueue2 += Node;
+			Test_StartThread(Threads[y], Test_Templates_ConcurrentQueue_ProducerThread, &Info[y]);
+		}
 
-	x = (TestQueue.GetSize() == 0);
-	TEST_COMPARE(x, 1);
+		for (y = 0; y < 2; y++)  Test_StartThread(ConsumerThreads[y], Test_Templates_ConcurrentQueue_ConsumerThread, &Info[0]);
 
-	x = (TestQueue2.GetSize() == 100);
-	TEST_COMPARE(x, 1);
+		while (Count < 40000)
+		{
+			if (TestQueue.TryShift() != NULL)  CubicleSoft::Sync::Util::AtomicAdd32(&Count, 1);
+		}
 
-	TestQueue.DetachAllAndAppend(TestQueue2);
+		for (y = 0; y < 4; y++)  Test_JoinThread(Threads[y]);
+		for (y = 0; y < 2; y++)  Test_JoinThread(ConsumerThreads[y]);
 
-	x = (TestQueue.GetSize() == 100);
-	TEST_COMPARE(x, 1);
+		x = (Count == 40000 && TestQueue.Shift() == NULL);
+		TEST_COMPARE(x, 1);
+	}
 
-	x = (TestQueue2.GetSize() == 0);
-	TEST_COMPARE(x, 1);
+	delete[] Nodes;
 
 	TEST_SUMMARY();
 
@@ -1104,6 +2895,20 @@ int Test_Templates_SharedLib(FILE *Testfp)
 
 #endif
 
+// Frees TLS memory allocated by another thread.
+TEST_THREAD_FUNC(Test_Sync_TLS_RemoteFreeThread)
+{
+	char **Blocks = (char **)Data;
+
+	GxSyncTLS.ThreadInit();
+
+	for (size_t x = 0; x < 10; x++)  GxSyncTLS.free(Blocks[x]);
+
+	GxSyncTLS.ThreadEnd();
+
+	TEST_THREAD_RETURN();
+}
+
 int Test_Sync_TLS(FILE *Testfp)
 {
 	TEST_START(Test_Sync_TLS);
@@ -1125,10 +2930,207 @@ int Test_Sync_TLS(FILE *Testfp)
 
 		GxSyncTLS.free(Data);
 
+		// Cross-thread free.  Blocks are returned to this thread's cache on the next malloc().
+		char *Blocks[10];
+		for (size_t y = 0; y < 10; y++)  Blocks[y] = (char *)GxSyncTLS.malloc(100);
+
+		TestThreadType Thread;
+		x = Test_StartThread(Thread, Test_Sync_TLS_RemoteFreeThread, Blocks);
+		TEST_COMPARE(x, 1);
+
+		if (x)
+		{
+			Test_JoinThread(Thread);
+
+			size_t Nodes, Size;
+			Data = (char *)GxSyncTLS.malloc(100);
+			x = (GxSyncTLS.GetBucketInfo(7, Nodes, Size) && Nodes == 9);
+			TEST_COMPARE(x, 1);
+
+			GxSyncTLS.free(Data);
+		}
+
+		// Arena.
+		size_t Nodes, Nodes2, Size;
+		GxSyncTLS.GetBucketInfo(7, Nodes, Size);
+		{
+			CubicleSoft::Sync::TLS::Arena TempArena(&GxSyncTLS);
+
+			char *Data2;
+			Data = (char *)GxSyncTLS.malloc(100);
+			GxSyncTLS.free(Data);
+			Data2 = (char *)GxSyncTLS.malloc(100);
+			x = (Data != NULL && Data2 != NULL && Data != Data2 && GxSyncTLS.GetSize(Data2) == 128);
+			TEST_COMPARE(x, 1);
+
+			Data2 = (char *)GxSyncTLS.realloc(Data2, 100000);
+			x = (Data2 != NULL);
+			TEST_COMPARE(x, 1);
+
+			GxSyncTLS.free(Data2);
+
+			x = (GxSyncTLS.GetBucketInfo(7, Nodes2, Size) && Nodes == Nodes2);
+			TEST_COMPARE(x, 1);
+		}
+
+		Data = (char *)GxSyncTLS.malloc(100);
+		x = (GxSyncTLS.GetBucketInfo(7, Nodes2, Size) && Nodes2 == Nodes - 1);
+		TEST_COMPARE(x, 1);
+
+		GxSyncTLS.free(Data);
+
 		x = GxSyncTLS.ThreadEnd();
 		TEST_COMPARE(x, 1);
 	}
 
+	// Central cache.  Thread buckets spill above the high-water mark and refill when empty.
+	CubicleSoft::Sync::TLS TempTLS(1);
+
+	x = TempTLS.ThreadInit();
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		char *Blocks[100];
+		size_t y, Nodes, Size;
+		for (y = 0; y < 100; y++)  Blocks[y] = (char *)TempTLS.malloc(100);
+		for (y = 0; y < 100; y++)  TempTLS.free(Blocks[y]);
+
+		x = (TempTLS.GetBucketInfo(7, Nodes, Size) && Nodes <= 64);
+		TEST_COMPARE(x, 1);
+
+		CubicleSoft::Sync::TLS::Stats TempStats;
+		x = (TempTLS.GetThreadStats(TempStats) && TempStats.Misses == 100 && TempStats.Frees == 100 && TempStats.CachedNodes == Nodes && TempStats.CachedHighWater == 65);
+		TEST_COMPARE(x, 1);
+
+		x = TempTLS.ThreadEnd();
+		TEST_COMPARE(x, 1);
+
+		x = TempTLS.ThreadInit();
+		TEST_COMPARE(x, 1);
+
+		Blocks[0] = (char *)TempTLS.malloc(100);
+		x = (TempTLS.GetBucketInfo(7, Nodes, Size) && Nodes == 31);
+		TEST_COMPARE(x, 1);
+
+		Blocks[1] = (char *)TempTLS.malloc(100000);
+		TempTLS.GetStats(TempStats);
+		x = (TempStats.NumThreads == 1 && TempStats.CentralHits == 1 && TempStats.Misses == 0 && TempStats.OversizedAllocs == 1 && TempStats.OversizedBytes >= 100000);
+		TEST_COMPARE(x, 1);
+
+		TempTLS.free(Blocks[1]);
+
+		TempTLS.free(Blocks[0]);
+
+		x = TempTLS.ThreadEnd();
+		TEST_COMPARE(x, 1);
+	}
+
+	// Quarter-power size classes.
+	CubicleSoft::Sync::TLS TempTLS2(1, 15, 65536, true);
+
+	x = TempTLS2.ThreadInit();
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		char *Data = (char *)TempTLS2.malloc(4097);
+		x = (TempTLS2.GetSize(Data) == 5120);
+		TEST_COMPARE(x, 1);
+
+		x = ((char *)TempTLS2.realloc(Data, 5000) == Data);
+		TEST_COMPARE(x, 1);
+
+		Data = (char *)TempTLS2.realloc(Data, 6000);
+		x = (TempTLS2.GetSize(Data) == 6144);
+		TEST_COMPARE(x, 1);
+
+		TempTLS2.free(Data);
+
+		Data = (char *)TempTLS2.malloc(8);
+		x = (TempTLS2.GetSize(Data) == 8);
+		TEST_COMPARE(x, 1);
+
+		TempTLS2.free(Data);
+
+		x = TempTLS2.ThreadEnd();
+		TEST_COMPARE(x, 1);
+	}
+
+	// Without a central cache, thread buckets keep every freed block.
+	CubicleSoft::Sync::TLS TempTLS3(0);
+
+	x = TempTLS3.ThreadInit();
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		char *Blocks[100];
+		size_t y, Nodes, Size;
+		for (y = 0; y < 100; y++)  Blocks[y] = (char *)TempTLS3.malloc(100);
+		for (y = 0; y < 100; y++)  TempTLS3.free(Blocks[y]);
+
+		x = (TempTLS3.GetBucketInfo(7, Nodes, Size) && Nodes == 100);
+		TEST_COMPARE(x, 1);
+
+		x = TempTLS3.ThreadEnd();
+		TEST_COMPARE(x, 1);
+	}
+
+	// Slabs.  Cold misses are carved from a slab one stride apart, which holds the header and the size class rounded up to pointer alignment.
+	CubicleSoft::Sync::TLS TempTLS4(1, 15, 65536);
+
+	x = TempTLS4.ThreadInit();
+	TEST_COMPARE(x, 1);
+
+	if (x)
+	{
+		char *Blocks[1000];
+		const size_t Stride = (sizeof(void *) + 1 + 128 + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+		size_t y, y2, Nodes, Size;
+		CubicleSoft::Sync::TLS::Stats TempStats;
+
+		for (y = 0; y < 1000; y++)  Blocks[y] = (char *)TempTLS4.malloc(100);
+
+		// The first 64K slab holds more than 400 blocks.
+		x = true;
+		for (y = 1; y < 400 && x; y++)  x = (Blocks[y] == Blocks[y - 1] + Stride);
+		TEST_COMPARE(x, 1);
+
+		x = (TempTLS4.GetThreadStats(TempStats) && TempStats.Misses == 1000 && TempStats.Hits == 0 && TempStats.CachedNodes == 0);
+		TEST_COMPARE(x, 1);
+
+		// Freed slab blocks round-trip through the thread cache.
+		TempTLS4.free(Blocks[999]);
+		TempTLS4.free(Blocks[998]);
+		x = ((char *)TempTLS4.malloc(100) == Blocks[999] && (char *)TempTLS4.malloc(100) == Blocks[998]);
+		TEST_COMPARE(x, 1);
+
+		// The thread cache spills the extra blocks to the central cache and refills from it.  Slab blocks are never freed, so no new blocks are needed.
+		for (y = 0; y < 1000; y++)  TempTLS4.free(Blocks[y]);
+
+		x = (TempTLS4.GetBucketInfo(7, Nodes, Size) && Nodes > 0 && Nodes <= 64 && Size == Nodes * 128 && TempTLS4.GetThreadStats(TempStats) && TempStats.CachedNodes == Nodes);
+		TEST_COMPARE(x, 1);
+
+		for (y = 0; y < 1000; y++)  Blocks[y] = (char *)TempTLS4.malloc(100);
+
+		x = (TempTLS4.GetBucketInfo(7, Nodes, Size) && TempTLS4.GetThreadStats(TempStats) && TempStats.Misses == 1000 && TempStats.Hits + TempStats.CentralHits == 1002 && TempStats.CentralHits > 0 && TempStats.CachedNodes == Nodes && Size == Nodes * 128);
+		TEST_COMPARE(x, 1);
+
+		// Every block is still a distinct slab block.
+		x = true;
+		for (y = 0; y < 1000 && x; y++)
+		{
+			for (y2 = y + 1; y2 < 1000 && x; y2++)  x = (Blocks[y] != Blocks[y2]);
+		}
+		TEST_COMPARE(x, 1);
+
+		for (y = 0; y < 1000; y++)  TempTLS4.free(Blocks[y]);
+
+		x = TempTLS4.ThreadEnd();
+		TEST_COMPARE(x, 1);
+	}
+
 	TEST_SUMMARY();
 
 	TEST_RETURN();
@@ -1349,6 +3351,18 @@ int Test_UTF8_File(FILE *Testfp)
 	x = TestFile.Close();
 	TEST_COMPARE(x, 1);
 
+	const std::uint8_t *MapData, *MapData2;
+	size_t MapSize;
+
+	x = (TestFile.Open("test.txt", O_RDONLY) && TestFile.Map(MapData, MapSize));
+	TEST_COMPARE(x, 1);
+
+	x = (MapSize == strlen(Str) && !memcmp(MapData, Str, MapSize) && TestFile.Map(MapData2, MapSize) && MapData2 == MapData);
+	TEST_COMPARE(x, 1);
+
+	x = (TestFile.Unmap() && TestFile.Close());
+	TEST_COMPARE(x, 1);
+
 	x = CubicleSoft::UTF8::File::GetAbsoluteFilename(Data, 4096, NULL, "test.txt");
 	TEST_COMPARE(x, 1);
 
@@ -1568,6 +3582,62 @@ int Test_JSON_Serialize(FILE *Testfp)
 	TEST_RETURN();
 }
 
+// Collects per-operation times for the hashlatency benchmark with 100 nanosecond resolution up to 10 milliseconds.
+class Test_LatencyHistogram
+{
+public:
+	Test_LatencyHistogram() : MxSlots(new std::uint32_t[100001]), MxNum(0), MxTotal(0), MxMax(0)
+	{
+		for (size_t x = 0; x <= 100000; x++)  MxSlots[x] = 0;
+	}
+
+	~Test_LatencyHistogram()
+	{
+		delete[] MxSlots;
+	}
+
+	inline void Add(std::uint64_t DiffNS)
+	{
+		MxSlots[DiffNS < 10000000 ? DiffNS / 100 : 100000]++;
+		MxNum++;
+		MxTotal += DiffNS;
+		if (MxMax < DiffNS)  MxMax = DiffNS;
+	}
+
+	void Print()
+	{
+		char Num[100];
+		const char *Names[3] = { "p50", "p99", "p99.9" };
+		const std::uint64_t Nums[3] = { MxNum * 50 / 100, MxNum * 99 / 100, MxNum * 999 / 1000 };
+		std::uint64_t y = 0;
+		size_t x, x2 = 0;
+
+		CubicleSoft::Convert::Int::ToString(Num, 100, MxTotal / 1000000, ',');
+		printf("\tTotal - %s ms\n", Num);
+
+		for (x = 0; x <= 100000 && x2 < 3; x++)
+		{
+			y += MxSlots[x];
+			for (; x2 < 3 && y > Nums[x2]; x2++)
+			{
+				CubicleSoft::Convert::Int::ToString(Num, 100, (std::uint64_t)(x < 100000 ? (x + 1) * 100 : MxMax), ',');
+				printf("\t%s - %s ns\n", Names[x2], Num);
+			}
+		}
+
+		CubicleSoft::Convert::Int::ToString(Num, 100, MxMax / 1000, ',');
+		printf("\tMax - %s us\n\n", Num);
+	}
+
+private:
+	// Deny copy constructor and assignment operator.  Use a (smart) pointer instead.
+	Test_LatencyHistogram(const Test_LatencyHistogram &);
+	Test_LatencyHistogram &operator=(const Test_LatencyHistogram &);
+
+	std::uint32_t *MxSlots;
+	std::uint64_t MxNum, MxTotal, MxMax;
+};
+
 #pragma optimize("", off)
 #pragma GCC push_options
 #pragma GCC optimize("O0")
@@ -1582,12 +3652,19 @@ int main(int argc, char **argv)
 		Test_Sync_Mutex(stdout);
 		Test_Sync_Semaphore(stdout);
 		Test_Sync_ReadWriteLock(stdout);
+		Test_Sync_SeqLock(stdout);
 		Test_Sync_SharedMem(stdout);
+		Test_Sync_RingBuffer(stdout);
+		Test_Sync_WaitMultiple(stdout);
+		Test_Sync_ThreadPool(stdout);
+		Test_Sync_ConcurrentOrderedHash(stdout);
 		Test_Templates_Cache(stdout);
+		Test_Templates_ChunkArena(stdout);
 		Test_Templates_List(stdout);
 		Test_Templates_OrderedHash(stdout);
 		Test_Templates_PackedOrderedHash(stdout);
 		Test_Templates_Queue(stdout);
+		Test_Templates_ConcurrentQueue(stdout);
 		Test_Templates_StaticVector(stdout);
 		Test_Templates_Static2DArray(stdout);
 		Test_Templates_StaticMixedVar(stdout);
@@ -1776,6 +3853,166 @@ int main(int argc, char **argv)
 
 		printf("\n\n");
 	}
+	else if (!strcmp("synctlssizes", argv[1]))
+	{
+		printf("Sync::TLS size class benchmark\n");
+		printf("------------------------------\n");
+
+		for (int Mode = 0; Mode < 2; Mode++)
+		{
+			CubicleSoft::Sync::TLS TempTLS(8, 15, 65536, (Mode == 1));
+
+			if (TempTLS.ThreadInit())
+			{
+				char BytesUsed[100], BytesReserved[100];
+				char *Data[100];
+				std::uint32_t x;
+				std::uint64_t Requested, Reserved;
+				size_t y, y2;
+
+				printf("Running random Sync::TLS %s speed test...", (Mode == 1 ? "quarter-power size class" : "power of two size class"));
+				x = 0;
+				y = 0;
+				Requested = 0;
+				Reserved = 0;
+				srand(0);
+				time_t t1 = time(NULL);
+				while (time(NULL) == t1)  {}
+				t1 = time(NULL) + 3;
+				while (t1 > time(NULL))
+				{
+					y2 = (rand() & 0x7FFF) + 1;
+					Data[y] = (char *)TempTLS.malloc(y2);
+					Requested += y2;
+					Reserved += TempTLS.GetSize(Data[y]);
+					y++;
+					if (y == 100)
+					{
+						while (y)  TempTLS.free(Data[--y]);
+					}
+
+					x++;
+				}
+
+				printf("done.\n");
+				CubicleSoft::Convert::Int::ToString(BytesUsed, 100, (std::uint64_t)(x / 3), ',');
+				printf("\tRate:  %s allocation/free pairs/sec\n", BytesUsed);
+
+				while (y)  TempTLS.free(Data[--y]);
+
+				CubicleSoft::Convert::Int::ToString(BytesUsed, 100, Requested / x, ',');
+				CubicleSoft::Convert::Int::ToString(BytesReserved, 100, Reserved / x, ',');
+				printf("\tAverage bytes requested:  %s\n", BytesUsed);
+				printf("\tAverage bytes reserved:  %s (%u%% overhead)\n\n", BytesReserved, (unsigned int)((Reserved - Requested) * 100 / Requested));
+
+				TempTLS.ThreadEnd();
+			}
+		}
+
+		printf("\n");
+	}
+	else if (!strcmp("rwlock", argv[1]))
+	{
+		printf("Sync::ReadWriteLock reader scalability benchmark\n");
+		printf("------------------------------------------------\n");
+
+		CubicleSoft::Sync::ReadWriteLock TempLock;
+		Test_Sync_ReadWriteLock_BenchInfo Info[16];
+		TestThreadType Threads[16];
+		char LocksDone[100];
+		std::uint64_t Total;
+		size_t x, y;
+
+		if (TempLock.Create())
+		{
+			for (x = 1; x <= 16; x *= 2)
+			{
+				printf("Running %u reader thread(s)...", (unsigned int)x);
+
+				time_t t1 = time(NULL);
+				while (time(NULL) == t1)  {}
+				t1 = time(NULL) + 3;
+				for (y = 0; y < x; y++)
+				{
+					Info[y].MxLock = &TempLock;
+					Info[y].MxEndTime = t1;
+					Info[y].MxCount = 0;
+
+					if (!Test_StartThread(Threads[y], Test_Sync_ReadWriteLock_BenchThread, &Info[y]))  break;
+				}
+
+				Total = 0;
+				while (y)
+				{
+					y--;
+					Test_JoinThread(Threads[y]);
+					Total += Info[y].MxCount;
+				}
+
+				printf("done.\n");
+				CubicleSoft::Convert::Int::ToString(LocksDone, 100, Total / 3, ',');
+				printf("\tRate:  %s read lock/unlock pairs/sec\n\n", LocksDone);
+			}
+		}
+
+		printf("\n");
+	}
+	else if (!strcmp("threadpool", argv[1]))
+	{
+		printf("Sync::ThreadPool task throughput benchmark\n");
+		printf("------------------------------------------\n");
+
+		CubicleSoft::Sync::ThreadPool TempPool;
+		void *DataArray[1000];
+		std::uint32_t *Values = new std::uint32_t[1000000];
+		std::uint64_t StartTime;
+		size_t x, NumThreads;
+
+		memset(DataArray, 0, sizeof(DataArray));
+
+		for (NumThreads = 1; NumThreads <= 16; NumThreads *= 2)
+		{
+			if (!TempPool.Start(NumThreads))  break;
+
+			printf("%u worker thread(s)\n", (unsigned int)NumThreads);
+
+			printf("\tSubmit() 1,000,000 empty tasks from the main thread...");
+			StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+			for (x = 0; x < 1000000; x++)  TempPool.Submit(Test_Sync_ThreadPool_EmptyTask, NULL);
+			TempPool.WaitIdle();
+			Test_Sync_ThreadPool_PrintRate("tasks", 1000000, CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime);
+
+			printf("\tSubmitBatch() 1,000 x 1,000 empty tasks from the main thread...");
+			StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+			for (x = 0; x < 1000; x++)  TempPool.SubmitBatch(Test_Sync_ThreadPool_EmptyTask, DataArray, 1000);
+			TempPool.WaitIdle();
+			Test_Sync_ThreadPool_PrintRate("tasks", 1000000, CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime);
+
+			printf("\tSubmit() 1,000 x 1,000 empty tasks from inside workers...");
+			StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+			for (x = 0; x < 1000; x++)  TempPool.Submit(Test_Sync_ThreadPool_BenchSpawnTask, &TempPool);
+			TempPool.WaitIdle();
+			Test_Sync_ThreadPool_PrintRate("tasks", 1001000, CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime);
+
+			printf("\tParallelFor() 1,000 x 1,000,000 elements in 10,000 element chunks...");
+			StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+			for (x = 0; x < 1000; x++)  TempPool.ParallelFor(1000000, 10000, Test_Sync_ThreadPool_BenchRange, Values);
+			Test_Sync_ThreadPool_PrintRate("chunks", 100000, CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime);
+
+			CubicleSoft::Sync::ThreadPool::Stats TempStats;
+			char Stolen[100], Executed[100];
+			TempPool.GetStats(TempStats);
+			CubicleSoft::Convert::Int::ToString(Stolen, 100, TempStats.Stolen, ',');
+			CubicleSoft::Convert::Int::ToString(Executed, 100, TempStats.Executed, ',');
+			printf("\tStolen:  %s of %s tasks\n\n", Stolen, Executed);
+
+			TempPool.Stop();
+		}
+
+		delete[] Values;
+
+		printf("\n");
+	}
 	else if (!strcmp("hashkey", argv[1]))
 	{
 		printf("Hash key comparison benchmark\n");
@@ -1978,32 +4215,81 @@ int main(int argc, char **argv)
 				x++;
 			}
 
-			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
-			printf("\n\tInteger keys, SipHash hash keys - %s nodes added/sec", NumNodes);
-		}
-
-		{
-			// String keys (raw bytes of the integer implanted into the hash), SipHash hash keys.
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
+			printf("\n\tInteger keys, SipHash hash keys - %s nodes added/sec", NumNodes);
+		}
+
+		{
+			// String keys (raw bytes of the integer implanted into the hash), SipHash hash keys.
+			x = 0;
+			time_t t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			char Str[30] = {0};
+			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3, 0, 0);
+			while (t1 > time(NULL))
+			{
+				((std::uint32_t *)Str)[5] = x;
+				TempHash.Push(Str, 30, x);
+
+				x++;
+			}
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
+			printf("\n\tString keys, SipHash hash keys - %s nodes added/sec", NumNodes);
+		}
+
+		{
+			// Integer keys, djb2 hash keys, detach/reattach performance.
+			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3);
+			CubicleSoft::OrderedHashNode<std::uint32_t> *Node;
+			for (x = 0; x < 1000000; x++)  TempHash.Push(x, x);
+
+			x = 0;
+			time_t t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			while (t1 > time(NULL))
+			{
+				Node = TempHash.Shift(false);
+				TempHash.Push(Node);
+
+				x++;
+			}
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
+			printf("\n\tInteger keys, detach/attach performance - %s nodes/sec", NumNodes);
+		}
+
+		{
+			// String keys, djb2 hash keys, detach/reattach performance.
+			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3);
+			CubicleSoft::OrderedHashNode<std::uint32_t> *Node;
+			char Str[30] = {0};
+			for (x = 0; x < 1000000; x++)
+			{
+				((std::uint32_t *)Str)[5] = x;
+				TempHash.Push(Str, 30, x);
+			}
+
 			x = 0;
 			time_t t1 = time(NULL);
 			while (time(NULL) == t1)  {}
 			t1 = time(NULL) + 3;
-			char Str[30] = {0};
-			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3, 0, 0);
 			while (t1 > time(NULL))
 			{
-				((std::uint32_t *)Str)[5] = x;
-				TempHash.Push(Str, 30, x);
+				Node = TempHash.Shift(false);
+				TempHash.Push(Node);
 
 				x++;
 			}
 
 			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
-			printf("\n\tString keys, SipHash hash keys - %s nodes added/sec", NumNodes);
+			printf("\n\tString keys, detach/attach performance - %s nodes/sec", NumNodes);
 		}
 
 		{
-			// Integer keys, djb2 hash keys, detach/reattach performance.
+			// Integer keys, djb2 hash keys, find performance.
 			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3);
 			CubicleSoft::OrderedHashNode<std::uint32_t> *Node;
 			for (x = 0; x < 1000000; x++)  TempHash.Push(x, x);
@@ -2014,18 +4300,18 @@ int main(int argc, char **argv)
 			t1 = time(NULL) + 3;
 			while (t1 > time(NULL))
 			{
-				Node = TempHash.Shift(false);
-				TempHash.Push(Node);
+				Node = TempHash.Find(rand() % 1000000);
+				if (Node == NULL)  printf("Unable to find node!\n");
 
 				x++;
 			}
 
 			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
-			printf("\n\tInteger keys, detach/attach performance - %s nodes/sec", NumNodes);
+			printf("\n\tInteger keys, find performance (1 million nodes) - %s nodes/sec", NumNodes);
 		}
 
 		{
-			// String keys, djb2 hash keys, detach/reattach performance.
+			// String keys, djb2 hash keys, find performance.
 			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3);
 			CubicleSoft::OrderedHashNode<std::uint32_t> *Node;
 			char Str[30] = {0};
@@ -2041,19 +4327,20 @@ int main(int argc, char **argv)
 			t1 = time(NULL) + 3;
 			while (t1 > time(NULL))
 			{
-				Node = TempHash.Shift(false);
-				TempHash.Push(Node);
+				((std::uint32_t *)Str)[5] = rand() % 1000000;
+				Node = TempHash.Find(Str, 30);
+				if (Node == NULL)  printf("Unable to find node!\n");
 
 				x++;
 			}
 
 			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
-			printf("\n\tString keys, detach/attach performance - %s nodes/sec", NumNodes);
+			printf("\n\tString keys, find performance (1 million nodes) - %s nodes/sec", NumNodes);
 		}
 
 		{
-			// Integer keys, djb2 hash keys, find performance.
-			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3);
+			// Integer keys, wyhash style hash keys with power of two masking, find performance.
+			CubicleSoft::OrderedHash<std::uint32_t, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncWyHash, CubicleSoft::OrderedHashBucketMask> > TempHash(3);
 			CubicleSoft::OrderedHashNode<std::uint32_t> *Node;
 			for (x = 0; x < 1000000; x++)  TempHash.Push(x, x);
 
@@ -2070,12 +4357,12 @@ int main(int argc, char **argv)
 			}
 
 			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
-			printf("\n\tInteger keys, find performance (1 million nodes) - %s nodes/sec", NumNodes);
+			printf("\n\tInteger keys, HashFuncWyHash + OrderedHashBucketMask policy, find performance (1 million nodes) - %s nodes/sec", NumNodes);
 		}
 
 		{
-			// String keys, djb2 hash keys, find performance.
-			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3);
+			// String keys, wyhash style hash keys with power of two masking, find performance.
+			CubicleSoft::OrderedHash<std::uint32_t, CubicleSoft::OrderedHashPolicy<CubicleSoft::HashFuncWyHash, CubicleSoft::OrderedHashBucketMask> > TempHash(3);
 			CubicleSoft::OrderedHashNode<std::uint32_t> *Node;
 			char Str[30] = {0};
 			for (x = 0; x < 1000000; x++)
@@ -2098,7 +4385,7 @@ int main(int argc, char **argv)
 			}
 
 			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
-			printf("\n\tString keys, find performance (1 million nodes) - %s nodes/sec", NumNodes);
+			printf("\n\tString keys, HashFuncWyHash + OrderedHashBucketMask policy, find performance (1 million nodes) - %s nodes/sec", NumNodes);
 		}
 
 		printf("\n\n");
@@ -2231,8 +4518,400 @@ int main(int argc, char **argv)
 			printf("\n\tString keys, find performance (1 million nodes) - %s nodes/sec", NumNodes);
 		}
 
+		{
+			// Short string keys (stored inline in the node with InlineKeys), djb2 hash keys, find performance.
+			CubicleSoft::PackedOrderedHash<std::uint32_t, CubicleSoft::HashFuncRuntime, true> TempHash(3);
+			CubicleSoft::PackedOrderedHashNode<std::uint32_t, true> *Node;
+			char Str[12] = {0};
+			for (x = 0; x < 1000000; x++)
+			{
+				((std::uint32_t *)Str)[1] = x;
+				TempHash.Set(Str, 12, x);
+			}
+
+			x = 0;
+			time_t t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			while (t1 > time(NULL))
+			{
+				((std::uint32_t *)Str)[1] = rand() % 1000000;
+				Node = TempHash.Find(Str, 12);
+				if (Node == NULL)  printf("Unable to find node!\n");
+
+				x++;
+			}
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
+			printf("\n\tShort string keys (InlineKeys), find performance (1 million nodes) - %s nodes/sec", NumNodes);
+		}
+
+		{
+			// Integer keys, djb2 hash keys, probe index find performance.
+			CubicleSoft::PackedOrderedHash<std::uint32_t> TempHash(3);
+			CubicleSoft::PackedOrderedHashNode<std::uint32_t> *Node;
+			TempHash.SetProbeIndex(true);
+			for (x = 0; x < 1000000; x++)  TempHash.Set(x, x);
+
+			x = 0;
+			time_t t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			while (t1 > time(NULL))
+			{
+				Node = TempHash.Find(rand() % 1000000);
+				if (Node == NULL)  printf("Unable to find node!\n");
+
+				x++;
+			}
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
+			printf("\n\tInteger keys, probe index find performance (1 million nodes) - %s nodes/sec", NumNodes);
+		}
+
+		{
+			// String keys, djb2 hash keys, probe index find performance.
+			CubicleSoft::PackedOrderedHash<std::uint32_t> TempHash(3);
+			CubicleSoft::PackedOrderedHashNode<std::uint32_t> *Node;
+			char Str[30] = {0};
+			TempHash.SetProbeIndex(true);
+			for (x = 0; x < 1000000; x++)
+			{
+				((std::uint32_t *)Str)[5] = x;
+				TempHash.Set(Str, 30, x);
+			}
+
+			x = 0;
+			time_t t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			while (t1 > time(NULL))
+			{
+				((std::uint32_t *)Str)[5] = rand() % 1000000;
+				Node = TempHash.Find(Str, 30);
+				if (Node == NULL)  printf("Unable to find node!\n");
+
+				x++;
+			}
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
+			printf("\n\tString keys, probe index find performance (1 million nodes) - %s nodes/sec", NumNodes);
+		}
+
+		{
+			// Integer keys, wyhash style hash keys, find performance.
+			CubicleSoft::PackedOrderedHash<std::uint32_t, CubicleSoft::HashFuncWyHash> TempHash(3);
+			CubicleSoft::PackedOrderedHashNode<std::uint32_t> *Node;
+			for (x = 0; x < 1000000; x++)  TempHash.Set(x, x);
+
+			x = 0;
+			time_t t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			while (t1 > time(NULL))
+			{
+				Node = TempHash.Find(rand() % 1000000);
+				if (Node == NULL)  printf("Unable to find node!\n");
+
+				x++;
+			}
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
+			printf("\n\tInteger keys, HashFuncWyHash policy, find performance (1 million nodes) - %s nodes/sec", NumNodes);
+		}
+
+		{
+			// Integer keys, identity hash keys, find performance.
+			CubicleSoft::PackedOrderedHash<std::uint32_t, CubicleSoft::HashFuncIdentity> TempHash(3);
+			CubicleSoft::PackedOrderedHashNode<std::uint32_t> *Node;
+			for (x = 0; x < 1000000; x++)  TempHash.Set(x, x);
+
+			x = 0;
+			time_t t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			while (t1 > time(NULL))
+			{
+				Node = TempHash.Find(rand() % 1000000);
+				if (Node == NULL)  printf("Unable to find node!\n");
+
+				x++;
+			}
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x / 3), ',');
+			printf("\n\tInteger keys, HashFuncIdentity policy, find performance (1 million nodes) - %s nodes/sec", NumNodes);
+		}
+
+		printf("\n\n");
+
+		printf("Running Sync::ConcurrentOrderedHash thread scalability tests...");
+
+		{
+			// Integer keys, djb2 hash keys.  One shard is a single OrderedHash behind one reader/writer lock.
+			Test_Sync_ConcurrentOrderedHash_Info Info[16];
+			TestThreadType Threads[16];
+			std::uint64_t StartTime, Total;
+			size_t NumShards, NumThreads, y;
+
+			for (NumShards = 1; NumShards <= 64; NumShards *= 64)
+			{
+				for (NumThreads = 1; NumThreads <= 16; NumThreads *= 2)
+				{
+					CubicleSoft::Sync::ConcurrentOrderedHash<std::uint32_t> TempHash(NumShards, 1000000);
+
+					// Insert 1 million keys split across the threads.
+					StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+					for (y = 0; y < NumThreads; y++)
+					{
+						Info[y].MxHash = &TempHash;
+						Info[y].MxStart = (std::uint32_t)(y * (1000000 / NumThreads));
+						Info[y].MxNum = (std::uint32_t)(y < NumThreads - 1 ? 1000000 / NumThreads : 1000000 - Info[y].MxStart);
+
+						if (!Test_StartThread(Threads[y], Test_Sync_ConcurrentOrderedHash_BenchInsertThread, &Info[y]))  break;
+					}
+
+					while (y)
+					{
+						y--;
+						Test_JoinThread(Threads[y]);
+					}
+
+					Total = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime;
+					if (!Total)  Total = 1;
+					CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(1000000ULL * 1000000000ULL / Total), ',');
+					printf("\n\t%u shard(s), %u thread(s) - %s nodes added/sec", (unsigned int)TempHash.GetNumShards(), (unsigned int)NumThreads, NumNodes);
+
+					// Find keys for 3 seconds.
+					time_t t1 = time(NULL);
+					while (time(NULL) == t1)  {}
+					t1 = time(NULL) + 3;
+					for (y = 0; y < NumThreads; y++)
+					{
+						Info[y].MxStart = (std::uint32_t)y;
+						Info[y].MxNum = 1000000;
+						Info[y].MxEndTime = t1;
+						Info[y].MxCount = 0;
+
+						if (!Test_StartThread(Threads[y], Test_Sync_ConcurrentOrderedHash_BenchFindThread, &Info[y]))  break;
+					}
+
+					Total = 0;
+					while (y)
+					{
+						y--;
+						Test_JoinThread(Threads[y]);
+						Total += Info[y].MxCount;
+					}
+
+					CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(Total / 3), ',');
+					printf(", %s nodes found/sec", NumNodes);
+				}
+			}
+		}
+
 		printf("\n\n");
 	}
+	else if (!strcmp("hashbatch", argv[1]))
+	{
+		printf("Batched hash lookup benchmark\n");
+		printf("-----------------------------\n");
+
+		// The default of 16 million nodes is far larger than most last level caches.
+		char NumNodes[100];
+		std::uint32_t x, x2, y, Mode, MaxNodes = (std::uint32_t)(argc > 2 ? atoi(argv[2]) : 16) * 1000000;
+		const std::uint32_t NumLookups = 1048576;
+		std::int64_t *IntKeys = new std::int64_t[NumLookups];
+		char *StrKeyData = new char[NumLookups * 12];
+		const char **StrKeys = new const char *[NumLookups];
+		size_t *StrLens = new size_t[NumLookups];
+		CubicleSoft::PackedOrderedHashNode<std::uint32_t> *Results[256];
+		char Str[12] = {0};
+
+		memset(StrKeyData, 0, NumLookups * 12);
+		for (x = 0; x < NumLookups; x++)
+		{
+			y = (std::uint32_t)((((std::uint64_t)rand() << 16) ^ (std::uint64_t)rand()) % MaxNodes);
+			IntKeys[x] = y;
+
+			memcpy(StrKeyData + x * 12 + 4, &y, sizeof(std::uint32_t));
+			StrKeys[x] = StrKeyData + x * 12;
+			StrLens[x] = 12;
+		}
+
+		for (Mode = 0; Mode < 4; Mode++)
+		{
+			CubicleSoft::PackedOrderedHash<std::uint32_t> TempHash(MaxNodes);
+
+			TempHash.SetProbeIndex(Mode >= 2);
+
+			printf("Building %s hash (%s, %u million nodes)...", (Mode & 1 ? "short string key" : "integer key"), (Mode >= 2 ? "probe index" : "hash chains"), (unsigned int)(MaxNodes / 1000000));
+			for (x = 0; x < MaxNodes; x++)
+			{
+				if (!(Mode & 1))  TempHash.Set(x, x);
+				else
+				{
+					memcpy(Str + 4, &x, sizeof(std::uint32_t));
+					TempHash.Set(Str, 12, x);
+				}
+			}
+
+			// Scalar Find().
+			x = 0;
+			x2 = 0;
+			time_t t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			while (t1 > time(NULL))
+			{
+				for (y = 0; y < 256; y++)
+				{
+					if ((Mode & 1 ? TempHash.Find(StrKeys[x + y], StrLens[x + y]) : TempHash.Find(IntKeys[x + y])) != NULL)  x2++;
+				}
+
+				x = (x + 256) & (NumLookups - 1);
+			}
+
+			if (x2 % 256)  printf("Unable to find node!\n");
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x2 / 3), ',');
+			printf("\n\tFind() - %s nodes/sec", NumNodes);
+
+			// FindBatch() with 256 keys per call.
+			x = 0;
+			x2 = 0;
+			t1 = time(NULL);
+			while (time(NULL) == t1)  {}
+			t1 = time(NULL) + 3;
+			while (t1 > time(NULL))
+			{
+				x2 += (std::uint32_t)(Mode & 1 ? TempHash.FindBatch(StrKeys + x, StrLens + x, 256, Results) : TempHash.FindBatch(IntKeys + x, 256, Results));
+
+				x = (x + 256) & (NumLookups - 1);
+			}
+
+			if (x2 % 256)  printf("Unable to find node!\n");
+
+			CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)(x2 / 3), ',');
+			printf("\n\tFindBatch() - %s nodes/sec\n\n", NumNodes);
+		}
+
+		delete[] StrLens;
+		delete[] StrKeys;
+		delete[] StrKeyData;
+		delete[] IntKeys;
+	}
+	else if (!strcmp("hashlatency", argv[1]))
+	{
+		printf("Hash latency benchmark\n");
+		printf("----------------------\n");
+
+		char NumNodes[100];
+		std::uint32_t x, Mode, MaxNodes = (std::uint32_t)(argc > 2 ? atoi(argv[2]) : 10) * 1000000;
+		std::uint64_t StartTime;
+
+		CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)MaxNodes, ',');
+
+		for (Mode = 0; Mode < 2; Mode++)
+		{
+			// Freeing the previous run's nodes leaves the allocator with cleanup work that the first larger allocation would pay for.
+			delete[] (new char[65536]);
+
+			Test_LatencyHistogram Histogram;
+			CubicleSoft::OrderedHash<std::uint32_t> TempHash(3);
+
+			if (Mode)  TempHash.SetIncrementalResize(16);
+
+			printf("OrderedHash, %s resize, %s integer keys inserted:\n", (Mode ? "incremental (16 buckets/insert)" : "full"), NumNodes);
+			for (x = 0; x < MaxNodes; x++)
+			{
+				StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+				TempHash.Push(x, x);
+				Histogram.Add(CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime);
+			}
+
+			Histogram.Print();
+		}
+
+		for (Mode = 0; Mode < 2; Mode++)
+		{
+			// A sliding window of keys:  Each new key is set and the oldest key is unset, which leaves a growing run of unset nodes at the start of the array.
+			Test_LatencyHistogram Histogram;
+			CubicleSoft::PackedOrderedHash<std::uint32_t> TempHash(MaxNodes);
+
+			if (Mode)  TempHash.SetIncrementalCompaction(16);
+
+			for (x = 0; x < MaxNodes; x++)  TempHash.Set(x, x);
+
+			printf("PackedOrderedHash, %s compaction, %s integer keys set and unset:\n", (Mode ? "incremental (16 nodes/operation)" : "full"), NumNodes);
+			for (x = 0; x < MaxNodes; x++)
+			{
+				StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+				TempHash.Set(x + MaxNodes, x);
+				Histogram.Add(CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime);
+
+				StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+				TempHash.Unset(x);
+				Histogram.Add(CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime);
+			}
+
+			Histogram.Print();
+		}
+	}
+	else if (!strcmp("hashsnapshot", argv[1]))
+	{
+		printf("Hash snapshot benchmark\n");
+		printf("-----------------------\n");
+
+		char NumNodes[100], Str[12] = {0};
+		std::uint32_t x, x2, Mode, MaxNodes = (std::uint32_t)(argc > 2 ? atoi(argv[2]) : 10) * 1000000;
+		std::uint64_t StartTime;
+		const std::uint8_t *MapData;
+		size_t MapSize;
+
+		CubicleSoft::Convert::Int::ToString(NumNodes, 100, (std::uint64_t)MaxNodes, ',');
+
+		for (Mode = 0; Mode < 2; Mode++)
+		{
+			// The file outlives the loaded hash.
+			CubicleSoft::UTF8::File TempFile;
+			CubicleSoft::PackedOrderedHash<std::uint32_t> TempHash(8), TempHash2(8);
+
+			TempHash.SetProbeIndex(Mode == 1);
+
+			printf("PackedOrderedHash (%s), %s short string keys:\n", (Mode ? "probe index" : "hash chains"), NumNodes);
+
+			StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+			for (x = 0; x < MaxNodes; x++)
+			{
+				memcpy(Str + 4, &x, sizeof(std::uint32_t));
+				TempHash.Set(Str, 12, x);
+			}
+			printf("\tBuild with Set() - %u ms\n", (unsigned int)((CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime) / 1000000));
+
+			CubicleSoft::UTF8::File::Delete("test_snapshot.dat");
+			StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+			if (!TempFile.Open("test_snapshot.dat", O_CREAT | O_WRONLY | O_TRUNC) || !TempHash.SaveSnapshot(TempFile) || !TempFile.Close())  printf("Unable to save snapshot!\n");
+			printf("\tSaveSnapshot() - %u ms\n", (unsigned int)((CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime) / 1000000));
+
+			StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+			if (!TempFile.Open("test_snapshot.dat", O_RDONLY) || !TempFile.Map(MapData, MapSize) || !TempHash2.LoadSnapshot(MapData, MapSize))  printf("Unable to load snapshot!\n");
+			printf("\tMap() + LoadSnapshot() - %u ms\n", (unsigned int)((CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime) / 1000000));
+
+			// The first lookups fault in the pages of the file.
+			x2 = 0;
+			StartTime = CubicleSoft::Sync::Util::GetMonotonicNanosecondTime();
+			for (x = 0; x < MaxNodes; x++)
+			{
+				memcpy(Str + 4, &x, sizeof(std::uint32_t));
+				if (TempHash2.Find(Str, 12) != NULL)  x2++;
+			}
+			printf("\tFind() every key in the snapshot - %u ms\n\n", (unsigned int)((CubicleSoft::Sync::Util::GetMonotonicNanosecondTime() - StartTime) / 1000000));
+
+			if (x2 != MaxNodes)  printf("Unable to find node!\n");
+		}
+
+		CubicleSoft::UTF8::File::Delete("test_snapshot.dat");
+	}
 	else if (!strcmp("server", argv[1]))
 	{
 /*
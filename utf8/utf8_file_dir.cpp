@@ -41,7 +41,7 @@ namespace CubicleSoft
 	#define SYMBOLIC_LINK_FLAG_DIRECTORY   0x1
 #endif
 
-		File::File() : MxFile(NULL), MxRead(false), MxWrite(false), MxCurrPos(0), MxMaxPos(0)
+		File::File() : MxFile(NULL), MxRead(false), MxWrite(false), MxCurrPos(0), MxMaxPos(0), MxMapData(NULL), MxMapSize(0)
 		{
 		}
 
@@ -214,8 +214,48 @@ namespace CubicleSoft
 			return true;
 		}
 
+		bool File::Map(const std::uint8_t *&Data, size_t &DataSize)
+		{
+			if (MxFile == NULL || !MxRead)  return false;
+
+			if (MxMapData == NULL)
+			{
+				UpdateMaxPos();
+				if (!MxMaxPos || MxMaxPos > (std::uint64_t)(size_t)-1)  return false;
+
+				HANDLE MapHandle = ::CreateFileMappingW(MxFile, NULL, PAGE_READONLY, 0, 0, NULL);
+				if (MapHandle == NULL)  return false;
+
+				// The view keeps the file mapping object alive.
+				MxMapData = ::MapViewOfFile(MapHandle, FILE_MAP_READ, 0, 0, 0);
+				::CloseHandle(MapHandle);
+				if (MxMapData == NULL)  return false;
+
+				MxMapSize = (size_t)MxMaxPos;
+			}
+
+			Data = (const std::uint8_t *)MxMapData;
+			DataSize = MxMapSize;
+
+			return true;
+		}
+
+		bool File::Unmap()
+		{
+			if (MxMapData != NULL)
+			{
+				::UnmapViewOfFile(MxMapData);
+				MxMapData = NULL;
+				MxMapSize = 0;
+			}
+
+			return true;
+		}
+
 		bool File::Close()
 		{
+			Unmap();
+
 			if (MxFile != NULL)
 			{
 				::CloseHandle(MxFile);
@@ -1190,7 +1230,7 @@ namespace CubicleSoft
 			Dirname[Size] = L'\0';
 		}
 #else
-		File::File() : MxFile(-1), MxLocked(false), MxRead(false), MxWrite(false), MxCurrPos(0), MxMaxPos(0)
+		File::File() : MxFile(-1), MxLocked(false), MxRead(false), MxWrite(false), MxCurrPos(0), MxMaxPos(0), MxMapData(NULL), MxMapSize(0)
 		{
 		}
 
@@ -1368,8 +1408,44 @@ namespace CubicleSoft
 			return true;
 		}
 
+		bool File::Map(const std::uint8_t *&Data, size_t &DataSize)
+		{
+			if (MxFile == -1 || !MxRead)  return false;
+
+			if (MxMapData == NULL)
+			{
+				UpdateMaxPos();
+				if (!MxMaxPos || MxMaxPos > (std::uint64_t)(size_t)-1)  return false;
+
+				void *Data2 = ::mmap(NULL, (size_t)MxMaxPos, PROT_READ, MAP_SHARED, MxFile, 0);
+				if (Data2 == MAP_FAILED)  return false;
+
+				MxMapData = Data2;
+				MxMapSize = (size_t)MxMaxPos;
+			}
+
+			Data = (const std::uint8_t *)MxMapData;
+			DataSize = MxMapSize;
+
+			return true;
+		}
+
+		bool File::Unmap()
+		{
+			if (MxMapData != NULL)
+			{
+				::munmap(MxMapData, MxMapSize);
+				MxMapData = NULL;
+				MxMapSize = 0;
+			}
+
+			return true;
+		}
+
 		bool File::Close()
 		{
+			Unmap();
+
 			if (MxFile != -1)
 			{
 				::close(MxFile);
@@ -21,6 +21,7 @@
 	#include <sys/types.h>
 	#include <sys/stat.h>
 	#include <sys/file.h>
+	#include <sys/mman.h>
 	#include <sys/time.h>
 	#include <fcntl.h>
 	#include <unistd.h>
@@ -136,6 +137,12 @@ namespace CubicleSoft
 			inline std::uint64_t GetCurrPos() const { return MxCurrPos; }
 			inline std::uint64_t GetMaxPos() const { return MxMaxPos; }
 			virtual bool UpdateMaxPos();
+
+			// Maps the entire file into memory as read-only.  Data stays valid until Unmap() or Close() is called.  Empty files can't be mapped.
+			// Calling Map() again returns the existing mapping.
+			virtual bool Map(const std::uint8_t *&Data, size_t &DataSize);
+			virtual bool Unmap();
+
 			virtual bool Close();
 
 			// Some static functions specifically for files.
@@ -186,6 +193,8 @@ private:
 		protected:
 			bool MxRead, MxWrite;
 			std::uint64_t MxCurrPos, MxMaxPos;
+			void *MxMapData;
+			size_t MxMapSize;
 		};
 
 		class Dir